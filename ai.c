@@ -0,0 +1,576 @@
+/*
+ * 项目：Tetris
+ * 文件名：ai.c
+ * 概览：电脑玩家模块
+ * -------------
+ * 负责功能：
+ *      局面评估
+ *      对当前、下一个及暂存方块的束搜索
+ *      按搜索结果操作游戏
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tetris.h"   // 需要在方块堆上放置方块
+#include "flow.h"     // 需要取得游戏上下文，并使用 hold
+#include "movegen.h"  // 需要列举落点及操作序列
+#include "pool.h"     // 需要用线程池并行搜索
+#include "ttable.h"   // 需要用置换表避免重复评估
+#include "ai.h"       // 本模块
+
+#define Min(x,y) ((x)<(y) ? (x):(y))
+#define Max(x,y) ((x)>(y) ? (x):(y))
+
+// 方块类型未知或没有方块
+#define NoPiece (-1)
+
+// 搜索深度上限：当前、下一个、暂存的方块至多放置3个
+#define MaxDepth 3
+
+// 当前及暂存方块类型对局面键值的贡献，与方块堆的哈希值异或即得到局面键值
+#define PieceKey(cur, hold) \
+        ((uint64_t)((cur) + 2 + ((hold) + 2) * 16) * 0x9E3779B97F4A7C15ULL)
+
+
+/* 搜索中的一个局面
+ *      board   - 方块堆
+ *      cur     - 当前方块类型
+ *      next    - 下一个方块类型
+ *      hold    - 暂存的方块类型
+ *      canHold - 当前方块能否暂存（刚释放的方块不能再暂存）
+ *      lines   - 自搜索开始累计消除的行数
+ *      value   - 评估值
+ *      key     - 局面键值，方块堆与方块都相同的局面键值相同
+ *      first   - 由根局面走到这里的第一步，即最终要做出的决定
+ */
+typedef struct {
+  tetBoard    board;
+  int         cur, next, hold;
+  bool        canHold;
+  int         lines;
+  double      value;
+  uint64_t    key;
+  tetDecision first;
+} tetNode;
+
+
+/* 下一层的候选局面
+ * 只记录如何由上一层局面得到，选入束中后才真正生成方块堆
+ *      parent  - 上一层局面的下标
+ *      order   - 生成顺序，评估值相同时按此排序，保证结果确定
+ *      keep    - 上一层局面已无已知方块可放，原样保留
+ *      useHold - 是否先暂存/释放方块
+ *      place   - 落定的方块
+ *      value   - 放置后局面的评估值
+ *      key     - 放置后的局面键值
+ */
+typedef struct {
+  int      parent;
+  int      order;
+  bool     keep;
+  bool     useHold;
+  tetBlock place;
+  double   value;
+  uint64_t key;
+} tetCandidate;
+
+
+/* 候选局面列表，容量不足时自动扩大
+ *      list  - 各个候选局面
+ *      count - 候选局面数
+ *      cap   - 容量
+ */
+typedef struct {
+  tetCandidate* list;
+  int           count;
+  int           cap;
+} tetCandList;
+
+
+/* 展开束中一个局面的任务，由线程池执行
+ *      ai, g - 电脑玩家设置及游戏上下文（只读）
+ *      beam  - 当前层的束（只读）
+ *      index - 要展开的局面在束中的下标
+ *      level - 当前层数
+ *      out   - 本任务的候选局面，只由本任务写入；按评估值排序，至多保留束宽个
+ *      ok    - false 代表内存不足
+ *      taken - 归并时已取出的候选局面数，由调用者使用
+ */
+typedef struct {
+  const tetAI*   ai;
+  const tetGame* g;
+  const tetNode* beam;
+  int            index;
+  int            level;
+  tetCandList    out;
+  bool           ok;
+  int            taken;
+} tetExpandTask;
+
+
+// 内部函数声明
+bool beamSearch(const tetAI* ai, const tetGame* g, tetNode* beam, tetNode* child,
+                tetExpandTask* task, tetDecision* d);
+void expandTask(void* arg);
+tetBlock spawnBlock(int type);
+bool addCandidate(tetCandList* cl, const tetCandidate* c);
+bool expandPiece(const tetAI* ai, const tetNode* n, int parent, const tetBlock* start,
+                 bool useHold, int nextCur, tetCandList* cl);
+void childNode(const tetNode* p, const tetCandidate* c, bool atRoot, tetNode* child);
+int  compareCandidate(const void* a, const void* b);
+
+
+/*
+ * 函数名：initAI
+ * -------------
+ * 默认权重取自常见的四特征评估函数（高度、空洞、凹凸度、消除行数），
+ * 井深已部分包含在凹凸度中，只给较小的权重
+ */
+void initAI(tetAI* ai)
+{
+    ai->weight[FEAT_HEIGHT]    = -0.510066;
+    ai->weight[FEAT_HOLES]     = -0.35663;
+    ai->weight[FEAT_BUMPINESS] = -0.184483;
+    ai->weight[FEAT_WELLS]     = -0.05;
+    ai->weight[FEAT_LINES]     =  0.760666;
+    ai->beamWidth = 8;
+    ai->depth     = 2;
+    ai->pool      = NULL;
+    ai->table     = NULL;
+}
+
+/*
+ * 函数名：evaluate
+ * -------------
+ * 由各列高度及占用位平面计算各特征，求加权和
+ * 所有被占用的格子都在该列高度之下，因此空洞数即高度之和减去被占用的格数
+ */
+double evaluate(const tetAI* ai, const tetBoard* board, int lines)
+{
+    const unsigned char* h = board->heights;
+    int x, y, top = 0;
+    int height = 0, cells = 0, bumpiness = 0, wells = 0;
+
+    for (x = 0; x <= MaxCoordX; ++x)
+    {
+        height += h[x];
+        top = Max(top, h[x]);
+
+        if (x < MaxCoordX)
+            bumpiness += h[x] > h[x+1] ? h[x] - h[x+1] : h[x+1] - h[x];
+
+        // 边界视为无限高
+        int side = Min(x > 0 ? h[x-1] : MaxCoordY + 1,
+                       x < MaxCoordX ? h[x+1] : MaxCoordY + 1);
+        if (side > h[x])
+            wells += side - h[x];
+    }
+
+    for (y = 0; y < top; ++y)
+        cells += __builtin_popcount(board->rows[y]);
+
+    return ai->weight[FEAT_HEIGHT]    * height
+         + ai->weight[FEAT_HOLES]     * (height - cells)
+         + ai->weight[FEAT_BUMPINESS] * bumpiness
+         + ai->weight[FEAT_WELLS]     * wells
+         + ai->weight[FEAT_LINES]     * lines;
+}
+
+/*
+ * 函数名：aiDecide
+ * -------------
+ * 申请束及各展开任务所需的内存，由 beamSearch 完成搜索
+ */
+bool aiDecide(const tetAI* ai, const tetGame* g, tetDecision* d)
+{
+    int width = Max(ai->beamWidth, 1);
+    int i;
+    tetNode* beam  = malloc(width * sizeof(tetNode));
+    tetNode* child = malloc(width * sizeof(tetNode));
+    tetExpandTask* task = calloc(width, sizeof(tetExpandTask));
+    bool ok = false;
+
+    if (beam != NULL && child != NULL && task != NULL)
+        ok = beamSearch(ai, g, beam, child, task, d);
+
+    if (task != NULL)
+        for (i = 0; i < width; ++i)
+            free(task[i].out.list);
+    free(beam);
+    free(child);
+    free(task);
+    return ok;
+}
+
+/*
+ * 函数名：aiPlay
+ * -------------
+ * 做出决定后，先按需暂存/释放，再依次执行到达落点的操作，最后落底
+ */
+void aiPlay(const tetAI* ai, tetGame* g)
+{
+    tetDecision d;
+    tetStep path[MaxStates];
+    int i, len;
+
+    // 无处可放，直接落底，由游戏本身判定结束
+    if (!aiDecide(ai, g, &d))
+    {
+        drop(g);
+        return;
+    }
+
+    if (d.useHold)
+    {
+        hold(g);
+        if (g->over)
+            return;
+    }
+
+    len = placementPath(&g->stored, &g->falling, &d.target, path);
+    for (i = 0; i < len; ++i)
+    {
+        switch (path[i])
+        {
+        case STEP_LEFT:
+            move(g, TM_LEFT);
+            break;
+        case STEP_RIGHT:
+            move(g, TM_RIGHT);
+            break;
+        case STEP_DOWN:
+            move(g, TM_DOWN);
+            break;
+        case STEP_ROTATE:
+            rotate(g);
+            break;
+        }
+    }
+
+    drop(g);
+}
+
+/* （内部函数）
+ * 函数名称：beamSearch
+ * 函数原型：bool beamSearch(const tetAI* ai, const tetGame* g, tetNode* beam, tetNode* child,
+ *                          tetExpandTask* task, tetDecision* d)
+ * 功能描述：逐层展开束中的每个局面，保留评估值最高的 beamWidth 个候选局面作为下一层
+ *          束中各局面的展开互不相关，作为一批任务交给线程池（ai->pool）并行执行；
+ *          每个任务只写自己的候选列表，汇总时按固定的顺序比较，
+ *          因此结果与线程数及调度顺序无关
+ * 副作用？：改变传入的束、任务及决定
+ *
+ * 参数描述：电脑玩家设置 ai :: const tetAI*
+ *         游戏上下文 g :: const tetGame*
+ *         束 beam、child :: tetNode*（各有 beamWidth 个，轮流作为当前层与下一层）
+ *         展开任务 task :: tetExpandTask*（beamWidth 个）
+ *         决定 d :: tetDecision*
+ * 返回类型：bool，false 代表没有可行的落点或内存不足
+ * --------------
+ * 使用方法：ok = beamSearch(ai, g, beam, child, task, d);
+ */
+bool beamSearch(const tetAI* ai, const tetGame* g, tetNode* beam, tetNode* child,
+                tetExpandTask* task, tetDecision* d)
+{
+    int width = Max(ai->beamWidth, 1);
+    int depth = Min(Max(ai->depth, 1), MaxDepth);
+    int size  = 1;
+    int level, i, k;
+
+    // 根局面：只使用界面上可以看到的方块
+    beam[0].board   = g->stored;
+    beam[0].cur     = g->falling.type;
+    beam[0].next    = g->nextBlock.type;
+    beam[0].hold    = g->OnHolding ? (int)g->holdBlock.type : NoPiece;
+    beam[0].canHold = !g->OnRelease;
+    beam[0].lines   = 0;
+    beam[0].value   = evaluate(ai, &g->stored, 0);
+    beam[0].key     = g->stored.hash ^ PieceKey(beam[0].cur, beam[0].hold);
+
+    for (level = 0; level < depth; ++level)
+    {
+        // 所有局面都已无方块可放，则停止在上一层
+        for (i = 0; i < size && beam[i].cur == NoPiece; ++i)
+            ;
+        if (i == size)
+            break;
+
+        for (i = 0; i < size; ++i)
+        {
+            task[i].ai    = ai;
+            task[i].g     = g;
+            task[i].beam  = beam;
+            task[i].index = i;
+            task[i].level = level;
+        }
+        poolRun(ai->pool, expandTask, task, sizeof(tetExpandTask), size);
+
+        for (i = 0; i < size; ++i)
+            if (!task[i].ok)
+                return false;
+
+        // 各任务的候选局面已排好序，多路归并取出最好的 beamWidth 个
+        // 经不同放置顺序得到的相同局面只保留评估值最高的一个，不重复占用束宽
+        int next = 0, j;
+        for (k = 0; k < size; ++k)
+            task[k].taken = 0;
+        while (next < width)
+        {
+            int best = -1;
+            for (k = 0; k < size; ++k)
+            {
+                if (task[k].taken == task[k].out.count)
+                    continue;
+                if (best < 0 || compareCandidate(&task[k].out.list[task[k].taken],
+                                                 &task[best].out.list[task[best].taken]) < 0)
+                    best = k;
+            }
+            if (best < 0)
+                break;
+
+            const tetCandidate* c = &task[best].out.list[task[best].taken++];
+            for (j = 0; j < next && child[j].key != c->key; ++j)
+                ;
+            if (j < next)
+                continue;
+            childNode(&beam[c->parent], c, level == 0, &child[next++]);
+        }
+
+        // 没有可行的落点，则停止在上一层
+        if (next == 0)
+            break;
+
+        size = next;
+        tetNode* tmp = beam;
+        beam  = child;
+        child = tmp;
+    }
+
+    // 根局面没有可行的落点
+    if (level == 0)
+        return false;
+
+    // 束中的局面已按评估值排好序，第一个即为最好的局面
+    *d = beam[0].first;
+    return true;
+}
+
+/* （内部函数）
+ * 函数名：expandTask
+ * -------------
+ * 展开束中的一个局面：放置当前方块，或（允许时）先暂存/释放再放置；
+ * 候选局面按评估值排序后只保留前 beamWidth 个，其余不可能被选入下一层
+ */
+void expandTask(void* arg)
+{
+    tetExpandTask* t = arg;
+    const tetNode* n = &t->beam[t->index];
+    tetCandList* cl  = &t->out;
+    tetBlock start;
+
+    cl->count = 0;
+    t->ok = true;
+
+    // 已无已知方块可放，原样保留到下一层
+    if (n->cur == NoPiece)
+    {
+        tetCandidate keep;
+        memset(&keep, 0, sizeof(keep));
+        keep.parent = t->index;
+        keep.keep   = true;
+        keep.value  = n->value;
+        keep.key    = n->key;
+        t->ok = addCandidate(cl, &keep);
+        return;
+    }
+
+    // 放置当前方块；根局面的当前方块就是正在下落的方块，可能已不在顶端
+    start = t->level == 0 ? t->g->falling : spawnBlock(n->cur);
+    t->ok = expandPiece(t->ai, n, t->index, &start, false, n->next, cl);
+
+    if (t->ok && n->canHold)
+    {
+        // 没有暂存的方块：暂存当前方块，放置下一个方块
+        if (n->hold == NoPiece && n->next != NoPiece)
+        {
+            start = spawnBlock(n->next);
+            t->ok = expandPiece(t->ai, n, t->index, &start, true, NoPiece, cl);
+        }
+        // 已有暂存的方块：将其释放并放置，之后轮到当前方块
+        else if (n->hold != NoPiece)
+        {
+            start = spawnBlock(n->hold);
+            t->ok = expandPiece(t->ai, n, t->index, &start, true, n->cur, cl);
+        }
+    }
+
+    qsort(cl->list, cl->count, sizeof(tetCandidate), compareCandidate);
+    cl->count = Min(cl->count, Max(t->ai->beamWidth, 1));
+}
+
+/* （内部函数）
+ * 函数名：spawnBlock
+ * -------------
+ * 取得 type 型方块刚出现在顶端时的状态
+ */
+tetBlock spawnBlock(int type)
+{
+    tetBlock b;
+    memset(&b, 0, sizeof(b));
+    b.type = type;
+    initBlock(&b);
+    moveToTop(&b);
+    return b;
+}
+
+/* （内部函数）
+ * 函数名：addCandidate
+ * -------------
+ * 将候选局面加入列表，容量不足时扩大一倍；内存不足时返回 false
+ */
+bool addCandidate(tetCandList* cl, const tetCandidate* c)
+{
+    if (cl->count == cl->cap)
+    {
+        int cap = cl->cap ? cl->cap * 2 : 256;
+        tetCandidate* list = realloc(cl->list, cap * sizeof(tetCandidate));
+        if (list == NULL)
+            return false;
+        cl->list = list;
+        cl->cap  = cap;
+    }
+    cl->list[cl->count++] = *c;
+    return true;
+}
+
+/* （内部函数）
+ * 函数名称：expandPiece
+ * 函数原型：bool expandPiece(const tetAI* ai, const tetNode* n, int parent, const tetBlock* start,
+ *                           bool useHold, int nextCur, tetCandList* cl)
+ * 功能描述：在局面 n 中列举方块 start 的所有落点，评估放置后的局面并加入候选
+ *          方块有格子超出顶端，或之后的方块一出现就碰撞的落点会导致游戏结束，不予考虑
+ *          评估值中与方块堆有关的部分先查置换表（ai->table），没有才计算
+ * 副作用？：改变传入的候选局面列表
+ *
+ * 参数描述：电脑玩家设置 ai :: const tetAI*
+ *         局面 n :: const tetNode*，及其在束中的下标 parent :: int
+ *         放置的方块 start :: const tetBlock*
+ *         是否先暂存/释放 useHold :: bool
+ *         放置后的当前方块类型 nextCur :: int（未知为 NoPiece）
+ *         候选局面列表 cl :: tetCandList*
+ * 返回类型：bool，false 代表内存不足
+ * --------------
+ * 使用方法：expandPiece(ai, n, i, &start, false, n->next, &cl);
+ */
+bool expandPiece(const tetAI* ai, const tetNode* n, int parent, const tetBlock* start,
+                 bool useHold, int nextCur, tetCandList* cl)
+{
+    tetPlacementList pl;
+    tetBlock spawn;
+    tetBoard board;
+    tetCandidate c;
+    double value;
+    int i, cleared;
+
+    // 放置后暂存的方块，与 childNode 的规则一致
+    int nextHold = !useHold ? n->hold : (n->hold == NoPiece ? n->cur : NoPiece);
+
+    if (nextCur != NoPiece)
+        spawn = spawnBlock(nextCur);
+
+    genPlacements(&n->board, start, &pl);
+    for (i = 0; i < pl.count; ++i)
+    {
+        const tetBlock* b = &pl.list[i];
+        if (b->coord.y + ShapeOf(*b)->maxY > MaxCoordY)
+            continue;
+
+        board = n->board;
+        addToBoard(&board, b);
+        cleared = eliminateLines(&board);
+
+        if (nextCur != NoPiece && blockCheck(&board, &spawn) != FREEMOVE)
+            continue;
+
+        c.parent  = parent;
+        c.order   = cl->count;
+        c.keep    = false;
+        c.useHold = useHold;
+        c.place   = *b;
+        c.key     = board.hash ^ PieceKey(nextCur, nextHold);
+
+        if (ai->table == NULL || !ttProbe(ai->table, board.hash, &value))
+        {
+            value = evaluate(ai, &board, 0);
+            if (ai->table != NULL)
+                ttStore(ai->table, board.hash, value);
+        }
+        c.value = value + ai->weight[FEAT_LINES] * (n->lines + cleared);
+        if (!addCandidate(cl, &c))
+            return false;
+    }
+    return true;
+}
+
+/* （内部函数）
+ * 函数名：childNode
+ * -------------
+ * 按候选局面 c 的记录，由上一层局面 p 生成下一层的局面
+ * 暂存/释放后各方块的去向与 hold、newRound 的规则一致：
+ *      没有暂存的方块时，当前方块进入暂存，放置下一个方块，之后的方块未知
+ *      已有暂存的方块时，放置暂存的方块，之后轮到原来的当前方块，原来的下一个方块被舍弃
+ */
+void childNode(const tetNode* p, const tetCandidate* c, bool atRoot, tetNode* child)
+{
+    *child = *p;
+    if (c->keep)
+        return;
+
+    addToBoard(&child->board, &c->place);
+    child->lines += eliminateLines(&child->board);
+    child->value   = c->value;
+    child->key     = c->key;
+    child->canHold = true;
+
+    if (!c->useHold)
+    {
+        child->cur  = p->next;
+        child->next = NoPiece;
+    }
+    else if (p->hold == NoPiece)
+    {
+        child->cur  = NoPiece;
+        child->next = NoPiece;
+        child->hold = p->cur;
+    }
+    else
+    {
+        child->cur  = p->cur;
+        child->next = NoPiece;
+        child->hold = NoPiece;
+    }
+
+    if (atRoot)
+    {
+        child->first.useHold = c->useHold;
+        child->first.target  = c->place;
+    }
+}
+
+/* （内部函数）
+ * 函数名：compareCandidate
+ * -------------
+ * 候选局面的比较函数：评估值高者在前，相同时依次按上一层局面的下标、生成顺序
+ */
+int compareCandidate(const void* a, const void* b)
+{
+    const tetCandidate* x = a;
+    const tetCandidate* y = b;
+
+    if (x->value != y->value)
+        return x->value > y->value ? -1 : 1;
+    if (x->parent != y->parent)
+        return x->parent - y->parent;
+    return x->order - y->order;
+}
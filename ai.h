@@ -0,0 +1,140 @@
+/*
+ * 项目：Tetris
+ * 文件名：ai.h
+ * 概览：电脑玩家模块
+ * -------------
+ * 主要内容：
+ *      基于局面评估与束搜索（beam search）的电脑玩家
+ *
+ * 局面评估为若干特征的加权和：各列高度之和、空洞数、相邻列高度差之和、井深之和、消除行数
+ * 搜索时对当前方块、下一个方块及暂存的方块，考虑放置或暂存两种选择，
+ * 每一层只保留评估值最高的若干个局面（束宽），直到达到搜索深度或再无已知的方块。
+ * 搜索只使用界面上也能看到的方块，不会由随机数发生器偷看之后的方块
+ *
+ * 束中各局面的展开可交给线程池并行执行，结果与线程数无关；
+ * 经不同放置顺序得到的相同方块堆由置换表识别，只评估一次
+ *
+ * 选定后通过与玩家相同的 hold、move、rotate、drop 操作游戏，
+ * 可用于长时间压力测试游戏核心，也可以作为对手
+ *
+ * 外部接口：
+ *      initAI
+ *      evaluate
+ *      aiDecide
+ *      aiPlay
+ */
+
+#ifndef AI_H
+#define AI_H
+
+#include <stdbool.h>
+
+#include "tetris.h"  // 需要取得方块及方块堆定义
+#include "flow.h"    // 需要取得游戏上下文定义
+#include "pool.h"    // 需要取得线程池定义
+#include "ttable.h"  // 需要取得置换表定义
+
+/* 局面特征
+ *      FEAT_HEIGHT    - 各列高度之和
+ *      FEAT_HOLES     - 空洞数，即各列最高格之下的空格数
+ *      FEAT_BUMPINESS - 相邻两列高度差的绝对值之和
+ *      FEAT_WELLS     - 井深之和，即各列低于两侧（边界视为无限高）较矮一侧的格数
+ *      FEAT_LINES     - 自搜索开始累计消除的行数
+ */
+typedef enum {
+  FEAT_HEIGHT, FEAT_HOLES, FEAT_BUMPINESS, FEAT_WELLS, FEAT_LINES,
+  featNum
+} tetFeature;
+
+
+/* 电脑玩家设置
+ *      weight    - 各特征的权重，下标为 tetFeature
+ *      beamWidth - 束宽，每层保留的局面数
+ *      depth     - 搜索深度，即向后考虑放置几个方块（受已知方块数限制，至多为3）
+ *      pool      - 用于并行搜索的线程池（见 pool.h），NULL 代表只用调用者一个线程
+ *      table     - 缓存方块堆评估值的置换表（见 ttable.h），NULL 代表不缓存
+ *                  表中的值与权重有关，改变权重后须清空
+ * 束宽与深度越大，电脑玩家越强，每一步的耗时也越长；
+ * 同一局面下，无论用几个线程、是否使用置换表，做出的决定都相同
+ */
+typedef struct {
+  double     weight[featNum];
+  int        beamWidth;
+  int        depth;
+  tetPool*   pool;
+  tetTTable* table;
+} tetAI;
+
+
+/* 电脑玩家的决定
+ *      useHold - 是否先暂存/释放方块
+ *      target  - 之后正在下落的方块应落定的位置
+ */
+typedef struct {
+  bool     useHold;
+  tetBlock target;
+} tetDecision;
+
+
+/*
+ * 函数名称：initAI
+ * 函数原型：void initAI(tetAI* ai)
+ * 功能描述：将电脑玩家设为默认的权重、束宽及搜索深度
+ * 副作用？：改变传入的电脑玩家设置
+ *
+ * 参数描述：电脑玩家设置 ai :: tetAI*
+ * 返回类型：无
+ * --------------
+ * 使用方法：initAI(&yourAI); yourAI.beamWidth = 16;
+ */
+void initAI(tetAI* ai);
+
+
+/*
+ * 函数名称：evaluate
+ * 函数原型：double evaluate(const tetAI* ai, const tetBoard* board, int lines)
+ * 功能描述：按电脑玩家的权重评估局面
+ * 副作用？：无
+ *
+ * 参数描述：电脑玩家设置 ai :: const tetAI*
+ *         方块堆 board :: const tetBoard*
+ *         消除行数 lines :: int
+ * 返回类型：double，评估值，越大越好
+ * --------------
+ * 使用方法：double v = evaluate(&yourAI, &yourGame->stored, 0);
+ */
+double evaluate(const tetAI* ai, const tetBoard* board, int lines);
+
+
+/*
+ * 函数名称：aiDecide
+ * 函数原型：bool aiDecide(const tetAI* ai, const tetGame* g, tetDecision* d)
+ * 功能描述：对游戏 g 的当前局面做束搜索，选出当前方块的操作
+ * 副作用？：改变传入的决定
+ *
+ * 参数描述：电脑玩家设置 ai :: const tetAI*
+ *         游戏上下文 g :: const tetGame*
+ *         决定 d :: tetDecision*
+ * 返回类型：bool，false 代表没有可行的落点（或内存不足），此时 d 不变
+ * --------------
+ * 使用方法：if (aiDecide(&yourAI, yourGame, &d)) ...
+ */
+bool aiDecide(const tetAI* ai, const tetGame* g, tetDecision* d);
+
+
+/*
+ * 函数名称：aiPlay
+ * 函数原型：void aiPlay(const tetAI* ai, tetGame* g)
+ * 功能描述：由电脑玩家为游戏 g 落下当前方块：
+ *          做出决定后，依次调用 hold、rotate、move，最后 drop
+ * 副作用？：与玩家操作相同，改变游戏 g 并开启下一轮
+ *
+ * 参数描述：电脑玩家设置 ai :: const tetAI*
+ *         游戏上下文 g :: tetGame*
+ * 返回类型：无
+ * --------------
+ * 使用方法：while (!yourGame->over) aiPlay(&yourAI, yourGame);
+ */
+void aiPlay(const tetAI* ai, tetGame* g);
+
+#endif
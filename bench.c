@@ -0,0 +1,332 @@
+/*
+ * 项目：Tetris
+ * 文件名：bench.c
+ * 概览：游戏核心微基准程序 tetris-bench
+ * -------------
+ * 负责功能：
+ *      在一组真实的对局中途局面上，反复计时游戏核心的热点操作，
+ *      报告每次操作耗时（纳秒）的最小值、中位数及99百分位数
+ *
+ * 用法：tetris-bench [-n 局面数] [-r 取样次数] [-s 种子] [-f 名称]
+ *      -n  局面库中的局面数，默认 256
+ *      -r  每项操作的取样次数，默认 101
+ *      -s  生成局面库的随机种子，默认 1
+ *      -f  只运行名称中含有该字符串的项目
+ *
+ * 局面库由电脑玩家从不同种子开局，每隔若干个方块截取一个局面得到；
+ * 正在下落的方块放在出现位置与落点之间的随机高度，使 move(TM_DOWN) 时有落定也有下落。
+ * 另有一个“放置后”局面库：每个局面中加上电脑玩家选定的落点，但尚未消行，供 eliminateLines 使用
+ *
+ * 每次取样对整个局面库（存档读写为其前 SaveSample 个局面）各做一次操作，
+ * 以总耗时除以操作数作为该次取样的结果；会改变局面的操作在计时前先复制局面。
+ * 种子相同则局面库相同，不同版本的游戏核心之间可以直接比较
+ * 只依赖核心库（libtetris_core.a）
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tetris.h"   // 需要被测的方块操作
+#include "flow.h"     // 需要游戏上下文
+#include "fileIO.h"   // 需要存档读写
+#include "writer.h"   // 需要等待后台写入完成
+#include "rng.h"      // 需要随机取局面
+#include "platform.h" // 需要计时
+#include "ai.h"       // 由电脑玩家生成局面
+
+#define Min(x,y) ((x)<(y) ? (x):(y))
+
+// 每局截取局面的起点及间隔（方块数），以及每局最多截取的局面数
+#define SnapFirst 20
+#define SnapEvery 10
+#define SnapMax   16
+
+// 存档读写每次取样的操作数，文件操作较慢，只取一部分局面
+#define SaveSample 16
+
+// 存档读写所用的玩家名
+#define BenchUser "__bench"
+
+
+/* 一个计时项目
+ *      name    - 名称
+ *      pass    - 对 n 个局面各做一次操作
+ *      placed  - 是否使用“放置后”局面库
+ *      mutates - 操作是否改变局面，是则每次取样前复制局面
+ *      size    - 每次取样的操作数，0 代表整个局面库
+ */
+typedef struct {
+  const char* name;
+  void (*pass)(tetGame* g, int n);
+  bool        placed;
+  bool        mutates;
+  int         size;
+} tetBench;
+
+
+// 防止编译器把没有用到结果的操作优化掉
+static volatile int sink;
+
+
+// 内部函数声明
+void   buildCorpus(tetGame* corpus, tetGame* placed, int n, uint64_t seed);
+void   passCollision(tetGame* g, int n);
+void   passRotate(tetGame* g, int n);
+void   passMoveDown(tetGame* g, int n);
+void   passDrop(tetGame* g, int n);
+void   passEliminate(tetGame* g, int n);
+void   passGeneNext(tetGame* g, int n);
+void   passSaveLoad(tetGame* g, int n);
+int    compareDouble(const void* a, const void* b);
+
+
+// 所有计时项目
+static const tetBench benches[] = {
+  { "collisionCheck",    passCollision, false, false, 0 },
+  { "rotate",            passRotate,    false, true,  0 },
+  { "move(TM_DOWN)",     passMoveDown,  false, true,  0 },
+  { "drop",              passDrop,      false, true,  0 },
+  { "eliminateLines",    passEliminate, true,  true,  0 },
+  { "geneNext",          passGeneNext,  false, true,  0 },
+  { "saveGame+loadGame", passSaveLoad,  false, false, SaveSample },
+};
+
+
+int main(int argc, char* argv[])
+{
+    int size    = 256;
+    int samples = 101;
+    unsigned long long seed = 1;
+    const char* filter = NULL;
+    int i, k;
+
+    // 解析命令行参数
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            size = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            samples = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+            filter = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [-n boards] [-r samples] [-s seed] [-f name]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (size <= 0 || samples <= 0)
+    {
+        fprintf(stderr, "boards and samples must be positive\n");
+        return 1;
+    }
+
+    tetGame* corpus = malloc(size * sizeof(tetGame));
+    tetGame* placed = malloc(size * sizeof(tetGame));
+    tetGame* work   = malloc(size * sizeof(tetGame));
+    double*  result = malloc(samples * sizeof(double));
+    if (corpus == NULL || placed == NULL || work == NULL || result == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    buildCorpus(corpus, placed, size, seed);
+
+    printf("boards %d, samples %d, seed %llu\n", size, samples, seed);
+    printf("%-20s %8s %10s %10s %10s\n", "benchmark", "ops", "min ns", "median ns", "p99 ns");
+
+    for (k = 0; k < (int)(sizeof(benches) / sizeof(benches[0])); ++k)
+    {
+        const tetBench* b = &benches[k];
+        const tetGame* from = b->placed ? placed : corpus;
+        int n = b->size > 0 ? Min(b->size, size) : size;
+
+        if (filter != NULL && strstr(b->name, filter) == NULL)
+            continue;
+
+        // 先不计时地做一遍，使代码与数据进入缓存
+        memcpy(work, from, n * sizeof(tetGame));
+        b->pass(work, n);
+
+        for (i = 0; i < samples; ++i)
+        {
+            if (b->mutates || i == 0)
+                memcpy(work, from, n * sizeof(tetGame));
+
+            double begin = platNow();
+            b->pass(work, n);
+            result[i] = (platNow() - begin) * 1e9 / n;
+        }
+
+        qsort(result, samples, sizeof(double), compareDouble);
+        printf("%-20s %8d %10.1f %10.1f %10.1f\n", b->name, n,
+               result[0], result[samples / 2], result[(samples * 99 + 99) / 100 - 1]);
+    }
+
+    remove("saves" PathSep BenchUser ".save");
+    free(corpus);
+    free(placed);
+    free(work);
+    free(result);
+    return 0;
+}
+
+/* （内部函数）
+ * 函数名：buildCorpus
+ * -------------
+ * 由电脑玩家（束宽1、深度1，以求快速）进行若干局，
+ * 从第 SnapFirst 个方块起每 SnapEvery 个方块截取一个局面，直到凑满 n 个：
+ *      corpus[i] - 截取的局面，正在下落的方块移到出现位置与落点之间的随机高度
+ *      placed[i] - 同一局面中，将电脑玩家选定的落点加入方块堆后、消行前的局面
+ * 出现位置已被占据的局面不予截取
+ */
+void buildCorpus(tetGame* corpus, tetGame* placed, int n, uint64_t seed)
+{
+    tetAI ai;
+    tetGame g;
+    tetRng r;
+    tetDecision d;
+    int count = 0, game = 0, pieces, taken;
+
+    initAI(&ai);
+    ai.beamWidth = 1;
+    ai.depth     = 1;
+    seedRng(&r, seed);
+
+    while (count < n)
+    {
+        initGame(&g, seed + game++, RAND_UNIFORM);
+        for (pieces = 0, taken = 0; count < n && taken < SnapMax && !g.over; ++pieces)
+        {
+            if (pieces >= SnapFirst && (pieces - SnapFirst) % SnapEvery == 0
+                && blockCheck(&g.stored, &g.falling) == FREEMOVE && aiDecide(&ai, &g, &d))
+            {
+                // 求出落点，在其与出现位置之间随机取一个高度
+                tetBlock probe = g.falling;
+                while (blockCheck(&g.stored, &probe) == FREEMOVE)
+                    probe.coord.y--;
+                int land = probe.coord.y + 1;
+
+                corpus[count] = g;
+                corpus[count].falling.coord.y = land + randBelow(&r, g.falling.coord.y - land + 1);
+
+                placed[count] = g;
+                addToBoard(&placed[count].stored, &d.target);
+
+                count++;
+                taken++;
+            }
+            aiPlay(&ai, &g);
+        }
+    }
+}
+
+/* （内部函数）
+ * 函数名：passCollision
+ * -------------
+ * 对各局面做碰撞检测
+ */
+void passCollision(tetGame* g, int n)
+{
+    int i, s = 0;
+    for (i = 0; i < n; ++i)
+        s += collisionCheck(&g[i]);
+    sink = s;
+}
+
+/* （内部函数）
+ * 函数名：passRotate
+ * -------------
+ * 对各局面旋转一次
+ */
+void passRotate(tetGame* g, int n)
+{
+    int i;
+    for (i = 0; i < n; ++i)
+        rotate(&g[i]);
+}
+
+/* （内部函数）
+ * 函数名：passMoveDown
+ * -------------
+ * 对各局面下移一格，在落点处的方块落定并开启下一轮
+ */
+void passMoveDown(tetGame* g, int n)
+{
+    int i;
+    for (i = 0; i < n; ++i)
+        move(&g[i], TM_DOWN);
+}
+
+/* （内部函数）
+ * 函数名：passDrop
+ * -------------
+ * 对各局面直接落底，包括消行、计分及开启下一轮
+ */
+void passDrop(tetGame* g, int n)
+{
+    int i;
+    for (i = 0; i < n; ++i)
+        drop(&g[i]);
+}
+
+/* （内部函数）
+ * 函数名：passEliminate
+ * -------------
+ * 对各“放置后”局面做消行检测与紧缩
+ */
+void passEliminate(tetGame* g, int n)
+{
+    int i, s = 0;
+    for (i = 0; i < n; ++i)
+        s += eliminateLines(&g[i].stored);
+    sink = s;
+}
+
+/* （内部函数）
+ * 函数名：passGeneNext
+ * -------------
+ * 对各局面产生下一个方块
+ */
+void passGeneNext(tetGame* g, int n)
+{
+    int i;
+    for (i = 0; i < n; ++i)
+        geneNext(&g[i]);
+}
+
+/* （内部函数）
+ * 函数名：passSaveLoad
+ * -------------
+ * 对各局面存档，等后台写入（含写到磁盘）完成后立即读回
+ */
+void passSaveLoad(tetGame* g, int n)
+{
+    tetGame loaded;
+    int i, s = 0;
+    for (i = 0; i < n; ++i)
+    {
+        s += saveGame(&g[i], BenchUser, NULL);
+        while (pollWrites() > 0)
+            platYield();
+        s += loadGame(&loaded, BenchUser);
+    }
+    sink = s;
+}
+
+/* （内部函数）
+ * 函数名：compareDouble
+ * -------------
+ * qsort 用的比较函数，由小到大
+ */
+int compareDouble(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
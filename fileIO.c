@@ -6,185 +6,212 @@
  * 负责功能：排行榜及游戏存档处理，包括
  *      排行榜分数 读取/存入
  *      多游戏存档 读取/写入
+ * 存入与写入都编码到内存中后交给写入线程（见 writer.h），不阻塞界面
  */
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
-
-#include "exception.h" // 需要进行错误处理
+#include <string.h>
 
 #include "tetris.h"  // 需要得知方块结构声明
 #include "layout.h"  // 需要取得方块堆大小
+#include "flow.h"    // 需要取得游戏上下文定义，作为游戏存档的内容；需要定期取得写入完成通知
+#include "platform.h" // 需要建立存档目录、拼接存档路径
+#include "replay.h"  // 需要编解码快照，作为游戏存档的内容
+#include "writer.h"  // 需要在后台写入
+#include "rank.h"    // 需要在内存中建立名次索引
 #include "fileIO.h"  // 本模块
 
-/* 引入流程控制模块 flow.c 中的变量
- * 这些变量将作为游戏存档的内容
- */
-extern int speed;  // 游戏速度
-extern int score;  // 当前分数
-extern int level;  // 当前难度等级，最高为5
-extern int lines;  // 已消除的行数
-
-// 方块暂存状态
-extern bool OnHolding;
-extern bool OnRelease;
-extern bool delayOneRound;
+#define NewPointer(T) (T*)malloc(sizeof(T))
 
-// 已落下的方块堆
-extern tetBoard stored[MaxCoordY+1][MaxCoordX+1];
-extern tetBlock falling;    // 正在下落的方块
-extern tetBlock nextBlock;  // 下一个下落方块
-extern tetBlock holdBlock;  // 当前暂存的方块
+// 排行榜文件、插入时的日志文件，及旧版本的文本记录文件
+#define RecordFile       "saves" PathSep "leaderboard"
+#define JournalFile      "saves" PathSep "leaderboard.jnl"
+#define LegacyRecordFile "saves" PathSep "records"
 
+// 第 i 名的记录在排行榜文件中的偏移（头部与记录等长）
+#define RecordOffset(i) ((long)RecordSize * ((long)(i) + 1))
 
-#define NewPointer(T) (T*)malloc(sizeof(T))
+// 建立名次索引时每次读出的记录数
+#define RankLoadBlock 1024
 
-// 定义带错误处理的读取宏
-#define SafeRead(ptr, size, nmemb, stream) \
-        { \
-            if(fread(ptr, size, nmemb, stream) < nmemb) \
-                raise(InvalidFormat); \
-        }
+// 日志的文件头，及日志头部的字节数
+#define JournalMagic    "TJNL"
+#define JournalHeadSize 12
 
-/*
- * 函数名：freeRecords
- * -------------
- * 释放传入的排行榜分数链表
- * 参数类型：结构 tetRecord，其定义见fileIO.h
+/* 一次保存的写入任务
+ *      done         - 完成通知
+ *      name, score  - 分数记录：玩家名、分数
+ *      path         - 游戏存档：存档路径
+ *      data, size   - 游戏存档：编码好的内容及字节数
  */
-void freeRecords(tetRecord* rec)
-{
-    tetRecord* tmp;
+typedef struct {
+  tetSaveDone   done;
+  char          name[NAMELEN];
+  int           score;
+  char          path[32];
+  unsigned char data[SaveMaxSize];
+  size_t        size;
+} tetSaveJob;
+
+// 内存中的名次索引（排行榜各分数的顺序统计树），第一次查询名次时提交给写入线程建立；
+// 是否已建立、是否正在建立。以上只在界面线程中改变
+static tetRankTree board;
+static bool        boardLoaded  = false;
+static bool        boardLoading = false;
+
+// 内部函数声明
+uint32_t crc32(const unsigned char* data, size_t size);
+bool writeRecordJob(void* arg);
+bool writeGameJob(void* arg);
+void saveJobDone(bool ok, void* arg);
+void recordJobDone(bool ok, void* arg);
+void requestBoard();
+bool buildBoardJob(void* arg);
+void boardBuilt(bool ok, void* arg);
+bool findRank(FILE* fp, uint32_t total, int score, uint32_t* pos);
+FILE* openBoard(const char* path, const char* mode, uint32_t* total);
+FILE* readBoard(uint32_t* total);
+bool boardMissing();
+bool createBoard();
+bool redoJournal();
+bool applyJournal(FILE* fp, const unsigned char* journal, size_t size);
+void putRecord(unsigned char* p, const tetRecord* r);
+void getRecord(const unsigned char* p, tetRecord* r);
+void putUint32(unsigned char* p, uint32_t v);
+uint32_t getUint32(const unsigned char* p);
 
-    while (rec != NULL)
-    {
-        tmp = rec;
-        rec = rec->next;
-        free(tmp);
-    }
-}
 
 /*
  * 函数名：loadRecords
  * -------------
- * 读入所有排行榜分数，返回第一个记录结点；无数据则返回NULL
- * 返回类型：结构 tetRecord，其定义见fileIO.h
+ * 读入名次 first 起的至多 count 条记录：定长记录可直接定位，一次读出，无需解析文本
+ * 参数类型：tetRecord* 输出，int 起始名次（0起），int 条数
+ * 返回类型：int，读入的条数
  */
-tetRecord* loadRecords()
+int loadRecords(tetRecord* out, int first, int count)
 {
-    // 游戏分数记录路径为 saves 目录下的 records 文件
-    static char* recordFile = "saves\\records";
-    tetRecord *head = NewPointer(tetRecord), *current, *tmp;
-    // 为方便处理，从头结点的下一个节点开始存放数据
-    head->next = NULL;
+    uint32_t total;
+    int i, n = 0;
 
-    FILE* fp = fopen(recordFile, "r");
-
-    // 打开文件失败
+    FILE* fp = readBoard(&total);
     if (fp == NULL)
-        return NULL;
+        return 0;
 
-    current = head;
-    // 循环读入所有分数，直到文件结尾
-    while (!feof(fp))
+    if (first >= 0 && count > 0 && (uint32_t)first < total)
     {
-        // 读入一个分数记录
-        tmp = NewPointer(tetRecord);
-        tmp->next = NULL;
-        fscanf(fp, "%s", &(tmp->name));
-        fscanf(fp, "%d", &(tmp->score));
-
-        // 到达文件结尾时读取到的分数为0，返回
-        // （这依赖于fscanf处理 %d 时遇到非数字字符的行为）
-        if (tmp->score == 0)
-            break;
-
-        // 继续读取下一个节点
-        current->next = tmp;
-        current = current->next;
+        n = (uint32_t)count < total - first ? count : (int)(total - first);
+
+        unsigned char* buf = malloc((size_t)n * RecordSize);
+        if (buf == NULL || fseek(fp, RecordOffset(first), SEEK_SET) != 0
+            || fread(buf, RecordSize, n, fp) != (size_t)n)
+            n = 0;
+        for (i = 0; i < n; ++i)
+            getRecord(buf + (size_t)i * RecordSize, &out[i]);
+        free(buf);
     }
 
-    return head->next;
+    fclose(fp);
+    return n;
 }
 
 
 /*
  * 函数名：saveRecord
  * -------------
- * 向排行榜存入一个分数
- * 参数类型：char* 玩家名，int 玩家分数
- * 返回类型：int，代表保存是否成功
- *          成功，返回 SUCCESS
+ * 向排行榜存入一个分数：提交写入任务后立即返回，由写入线程插入
+ * 参数类型：char* 玩家名，int 玩家分数，tetSaveDone 完成通知
+ * 返回类型：int，代表是否已提交
+ *          已提交，返回 SUCCESS
  *          失败，返回 FAILURE
  *          （这两个宏定义于fileIO.h）
  */
-int saveRecord(char* name, int score)
+int saveRecord(char* name, int score, tetSaveDone done)
 {
-    // 游戏分数记录路径为 saves 目录下的 records 文件
-    static char* recordFile = "saves\\records";
-    // 读取之前的排行榜数据
-    tetRecord* original = loadRecords();
-
-    FILE* fp = fopen(recordFile, "w");
+    tetSaveJob* job = NewPointer(tetSaveJob);
 
-    // 创建文件失败
-    if (fp == NULL)
+    if (job == NULL)
         return FAILURE;
 
-    // 如果之前无数据，则直接存入
-    if (original == NULL)
+    job->done = done;
+    strncpy(job->name, name, NAMELEN - 1);
+    job->name[NAMELEN - 1] = '\0';
+    job->score = score;
+
+    if (!submitWrite(writeRecordJob, recordJobDone, job))
     {
-        fprintf(fp, "%s %d\n", name, score);
-        fclose(fp);
-        return SUCCESS;
+        free(job);
+        return FAILURE;
     }
-    // 之前有数据，则插入到合适的位置
-    else
-    {
-        // 标记待写入记录是否已存入
-        int flagSaved = 0;
-        tetRecord* current = original;
-        while (current != NULL)
-        {
-            // 如果待写入数据已写入，或当前位置不适合，则写入原有记录
-            if (flagSaved || current->score > score)
-            {
-                fprintf(fp, "%s %d\n", current->name, current->score);
-                current = current->next;
-            }
-            // 到达合适的位置，写入待存数据（分数相同时后来者居上）
-            else
-            {
-                fprintf(fp, "%s %d\n", name, score);
-                flagSaved = 1;
-            }
-        }
-        // 如果原有数据已全部写入，但待存数据仍未写入
-        // 即待存数据为最后一名的情况
-        if (flagSaved == 0)
-            fprintf(fp, "%s %d\n", name, score);
+    return SUCCESS;
+}
+
+/*
+ * 函数名：getRank
+ * -------------
+ * 分数 score 在排行榜中的名次：同分时后来者居上，即比它高的分数的个数加1
+ * 由内存中的名次索引查询；尚未建立时提交给写入线程建立，在此之前在文件中二分查找，
+ * 界面线程不必等待读入整个文件
+ * 参数类型：int 分数
+ * 返回类型：int，名次（1起）
+ */
+int getRank(int score)
+{
+    uint32_t total, pos = 0;
+
+    if (boardLoaded)
+        return rankAbove(&board, score) + 1;
+    requestBoard();
 
+    FILE* fp = readBoard(&total);
+    if (fp != NULL)
+    {
+        if (!findRank(fp, total, score, &pos))
+            pos = 0;
         fclose(fp);
-        return SUCCESS;
     }
+    return (int)pos + 1;
+}
+
+/*
+ * 函数名：getRecordCount
+ * -------------
+ * 排行榜中的记录数：名次索引已建立时即其大小，否则读出排行榜文件头部的记录数
+ * 返回类型：int，记录数
+ */
+int getRecordCount()
+{
+    uint32_t total = 0;
+
+    if (boardLoaded)
+        return rankSize(&board);
+
+    FILE* fp = readBoard(&total);
+    if (fp == NULL)
+        return 0;
+    fclose(fp);
+    return (int)total;
 }
 
 /*
  * 函数名：loadGame
  * -------------
- * 读取一个玩家的游戏存档
- * 参数类型：char* 玩家名
+ * 读取一个玩家的游戏存档到游戏 g 中
+ * 依次校验文件头、版本号、长度及校验和，再解码快照，任何一步不符即读取失败
+ * 参数类型：tetGame* 游戏上下文，char* 玩家名
  * 返回类型：int，代表读取是否成功
  *          成功，返回 SUCCESS
  *          失败，返回 FAILURE
  *          （这两个宏定义于fileIO.h）
  */
-int loadGame(char* username)
+int loadGame(tetGame* g, char* username)
 {
     // 存档路径为 saves 目录下的 $(用户名).save 文件
-    static char filename[18];
-    sprintf(filename, "saves\\%s.save", username);
+    char filename[32];
+    sprintf(filename, "saves" PathSep "%s.save", username);
 
     // 以二进制读取方式打开文件
     FILE* fp = fopen(filename, "rb");
@@ -193,80 +220,557 @@ int loadGame(char* username)
     if (fp == NULL)
         return FAILURE;
 
-    // 定义exception：无效或已损坏存档
-    exception InvalidFormat;
-    try
-    {
-        // 读入已落下的方块堆
-        SafeRead(&stored, (MaxCoordY+1)*(MaxCoordX+1)*sizeof(tetBoard), 1, fp);
-
-        SafeRead(&falling,   sizeof(tetBlock), 1, fp);  // 读入正在下落的方块信息
-        SafeRead(&nextBlock, sizeof(tetBlock), 1, fp);  // 读入即将下落的方块信息
-        SafeRead(&holdBlock, sizeof(tetBlock), 1, fp);  // 读入暂存的方块信息
+    // 多读1字节，以发现超出最大长度的文件
+    unsigned char buf[SaveMaxSize + 1];
+    size_t size = fread(buf, 1, sizeof(buf), fp);
+    fclose(fp);
 
-        SafeRead(&speed, sizeof(int), 1, fp);  // 读入游戏速度
-        SafeRead(&score, sizeof(int), 1, fp);  // 读入游戏分数
-        SafeRead(&level, sizeof(int), 1, fp);  // 读入游戏难度等级
-        SafeRead(&lines, sizeof(int), 1, fp);  // 读入已消除行数
+    const unsigned char* p   = buf;
+    const unsigned char* end = buf + size;
 
-        // 读入hold状态
-        SafeRead(&OnHolding,     sizeof(bool), 1, fp);
-        SafeRead(&OnRelease,     sizeof(bool), 1, fp);
-        SafeRead(&delayOneRound, sizeof(bool), 1, fp);
+    // 文件头、版本号及长度：头部、快照字节数、快照及校验和须恰好占满文件
+    if (size > SaveMaxSize || size < 11 || memcmp(p, SaveMagic, 4) != 0 || p[4] != SaveVersion
+        || p[5] > RAND_BAG || p[6] > ReplayKeyMax || (size_t)p[6] + 11 != size)
+        return FAILURE;
 
-    // 处理存档格式错误
-    except(InvalidFormat)
-        fclose(fp);
+    // 校验和
+    uint32_t crc = (uint32_t)end[-4] | (uint32_t)end[-3] << 8 | (uint32_t)end[-2] << 16 | (uint32_t)end[-1] << 24;
+    if (crc32(buf, size - 4) != crc)
         return FAILURE;
-    } endtry
 
-    fclose(fp);
+    // 先解码到临时的游戏上下文中，成功后才覆盖 g
+    // 避免损坏的存档破坏当前游戏
+    tetGame loaded;
+    if (!unpackSnapshot(p + 7, p[6], &loaded) || loaded.over)
+        return FAILURE;
+    loaded.random.mode = (tetRandMode)p[5];
+
+    // 帧数、下落与落定的累计量及自动重复的状态不存档，读档后从头计
+    loaded.frame     = 0;
+    loaded.gravity   = 0;
+    loaded.lockTicks = 0;
+    loaded.das       = DefaultDAS;
+    loaded.arr       = DefaultARR;
+    loaded.shiftHeld = 0;
+    loaded.shiftDir  = 0;
+    loaded.shiftWait = 0;
+    *g = loaded;
     return SUCCESS;
 }
 
 /*
  * 函数名：saveGame
  * -------------
- * 保存玩家的游戏存档
- * 参数类型：char* 玩家名
- * 返回类型：int，代表保存是否成功
- *          成功，返回 SUCCESS
+ * 将游戏 g 保存为玩家的游戏存档
+ * 先在内存中编码完整个存档（之后 g 可以继续改变），再提交写入任务，立即返回
+ * 参数类型：const tetGame* 游戏上下文，char* 玩家名，tetSaveDone 完成通知
+ * 返回类型：int，代表是否已提交
+ *          已提交，返回 SUCCESS
  *          失败，返回 FAILURE
  *          （这两个宏定义于fileIO.h）
  */
-int saveGame(char* username)
+int saveGame(const tetGame* g, char* username, tetSaveDone done)
 {
+    tetSaveJob* job = NewPointer(tetSaveJob);
+
+    if (job == NULL)
+        return FAILURE;
+
     // 存档路径为 saves 目录下的 $(用户名).save 文件
-    static char filename[18];
-    sprintf(filename, "saves\\%s.save", username);
+    job->done = done;
+    snprintf(job->path, sizeof(job->path), "saves" PathSep "%s.save", username);
+
+    // 头部：文件头、版本号、方块序列生成模式
+    unsigned char* buf = job->data;
+    memcpy(buf, SaveMagic, 4);
+    buf[4] = SaveVersion;
+    buf[5] = (unsigned char)g->random.mode;
+
+    // 快照及其字节数
+    int len = packSnapshot(g, buf + 7);
+    buf[6] = (unsigned char)len;
+
+    // 校验和
+    size_t size = 7 + len;
+    uint32_t crc = crc32(buf, size);
+    int i;
+    for (i = 0; i < 4; ++i)
+        buf[size++] = (unsigned char)(crc >> (8 * i));
+    job->size = size;
+
+    if (!submitWrite(writeGameJob, saveJobDone, job))
+    {
+        free(job);
+        return FAILURE;
+    }
+    return SUCCESS;
+}
 
-    // 创建目录saves，如果存在则什么都不做
-    mkdir("saves");
+/* （内部函数）
+ * 函数名：writeRecordJob
+ * -------------
+ * 写入任务：向排行榜插入一个分数（分数相同时后来者居上）
+ * 二分查找插入位置，只读出其后的记录，与新记录一起一次写回（即后移一条），再改写头部的记录数
+ * 写回前先把要写的内容记入日志文件，写回并写到磁盘后才删去日志；
+ * 写回中途崩溃时，下次插入前由日志重做，排行榜不会损坏
+ */
+bool writeRecordJob(void* arg)
+{
+    const tetSaveJob* job = arg;
+    tetRecord rec;
+    uint32_t total;
 
-    // 以二进制写入方式打开文件
-    FILE* fp = fopen(filename, "wb");
+    // 创建目录saves，如果存在则什么都不做
+    platMakeDir("saves");
+    if (!redoJournal())
+        return false;
 
-    // 文件打开失败
+    // 排行榜文件无效时写入失败，保留原文件，不以新文件覆盖
+    FILE* fp = openBoard(RecordFile, "r+b", &total);
     if (fp == NULL)
-        return FAILURE;
+    {
+        if (!boardMissing() || !createBoard())
+            return false;
+        fp = openBoard(RecordFile, "r+b", &total);
+        if (fp == NULL)
+            return false;
+    }
 
-    // 保存已落下的方块堆
-    fwrite(&stored, (MaxCoordY+1)*(MaxCoordX+1)*sizeof(tetBoard), 1, fp);
+    uint32_t lo;
+    if (!findRank(fp, total, job->score, &lo))
+    {
+        fclose(fp);
+        return false;
+    }
+
+    // 日志：头部（"TJNL"，插入位置，插入后的记录数），新记录及其后原有的各条记录
+    size_t tail = (size_t)(total - lo) * RecordSize;
+    unsigned char* journal = malloc(JournalHeadSize + RecordSize + tail);
+    bool ok = journal != NULL;
+    if (ok)
+    {
+        memcpy(journal, JournalMagic, 4);
+        putUint32(journal + 4, lo);
+        putUint32(journal + 8, total + 1);
+
+        strcpy(rec.name, job->name);
+        rec.score = job->score;
+        putRecord(journal + JournalHeadSize, &rec);
+
+        ok = fseek(fp, RecordOffset(lo), SEEK_SET) == 0
+          && fread(journal + JournalHeadSize + RecordSize, 1, tail, fp) == tail
+          && writeFileAtomic(JournalFile, journal, JournalHeadSize + RecordSize + tail)
+          && applyJournal(fp, journal, JournalHeadSize + RecordSize + tail);
+    }
+
+    free(journal);
+    if (fclose(fp) != 0)
+        ok = false;
+    // 写回完成，日志不再需要；写回失败则保留日志，留待下次重做
+    if (ok)
+        remove(JournalFile);
+    return ok;
+}
+
+/* （内部函数）
+ * 函数名：findRank
+ * -------------
+ * 在排行榜文件中二分查找第一个分数不高于 score 的名次（0起），即比它高的分数的个数
+ * 每步只定位并读出一条记录，共 O(log n) 次读取
+ */
+bool findRank(FILE* fp, uint32_t total, int score, uint32_t* pos)
+{
+    uint32_t lo = 0, hi = total, mid;
+    unsigned char buf[RecordSize];
+    tetRecord rec;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (fseek(fp, RecordOffset(mid), SEEK_SET) != 0 || fread(buf, RecordSize, 1, fp) != 1)
+            return false;
+        getRecord(buf, &rec);
+        if (rec.score <= score)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    *pos = lo;
+    return true;
+}
 
-    fwrite(&falling,   sizeof(tetBlock), 1, fp);  // 保存正在下落的方块信息
-    fwrite(&nextBlock, sizeof(tetBlock), 1, fp);  // 保存即将下落的方块信息
-    fwrite(&holdBlock, sizeof(tetBlock), 1, fp);  // 保存暂存的方块信息
+/* （内部函数）
+ * 函数名：requestBoard
+ * -------------
+ * 名次索引既未建立、也不在建立中时，提交建立索引的写入任务，并让界面定期取得完成通知
+ * 写入任务按提交的顺序执行、通知：之前提交的分数记录已在文件中，
+ * 之后提交的分数记录则在索引建立后的通知中加入索引，两者都不会重复或遗漏
+ */
+void requestBoard()
+{
+    if (boardLoaded || boardLoading)
+        return;
 
-    fwrite(&speed, sizeof(int), 1, fp);  // 保存游戏速度
-    fwrite(&score, sizeof(int), 1, fp);  // 保存游戏分数
-    fwrite(&level, sizeof(int), 1, fp);  // 保存游戏难度等级
-    fwrite(&lines, sizeof(int), 1, fp);  // 保存已消除行数
+    tetRankTree* t = NewPointer(tetRankTree);
+    if (t == NULL)
+        return;
+    if (!submitWrite(buildBoardJob, boardBuilt, t))
+    {
+        free(t);
+        return;
+    }
+    boardLoading = true;
+    watchWrites();
+}
 
-    // 保存hold状态
-    fwrite(&OnHolding,     sizeof(bool), 1, fp);
-    fwrite(&OnRelease,     sizeof(bool), 1, fp);
-    fwrite(&delayOneRound, sizeof(bool), 1, fp);
+/* （内部函数）
+ * 函数名：buildBoardJob
+ * -------------
+ * 写入任务：由排行榜文件建立名次索引（按块顺序读出各条记录，逐个加入分数）
+ * 先按日志重做未完成的插入，使索引与之后的文件一致；
+ * 没有排行榜文件时先新建（导入旧版本的记录），与存入分数时相同；
+ * 文件无效时建立失败，保留原文件，名次仍由文件中的二分查找得到
+ */
+bool buildBoardJob(void* arg)
+{
+    tetRankTree* t = arg;
+    unsigned char buf[RankLoadBlock * RecordSize];
+    uint32_t total, done = 0;
+    size_t i, n;
+    tetRecord rec;
+
+    platMakeDir("saves");
+    if (!redoJournal())
+        return false;
+
+    FILE* fp = openBoard(RecordFile, "rb", &total);
+    if (fp == NULL && boardMissing() && createBoard())
+        fp = openBoard(RecordFile, "rb", &total);
+    if (fp == NULL)
+        return false;
 
+    bool ok = initRankTree(t) && fseek(fp, RecordOffset(0), SEEK_SET) == 0;
+    while (ok && done < total)
+    {
+        n = total - done < RankLoadBlock ? total - done : RankLoadBlock;
+        ok = fread(buf, RecordSize, n, fp) == n;
+        for (i = 0; ok && i < n; ++i)
+        {
+            getRecord(buf + i * RecordSize, &rec);
+            ok = rankInsert(t, rec.score);
+        }
+        done += n;
+    }
     fclose(fp);
-    return SUCCESS;
-}
\ No newline at end of file
+
+    if (!ok)
+        freeRankTree(t);
+    return ok;
+}
+
+/* （内部函数）
+ * 函数名：boardBuilt
+ * -------------
+ * 建立索引完成：成功则开始使用，失败则下次查询名次时重新提交
+ */
+void boardBuilt(bool ok, void* arg)
+{
+    tetRankTree* t = arg;
+
+    boardLoading = false;
+    if (ok)
+    {
+        board       = *t;
+        boardLoaded = true;
+    }
+    free(t);
+}
+
+/* （内部函数）
+ * 函数名：openBoard
+ * -------------
+ * 以 mode 打开排行榜文件，校验头部（文件头、版本号、记录长度，记录数不超过文件长度），
+ * 读出记录数；文件不存在或无效时返回 NULL
+ */
+FILE* openBoard(const char* path, const char* mode, uint32_t* total)
+{
+    unsigned char head[RecordSize];
+
+    FILE* fp = fopen(path, mode);
+    if (fp == NULL)
+        return NULL;
+
+    if (fread(head, RecordSize, 1, fp) != 1 || memcmp(head, RecordMagic, 4) != 0
+        || head[4] != RecordVersion || head[5] != RecordSize || fseek(fp, 0, SEEK_END) != 0)
+    {
+        fclose(fp);
+        return NULL;
+    }
+
+    *total = getUint32(head + 8);
+    long size = ftell(fp);
+    if (size < 0 || (uint64_t)size < (uint64_t)RecordOffset(*total))
+    {
+        fclose(fp);
+        return NULL;
+    }
+    return fp;
+}
+
+/* （内部函数）
+ * 函数名：readBoard
+ * -------------
+ * 以只读方式打开排行榜文件；还没有排行榜文件而有旧版本的文本记录文件时，
+ * 提交建立索引的写入任务，由写入线程导入（记录可能很多，不在界面线程中解析、写入），
+ * 这样升级后第一次存入分数之前，排行榜及名次也与原有记录一致；导入完成之前返回 NULL
+ */
+FILE* readBoard(uint32_t* total)
+{
+    FILE* fp = openBoard(RecordFile, "rb", total);
+    if (fp != NULL || !boardMissing())
+        return fp;
+
+    FILE* legacy = fopen(LegacyRecordFile, "r");
+    if (legacy != NULL)
+    {
+        fclose(legacy);
+        requestBoard();
+    }
+    return NULL;
+}
+
+/* （内部函数）
+ * 函数名：boardMissing
+ * -------------
+ * 排行榜文件是否不存在；存在而无效（如被截断、版本更新）时返回 false，
+ * 只有不存在时才可新建，不能覆盖无效的文件
+ */
+bool boardMissing()
+{
+    FILE* fp = fopen(RecordFile, "rb");
+    if (fp != NULL)
+    {
+        fclose(fp);
+        return false;
+    }
+    return errno == ENOENT;
+}
+
+/* （内部函数）
+ * 函数名：createBoard
+ * -------------
+ * 新建空的排行榜文件；若有旧版本的文本记录文件（每行玩家名及分数，已按分数排好），
+ * 则将其中的记录一并导入；内存不足、无法全部导入时不建立，旧文件保持原样
+ */
+bool createBoard()
+{
+    unsigned char* data = calloc(1, RecordSize);
+    size_t used = RecordSize, cap = RecordSize;
+    uint32_t total = 0;
+    tetRecord rec;
+
+    FILE* fp = fopen(LegacyRecordFile, "r");
+    while (data != NULL && fp != NULL && fscanf(fp, "%10s %d", rec.name, &rec.score) == 2)
+    {
+        if (used == cap)
+        {
+            unsigned char* grown = realloc(data, cap * 2);
+            // 只导入一部分则其余的记录再也不会导入，不如不建立，留待下次
+            if (grown == NULL)
+            {
+                free(data);
+                data = NULL;
+                break;
+            }
+            data = grown;
+            cap *= 2;
+        }
+        putRecord(data + used, &rec);
+        used += RecordSize;
+        total++;
+    }
+    if (fp != NULL)
+        fclose(fp);
+    if (data == NULL)
+        return false;
+
+    memcpy(data, RecordMagic, 4);
+    data[4] = RecordVersion;
+    data[5] = RecordSize;
+    putUint32(data + 8, total);
+
+    bool ok = writeFileAtomic(RecordFile, data, used);
+    free(data);
+    return ok;
+}
+
+/* （内部函数）
+ * 函数名：redoJournal
+ * -------------
+ * 若上次插入留下了日志（写回中途崩溃或失败），则按日志重做写回并删去日志
+ * 日志由 writeFileAtomic 写出，存在即是完整的；重做与写回相同，重复进行也不影响结果
+ * 排行榜文件已不存在时，日志所指的位置不再有意义，删去日志，不会重做到新建的文件上
+ */
+bool redoJournal()
+{
+    uint32_t total;
+
+    FILE* jp = fopen(JournalFile, "rb");
+    if (jp == NULL)
+        return true;
+
+    unsigned char* journal = NULL;
+    long size = -1;
+    if (fseek(jp, 0, SEEK_END) == 0 && (size = ftell(jp)) >= JournalHeadSize + RecordSize
+        && (journal = malloc(size)) != NULL && fseek(jp, 0, SEEK_SET) == 0)
+    {
+        if (fread(journal, 1, size, jp) != (size_t)size)
+            size = -1;
+    }
+    fclose(jp);
+
+    bool ok = false;
+    FILE* fp = openBoard(RecordFile, "r+b", &total);
+    if (fp == NULL && boardMissing())
+    {
+        ok = true;
+    }
+    else if (fp != NULL)
+    {
+        ok = journal != NULL && size > 0 && applyJournal(fp, journal, size);
+        if (fclose(fp) != 0)
+            ok = false;
+    }
+    free(journal);
+
+    if (ok)
+        remove(JournalFile);
+    return ok;
+}
+
+/* （内部函数）
+ * 函数名：applyJournal
+ * -------------
+ * 按日志写回：在插入位置一次写入新记录及其后的各条记录，再改写记录数，最后写到磁盘
+ * 日志无效时返回 false，不写入
+ */
+bool applyJournal(FILE* fp, const unsigned char* journal, size_t size)
+{
+    uint32_t pos   = getUint32(journal + 4);
+    uint32_t total = getUint32(journal + 8);
+    unsigned char count[4];
+
+    if (memcmp(journal, JournalMagic, 4) != 0 || (size - JournalHeadSize) % RecordSize != 0
+        || pos + (size - JournalHeadSize) / RecordSize != total)
+        return false;
+
+    putUint32(count, total);
+    return fseek(fp, RecordOffset(pos), SEEK_SET) == 0
+        && fwrite(journal + JournalHeadSize, 1, size - JournalHeadSize, fp) == size - JournalHeadSize
+        && fseek(fp, 8, SEEK_SET) == 0
+        && fwrite(count, 4, 1, fp) == 1
+        && platSyncFile(fp);
+}
+
+/* （内部函数）
+ * 函数名：putRecord / getRecord
+ * -------------
+ * 一条记录的定长编码：分数（4字节，小端），玩家名（12字节，不足以0补齐）
+ */
+void putRecord(unsigned char* p, const tetRecord* r)
+{
+    putUint32(p, (uint32_t)r->score);
+    memset(p + 4, 0, RecordSize - 4);
+    memcpy(p + 4, r->name, strnlen(r->name, NAMELEN - 1));
+}
+
+void getRecord(const unsigned char* p, tetRecord* r)
+{
+    r->score = (int)getUint32(p);
+    memcpy(r->name, p + 4, NAMELEN - 1);
+    r->name[NAMELEN - 1] = '\0';
+}
+
+/* （内部函数）
+ * 函数名：putUint32 / getUint32
+ * -------------
+ * 4字节小端整数的写入 / 读出
+ */
+void putUint32(unsigned char* p, uint32_t v)
+{
+    int i;
+    for (i = 0; i < 4; ++i)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+uint32_t getUint32(const unsigned char* p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/* （内部函数）
+ * 函数名：writeGameJob
+ * -------------
+ * 写入任务：写出已编码好的游戏存档
+ */
+bool writeGameJob(void* arg)
+{
+    const tetSaveJob* job = arg;
+
+    // 创建目录saves，如果存在则什么都不做
+    platMakeDir("saves");
+    return writeFileAtomic(job->path, job->data, job->size);
+}
+
+/* （内部函数）
+ * 函数名：saveJobDone
+ * -------------
+ * 完成通知：转为 SUCCESS / FAILURE 通知调用者，并释放任务
+ */
+void saveJobDone(bool ok, void* arg)
+{
+    tetSaveJob* job = arg;
+
+    if (job->done != NULL)
+        job->done(ok ? SUCCESS : FAILURE);
+    free(job);
+}
+
+/* （内部函数）
+ * 函数名：recordJobDone
+ * -------------
+ * 分数记录写入完成：名次索引已建立时，写入成功则把分数也加入索引；
+ * 写入失败时该记录可能已记入日志，下次插入前会被重做，索引无从得知，只能作废，留待重新建立
+ */
+void recordJobDone(bool ok, void* arg)
+{
+    const tetSaveJob* job = arg;
+
+    if (boardLoaded && !(ok && rankInsert(&board, job->score)))
+    {
+        freeRankTree(&board);
+        boardLoaded = false;
+    }
+    saveJobDone(ok, arg);
+}
+
+/* （内部函数）
+ * 函数名：crc32
+ * -------------
+ * 计算 data 起 size 字节的 CRC32（多项式 0xEDB88320，与 zlib 相同）
+ * 存档只有几十字节，逐位计算即可，不需要查表
+ */
+uint32_t crc32(const unsigned char* data, size_t size)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    size_t i;
+    int k;
+
+    for (i = 0; i < size; ++i)
+    {
+        crc ^= data[i];
+        for (k = 0; k < 8; ++k)
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
@@ -8,11 +8,33 @@
  *      排行榜分数 读取/写入函数声明
  *      多游戏存档 读取/写入函数声明
  *
+ * 游戏存档格式（与编译器的结构布局无关）：
+ *      头部   - "TSAV"，版本号（1字节），方块序列生成模式（1字节）
+ *      快照   - 字节数（1字节），快照（格式见 replay.h：分数等计数为 varint，
+ *               方块堆为占用位平面及各被占用格的3位颜色）
+ *      校验和 - 以上全部字节的 CRC32（4字节，小端）
+ * 一个存档通常不足100字节，至多 SaveMaxSize 字节
+ *
+ * 排行榜文件格式（saves/leaderboard，各条记录定长，按分数从高到低排列）：
+ *      头部   - "TREC"，版本号（1字节），记录字节数（1字节），补0（2字节），
+ *               记录数（4字节，小端），补0（4字节），共 RecordSize 字节
+ *      记录   - 分数（4字节，小端），玩家名（12字节，不足以0补齐），第 i 名（0起）位于 RecordSize*(i+1)
+ * 插入只需二分查找位置，并把其后的记录一次写回；读入前几名只需一次定位、一次读取，
+ * 记录数达到几十万条时仍然如此。旧版本的文本记录文件 saves/records 在第一次读取或插入时
+ * 由写入线程导入。排行榜文件只在不存在时新建；存在而无效时保持原样，存入分数失败
+ *
+ * 名次查询：按名次取记录（及任意一段名次的分页读取）由排行榜文件直接定位；
+ * 某分数的名次由内存中的名次索引（各分数的顺序统计树，见 rank.h）O(log n) 查得，
+ * 索引在第一次查询时交给写入线程由排行榜文件建立，之后随每次存入的分数更新；
+ * 建立完成之前，名次由排行榜文件中的二分查找得到，同样是 O(log n)
+ *
+ *
  * 外部接口：
  *      排行榜分数处理函数：
- *          freeRecords
  *          loadRecords
  *          saveRecord
+ *          getRank
+ *          getRecordCount
  *      游戏存档处理函数：
  *          loadGame
  *          saveGame
@@ -21,107 +43,144 @@
 #ifndef FILEIO_H
 #define FILEIO_H
 
+#include "tetris.h"  // 需要取得游戏上下文声明
+#include "replay.h"  // 需要取得快照的最大字节数
+
 #define NAMELEN 11  // 用户名长度限制为10
 
 #define SUCCESS  1  // 文件IO处理结果定义
 #define FAILURE  0
 
-typedef struct tetRecord tetRecord;
+#define SaveMagic   "TSAV"  // 游戏存档的文件头及版本号
+#define SaveVersion 1
 
-// 分数记录链表结构
-struct tetRecord
-{
-  char       name[NAMELEN]; // 用户名
-  int        score; // 分数
-  tetRecord* next;
-};
+#define RecordMagic   "TREC"  // 排行榜文件的文件头、版本号，及头部、每条记录的字节数
+#define RecordVersion 1
+#define RecordSize    16
 
+// 游戏存档的最大字节数：头部6字节，快照字节数1字节，快照，校验和4字节
+#define SaveMaxSize (6 + 1 + ReplayKeyMax + 4)
 
-/*
- * 函数名称：freeRecords
- * 函数原型：void freeRecords(tetRecord* rec)
- * 功能描述：释放传入的排行榜分数链表
- * 副作用？：改变传入指针指向的内存块
- *
- * 参数描述：待释放链表头结点指针 rec :: tetRecord*
-          （结构tetRecord定义见本文件）
- * 返回类型：无
- * --------------
- * 使用方法：freeRecords(yourRecordsPtr);
- */
-void freeRecords(tetRecord* rec);
+// 保存（分数记录或游戏存档）完成通知，result 为 SUCCESS 或 FAILURE
+typedef void (*tetSaveDone)(int result);
+
+// 分数记录结构
+typedef struct {
+  char name[NAMELEN]; // 用户名
+  int  score;         // 分数
+} tetRecord;
 
 
 /*
  * 函数名称：loadRecords
- * 函数原型：tetRecord* loadRecords()
- * 功能描述：读入所有排行榜分数，返回第一个记录结点
- *         | 无记录数据则返回NULL
- *         | 记录文件为 saves/records
- * 副作用？：引起磁盘读取
+ * 函数原型：int loadRecords(tetRecord* out, int first, int count)
+ * 功能描述：读入排行榜中名次 first 起的至多 count 条记录，按分数从高到低存入 out
+ *         | 无记录数据或记录文件无效则返回0
+ *         | 记录文件为 saves/leaderboard
+ * 副作用？：引起磁盘读取，改变 out
  *
- * 参数描述：无
- * 返回类型：tetRecord*，分数记录的头结点指针
+ * 参数描述：输出 out :: tetRecord*，至少 count 条的空间
+ *          （结构tetRecord定义见本文件）
+ *         起始名次 first :: int，0 为第一名
+ *         条数 count :: int
+ * 返回类型：int，读入的条数
  * --------------
- * 使用方法：tetRecord* recPtr = loadRecords();
+ * 使用方法：int n = loadRecords(yourRecords, 0, 10);
+ *          第 rank 名的分数：if (loadRecords(&rec, rank - 1, 1) == 1) ... rec.score
  */
-tetRecord* loadRecords();
+int loadRecords(tetRecord* out, int first, int count);
 
 
 /*
  * 函数名称：saveRecord
- * 函数原型：int saveRecord(char* name, int score)
- * 功能描述：向排行榜存入一个分数
- *         | 记录文件为 saves/records
- * 副作用？：引起磁盘写入
+ * 函数原型：int saveRecord(char* name, int score, tetSaveDone done)
+ * 功能描述：向排行榜存入一个分数，在后台写入（见 writer.h），立即返回
+ *         | 记录文件为 saves/leaderboard，写入中途崩溃时，下次写入前可由日志恢复
+ *         | 写入完成后，在调用 pollWrites 的线程中调用 done(SUCCESS 或 FAILURE)
+ * 副作用？：之后引起磁盘写入
  *
  * 参数描述：玩家名  name :: char*
  *         玩家分数 score :: int
- * 返回类型：int，代表保存是否成功
- *          成功，返回 SUCCESS
- *          失败，返回 FAILURE
+ *         完成通知 done :: tetSaveDone，可为 NULL
+ * 返回类型：int，代表是否已提交
+ *          已提交，返回 SUCCESS
+ *          失败，返回 FAILURE（此时不会通知）
  *          （宏定义见本文件）
  * --------------
- * 使用方法：int savedOrNot = saveRecord(username, score);
+ * 使用方法：if (saveRecord(username, score, yourDone) == SUCCESS) ...
  */
-int saveRecord(char* name, int score);
+int saveRecord(char* name, int score, tetSaveDone done);
+
+
+/*
+ * 函数名称：getRank
+ * 函数原型：int getRank(int score)
+ * 功能描述：分数 score 存入排行榜时将得到的名次（同分时后来者居上），O(log n)
+ *         | 第一次调用时提交建立名次索引的写入任务（见 writer.h），不等待其完成
+ * 副作用？：可能引起磁盘读取
+ *
+ * 参数描述：分数 score :: int
+ * 返回类型：int，名次，1 为第一名
+ * --------------
+ * 使用方法：int rank = getRank(getScore(getGame()));
+ */
+int getRank(int score);
+
+
+/*
+ * 函数名称：getRecordCount
+ * 函数原型：int getRecordCount()
+ * 功能描述：排行榜中的记录数
+ * 副作用？：名次索引尚未建立时引起磁盘读取
+ *
+ * 参数描述：无
+ * 返回类型：int，记录数
+ * --------------
+ * 使用方法：int total = getRecordCount();
+ */
+int getRecordCount();
 
 
 /*
  * 函数名称：loadGame
- * 函数原型：int loadGame(char* username)
- * 功能描述：读取一个玩家的游戏存档，自带错误处理
+ * 函数原型：int loadGame(tetGame* g, char* username)
+ * 功能描述：读取一个玩家的游戏存档到游戏 g 中，自带错误处理
  *         | 存档目录为 saves/
  *         | 文件名为 $(username).save
- * 副作用？：引起磁盘读取、引起游戏状态及数据的改变
+ *         | 文件头、版本号、校验和不符，或快照无效时读取失败，游戏 g 保持不变
+ * 副作用？：引起磁盘读取、引起游戏 g 的数据改变
  *
- * 参数描述：玩家名 name :: char*
+ * 参数描述：游戏上下文 g :: tetGame*
+ *         玩家名 name :: char*
  * 返回类型：int，代表读取结果
  *          成功       返回 SUCCESS
  *          读取失败    返回 FAILURE
  *          （宏定义见本文件）
  * --------------
- * 使用方法：int loadedOrNot = loadGame(username);
+ * 使用方法：int loadedOrNot = loadGame(yourGame, username);
  */
-int loadGame(char* username);
+int loadGame(tetGame* g, char* username);
 
 
 /*
  * 函数名称：saveGame
- * 函数原型：int saveGame(char* username)
- * 功能描述：保存玩家的游戏存档
+ * 函数原型：int saveGame(const tetGame* g, char* username, tetSaveDone done)
+ * 功能描述：将游戏 g 保存为玩家的游戏存档，立即编码，在后台写入（见 writer.h）
  *         | 存档目录为 saves/
- *         | 文件名为 $(username).save
- * 副作用？：引起磁盘写入
+ *         | 文件名为 $(username).save，写入中途崩溃时原有存档不受影响
+ *         | 写入完成后，在调用 pollWrites 的线程中调用 done(SUCCESS 或 FAILURE)
+ * 副作用？：之后引起磁盘写入
  *
- * 参数描述：玩家名 name :: char*
- * 返回类型：int，代表写入是否成功
- *          成功，返回 SUCCESS
- *          失败，返回 FAILURE
+ * 参数描述：游戏上下文 g :: const tetGame*（返回后即可继续改变）
+ *         玩家名 name :: char*
+ *         完成通知 done :: tetSaveDone，可为 NULL
+ * 返回类型：int，代表是否已提交
+ *          已提交，返回 SUCCESS
+ *          失败，返回 FAILURE（此时不会通知）
  *          （宏定义见本文件）
  * --------------
- * 使用方法：int savedOrNot = saveGame(username);
+ * 使用方法：if (saveGame(yourGame, username, yourDone) == SUCCESS) ...
  */
-int saveGame(char* username);
+int saveGame(const tetGame* g, char* username, tetSaveDone done);
 
 #endif
\ No newline at end of file
@@ -4,46 +4,79 @@
  * 概览：流程控制模块
  * -------------
  * 负责功能：流程控制，包括
- *      计时器的控制（下落速度）
+ *      固定步长的游戏逻辑（下落、落定延迟）及驱动它的界面计时器
  *      游戏数据更新（速度、分数等）
  *      游戏状态控制（暂停、继续、重来、结束等）
  *      游戏进程控制（方块暂存/释放、难度提升、开启下一轮等）
+ *      界面上的游戏的回放记录
+ *      界面上的游戏的撤销与重做
  */
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include "layout.h"  // 需要取得方块堆大小
 #include "tetris.h"  // 需要取得方块结构定义
+#include "platform.h" // 需要通过平台接口控制计时器、刷新界面
 #include "flow.h"    // 本模块
+#include "ai.h"      // 需要由电脑玩家操作界面上的游戏
+#include "input.h"   // 需要输入队列
+#include "replay.h"  // 需要记录回放
+#include "undo.h"    // 需要记录每轮开始时的快照
+#include "writer.h"  // 需要检查后台写入是否完成
 
-// 下落计时器ID
-#define Timer_Fall  1
+#define Min(x,y) ((x)<(y) ? (x):(y))
+#define Max(x,y) ((x)>(y) ? (x):(y))
 
-int speed;  // 游戏速度
-int score;  // 当前分数
-int level;  // 当前难度等级，最高为5
-int lines;  // 已消除的行数
+// 帧计时器ID
+#define Timer_Frame  1
+// 后台写入的完成检查计时器ID，及其时间间隔（毫秒）
+#define Timer_Write  2
+#define WriteInterval 20
 
-// 已落下的方块堆
-tetBoard stored[MaxCoordY+1][MaxCoordX+1];
-tetBlock falling;    // 正在下落的方块
-tetBlock nextBlock;  // 下一个下落方块
-tetBlock holdBlock;  // 当前暂存的方块
+// 帧计时器的时间间隔（毫秒），即界面刷新的最高频率
+// 计时器精度有限，游戏逻辑的帧数由实际经过的时间决定，不依赖于它
+#define FrameInterval  15
 
-bool OnHolding;      // 是否有暂存方块
-bool OnRelease;      // 是否刚释放了暂存方块
-bool delayOneRound;  // 释放暂存方块后需暂停一轮hold功能
+// 界面上显示的那一局游戏
+static tetGame game;
 
 // 刚进入游戏时，状态为打开主菜单
 tetGameStatus GameStatu = ON_MAIN;
 // 保存上一个游戏状态，以供"返回"功能的实现
 tetGameStatus prevStatu;
 
+// 界面上的游戏是否由电脑玩家操作，及电脑玩家的设置
+static bool  autoPlay = false;
+static tetAI bot;
+
+// 界面上的游戏的时间累计：上次推进的时刻，以及尚未推进的时间（秒）
+static double lastTime;
+static double accumulator;
+// 电脑玩家操作时的累计量，与下落累计量相同，满 speed 毫秒操作一次
+static int    botTimer;
+
+// 界面上的游戏的输入队列：窗口的键盘回调放入，帧计时器回调取出
+static tetInputRing inputs;
+
+// 是否为界面上的新游戏记录回放，及界面上的游戏的回放记录器
+static bool recordReplay = false;
+static tetReplayWriter recorder;
+
+// 界面上的游戏每轮开始时的快照，供撤销、重做
+static int         undoDepth = UndoDepth;
+static tetUndoRing history;
+
 // 内部函数声明
-void levelUp();
-void gameOver();
-void TimerFallingEvent(int timerID);
+void levelUp(tetGame* g);
+void gameOver(tetGame* g);
+void TimerEvent(int timerID);
+void TimerFrameEvent(int timerID);
+void startClock();
+bool autoShift(tetGame* g);
+void releaseShift(tetGame* g);
+void startRecording(uint64_t seed);
 
 
 /*
@@ -53,41 +86,175 @@ void TimerFallingEvent(int timerID);
  */
 void initTetris()
 {
-    // 初始化随机数种子，用于随机方块的产生
-    srand((unsigned)time(NULL));
     // 注册计时器回调函数
-    registerTimerEvent(TimerFallingEvent);
+    platRegisterTimer(TimerEvent);
+
+    // 第一次开局或读档时，及改变可撤销的轮数后的第一次，按新的容量为快照分配空间；
+    // 此时开始的是新的一局，原有的快照本就不再需要
+    if (history.slot == NULL || history.depth != undoDepth)
+    {
+        freeUndoRing(&history);
+        initUndoRing(&history, undoDepth);
+    }
 }
 
 /*
- * 函数名：initGameData
+ * 函数名：initGame
  * -------------
- * 初始化游戏数据（分数、难度等级等）
+ * 初始化游戏数据（分数、难度等级等），并生成第一个下落方块
  */
-void initGameData()
+void initGame(tetGame* g, uint64_t seed, tetRandMode mode)
 {
-    speed = 1000; // 初始降落速度为 1格/秒
-    score = 0;
-    level = 1;
-    lines = 0;
-
-    OnHolding     = false;
-    OnRelease     = false;
-    delayOneRound = false;
+    g->speed = 1000; // 初始降落速度为 1格/秒
+    g->score = 0;
+    g->level = 1;
+    g->lines = 0;
+
+    g->OnHolding     = false;
+    g->OnRelease     = false;
+    g->delayOneRound = false;
+    g->over          = false;
+
+    g->frame     = 0;
+    g->gravity   = 0;
+    g->lockTicks = 0;
+
+    g->das       = DefaultDAS;
+    g->arr       = DefaultARR;
+    g->shiftHeld = 0;
+    g->shiftDir  = 0;
+    g->shiftWait = 0;
 
     // 将方块堆置为空
-    memset(&stored[0][0], CELL_EMPTY, sizeof(stored));
+    memset(&g->stored, 0, sizeof(g->stored));
+
+    // 本局的方块序列只由种子和模式决定
+    initRandomizer(&g->random, seed, mode);
+
+    // 生成下一个方块，并开始第一轮
+    geneNext(g);
+    newRound(g);
 }
 
 /*
- * 函数名：TimerFallingEvent
+ * 函数名：getGame
  * -------------
- * 计时器回调函数，下降方块并更新显示
+ * 取得界面上正在显示的那一局游戏
  */
-void TimerFallingEvent(int timerID)
+tetGame* getGame()
 {
-    move(TM_DOWN);
-    display();
+    return &game;
+}
+
+/* （内部函数）
+ * 函数名：TimerEvent
+ * -------------
+ * 计时器回调函数：按计时器ID分派
+ * 后台写入的完成检查计时器在有写入任务时才运行，全部完成后即停止
+ */
+void TimerEvent(int timerID)
+{
+    if (timerID == Timer_Write)
+    {
+        if (pollWrites() == 0)
+            platCancelTimer(Timer_Write);
+    }
+    else
+        TimerFrameEvent(timerID);
+}
+
+/*
+ * 函数名：TimerFrameEvent
+ * -------------
+ * 帧计时器回调函数：按实际经过的时间补足应推进的帧数，
+ * 每推进一帧前，先执行时间戳不晚于该帧的输入事件，
+ * 有变化时才刷新界面，刷新的耗时不影响游戏逻辑的帧数
+ */
+void TimerFrameEvent(int timerID)
+{
+    double now = platNow();
+    bool changed = false;
+    tetInput in;
+    int steps;
+
+    accumulator += now - lastTime;
+    lastTime = now;
+
+    for (steps = 0; accumulator >= 1.0 / TickRate && getGameStatu() == ON_PLAYING; ++steps)
+    {
+        // 卡顿过久，则丢弃来不及推进的时间
+        if (steps == MaxCatchUp)
+        {
+            accumulator = 0;
+            break;
+        }
+        accumulator -= 1.0 / TickRate;
+
+        // 本帧对应的时刻之前发生的输入，连同其早于本帧的时间（1/1000 帧）
+        // 先记录再执行：执行可能导致游戏失败，从而结束记录
+        while (getGameStatu() == ON_PLAYING && peekInput(&inputs, &in)
+               && in.time <= now - accumulator)
+        {
+            int late = (int)((now - accumulator - in.time) * 1000 * TickRate);
+            late = Min(Max(late, 0), 999);
+            popInput(&inputs, &in);
+            recordInput(&recorder, game.frame, in.action, in.release, late);
+            applyAction(&game, in.action, in.release, late);
+            changed = true;
+        }
+        if (getGameStatu() != ON_PLAYING)
+            break;
+
+        if (autoPlay)
+        {
+            game.frame++;
+            botTimer += 1000;
+            if (botTimer >= game.speed * TickRate)
+            {
+                botTimer -= game.speed * TickRate;
+                aiPlay(&bot, &game);
+                changed = true;
+            }
+        }
+        else
+        {
+            if (gameTick(&game))
+                changed = true;
+            recordTick(&recorder, &game);
+        }
+    }
+
+    if (changed)
+        platDisplay();
+}
+
+/* （内部函数）
+ * 函数名：startClock
+ * -------------
+ * 从现在起重新计时并启动帧计时器，之前（如暂停期间）的时间及输入都不计入
+ */
+void startClock()
+{
+    initInputRing(&inputs);
+    lastTime    = platNow();
+    accumulator = 0;
+    platStartTimer(Timer_Frame, FrameInterval);
+}
+
+/* （内部函数）
+ * 函数名：startRecording
+ * -------------
+ * 为刚开始的界面上的游戏新建回放文件，以开局时刻命名；无法新建时本局不记录
+ */
+void startRecording(uint64_t seed)
+{
+    char path[ReplayPathLen];
+    time_t now = time(NULL);
+
+    platMakeDir("saves");
+    platMakeDir("saves" PathSep "replays");
+    strftime(path, sizeof(path), "saves" PathSep "replays" PathSep "%Y%m%d-%H%M%S.rpl", localtime(&now));
+    openReplay(&recorder, path, seed, &game, ReplayKeyEvery);
 }
 
 /*
@@ -101,7 +268,15 @@ void setGameStatu(tetGameStatus gs)
     // 保存上一个状态
     prevStatu = GameStatu;
     GameStatu = gs;
-    display();
+
+    // 回到主菜单，界面上的这局游戏就此结束
+    if (gs == ON_MAIN)
+    {
+        closeReplay(&recorder, &game);
+        clearUndoRing(&history);
+    }
+
+    platDisplay();
 }
 
 /*
@@ -134,7 +309,7 @@ tetGameStatus getPrevStatu()
 void restoreGameStatu()
 {
     GameStatu = prevStatu;
-    display();
+    platDisplay();
 }
 
 /*
@@ -143,9 +318,9 @@ void restoreGameStatu()
  * 当前是否有方块暂存
  * 返回类型：bool
  */
-bool isOnHolding()
+bool isOnHolding(const tetGame* g)
 {
-    return OnHolding;
+    return g->OnHolding;
 }
 
 /*
@@ -154,37 +329,47 @@ bool isOnHolding()
  * 开始下一轮方块下落，同时检测游戏是否失败，
  * 以及处理难度升级的情况
  */
-void newRound()
+void newRound(tetGame* g)
 {
+    // 上一轮的下落方块（落定时即落定的位置），记入快照以便推算撤销后的颜色
+    tetBlock placed = g->falling;
+
     // 即将释放出暂存的方块
-    if (OnRelease && delayOneRound)
+    if (g->OnRelease && g->delayOneRound)
     {
-        falling = holdBlock;
-        delayOneRound = false;
+        g->falling = g->holdBlock;
+        g->delayOneRound = false;
     }
     // 上一轮释放了暂存的方块，解禁hold功能
-    else if (OnRelease)
+    else if (g->OnRelease)
     {
-        falling = nextBlock;
-        OnRelease = false;
-        geneNext();
+        g->falling = g->nextBlock;
+        g->OnRelease = false;
+        geneNext(g);
     }
     // 与hold无关的普通情况
     else
     {
-        falling = nextBlock;
-        geneNext();
+        g->falling = g->nextBlock;
+        geneNext(g);
     }
 
     // 将方块位置设置到顶端
-    moveToTop(&falling);
+    moveToTop(&g->falling);
     // 如果开头就发生碰撞，则游戏失败
-    if (collisionCheck() == COLLIDED)
-        gameOver();
+    if (collisionCheck(g) == COLLIDED)
+    {
+        gameOver(g);
+        return;
+    }
 
     // 每消除10行，就增加1级难度，直到5级
-    if (level <= lines / 10 && level < 5)
-        levelUp();
+    if (g->level <= g->lines / 10 && g->level < 5)
+        levelUp(g);
+
+    // 只有界面上的游戏可以撤销
+    if (g == &game)
+        pushUndo(&history, g, &placed);
 }
 
 /*
@@ -192,56 +377,226 @@ void newRound()
  * -------------
  * 处理方块暂存与释放
  */
-void hold()
+void hold(tetGame* g)
 {
     // 如果刚释放方块，则该一轮暂时禁用hold功能
     // 避免玩家不断进行hold，从而随机到想要的下一个方块
-    if (OnRelease)
+    if (g->OnRelease)
         return;
 
     // 如果没有方块暂存，则将当前下落方块暂存
-    if (OnHolding == false)
+    if (g->OnHolding == false)
     {
-        holdBlock = falling;
-        moveToHoldBox(&holdBlock);
-        initBlock(&holdBlock);
-        OnRelease = false;
+        g->holdBlock = g->falling;
+        moveToHoldBox(&g->holdBlock);
+        initBlock(&g->holdBlock);
+        g->OnRelease = false;
     }
     // 如果有方块暂存，则将其释放
     else
     {
-        nextBlock = falling;
-        moveToNextBox(&nextBlock);
-        initBlock(&nextBlock);
-        OnRelease = true;
-        delayOneRound = true;
+        g->nextBlock = g->falling;
+        moveToNextBox(&g->nextBlock);
+        initBlock(&g->nextBlock);
+        g->OnRelease = true;
+        g->delayOneRound = true;
     }
 
     // 开始下一轮
-    OnHolding = !OnHolding;
-    newRound();
+    g->OnHolding = !g->OnHolding;
+    newRound(g);
+}
+
+/*
+ * 函数名：gameTick
+ * -------------
+ * 将游戏推进一帧：先判断方块是否触底，未触底时按下落累计量下落，
+ * 触底时累计落定延迟，满 LockDelay 帧后落定并开启下一轮
+ */
+bool gameTick(tetGame* g)
+{
+    if (g->over)
+        return false;
+
+    g->frame++;
+    bool shifted = autoShift(g);
+
+    tetBlock below = g->falling;
+    below.coord.y--;
+    bool grounded = blockCheck(&g->stored, &below) != FREEMOVE;
+
+    // 触底：累计落定延迟，下落累计量不再增加
+    if (grounded)
+    {
+        g->gravity = 0;
+        if (++g->lockTicks < LockDelay)
+            return shifted;
+
+        // 此时向下移动必然碰撞，由 move 落定并开启下一轮
+        g->lockTicks = 0;
+        move(g, TM_DOWN);
+        return true;
+    }
+
+    // 悬空：累计下落量，满 speed 毫秒下落一格
+    g->lockTicks = 0;
+    g->gravity += 1000;
+    if (g->gravity < g->speed * TickRate)
+        return shifted;
+
+    g->gravity -= g->speed * TickRate;
+    g->falling = below;
+    return true;
+}
+
+/* （内部函数）
+ * 函数名：autoShift
+ * -------------
+ * 按住方向键时的自动重复：每帧减少等待量，减到0以下即移动，
+ * 之后每隔 arr 毫秒再移动一格；arr 为0时直接平移到尽头
+ * 返回方块是否移动
+ */
+bool autoShift(tetGame* g)
+{
+    if (g->shiftDir == 0)
+        return false;
+
+    g->shiftWait -= 1000;
+    if (g->shiftWait > 0)
+        return false;
+
+    if (g->arr == 0)
+    {
+        g->shiftWait = 0;
+        return slideBlock(&g->stored, &g->falling, (tetMove)g->shiftDir) > 0;
+    }
+
+    int x = g->falling.coord.x;
+    while (g->shiftWait <= 0)
+    {
+        move(g, (tetMove)g->shiftDir);
+        g->shiftWait += g->arr * TickRate;
+    }
+    return g->falling.coord.x != x;
+}
+
+/* （内部函数）
+ * 函数名：releaseShift
+ * -------------
+ * 暂停时松开所有按住的方向键：暂停期间（及各对话框中）松开的键不会进入输入队列，
+ * 恢复时输入队列也会清空，不松开则恢复后方块会一直自动移动
+ * 与其他输入一样先记录再执行，回放因此保持一致
+ */
+void releaseShift(tetGame* g)
+{
+    if (g->shiftHeld & 1)
+    {
+        recordInput(&recorder, g->frame, ACT_LEFT, true, 0);
+        applyAction(g, ACT_LEFT, true, 0);
+    }
+    if (g->shiftHeld & 2)
+    {
+        recordInput(&recorder, g->frame, ACT_RIGHT, true, 0);
+        applyAction(g, ACT_RIGHT, true, 0);
+    }
+}
+
+/*
+ * 函数名：applyAction
+ * -------------
+ * 对游戏执行一个操作
+ * 左右键按下时移动一格并开始计算延迟，系统的按键重复（按住期间重复的按下）不予理会；
+ * 松开正在自动重复的方向键时，若另一个方向键仍按住，则改为向那边重新计算延迟
+ */
+void applyAction(tetGame* g, tetAction a, bool release, int late)
+{
+    tetMove dir = a == ACT_LEFT ? TM_LEFT : TM_RIGHT;
+    int bit = a == ACT_LEFT ? 1 : 2;
+
+    if (g->over)
+        return;
+
+    switch (a)
+    {
+        case ACT_LEFT:
+        case ACT_RIGHT:
+            if (release)
+            {
+                g->shiftHeld &= ~bit;
+                if (g->shiftDir == dir)
+                {
+                    g->shiftDir  = g->shiftHeld != 0 ? -dir : 0;
+                    g->shiftWait = g->das * TickRate;
+                }
+            }
+            else if (!(g->shiftHeld & bit))
+            {
+                g->shiftHeld |= bit;
+                move(g, dir);
+                g->shiftDir  = dir;
+                g->shiftWait = g->das * TickRate - late;
+            }
+            break;
+
+        case ACT_ROTATE:
+            if (!release)
+                rotate(g);
+            break;
+
+        case ACT_DROP:
+            if (!release)
+                drop(g);
+            break;
+
+        case ACT_SOFTDROP:
+            if (!release)
+                move(g, TM_DOWN);
+            break;
+
+        case ACT_HOLD:
+            if (!release)
+                hold(g);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*
+ * 函数名：queueAction
+ * -------------
+ * 以按键消息产生的时刻为时间戳放入输入队列：界面线程忙于绘制时，
+ * 按键消息要等绘制完才被处理，但之后补上的各帧仍按按键的时刻执行它
+ */
+bool queueAction(tetAction a, bool release)
+{
+    tetInput in;
+    in.time    = platEventTime();
+    in.action  = a;
+    in.release = release;
+    return pushInput(&inputs, &in);
 }
 
 /* （内部函数）
  * 函数名：levelUp
  * -------------
  * 难度升级
- * 增大难度的方式：将计时器间隔缩小为四分之三，
+ * 增大难度的方式：将下落间隔缩小为四分之三，
  * 即当前下落速度变为上一级的1.33倍
  */
-void levelUp()
+void levelUp(tetGame* g)
 {
-    level += 1;
-    // 将计时器间隔缩小为四分之三
-    speed = speed / 4 * 3;
+    g->level += 1;
+    // 将下落间隔缩小为四分之三
+    g->speed = g->speed / 4 * 3;
     /* 注意这个speed的含义，
-     * 它其实是用来作为下落计时器的时间间隔参数的，
+     * 它其实是下落一格的时间间隔（毫秒），
      * 而真正的速度应该和时间间隔成反比。
      * 但将其改为interval之类的名字，
      * 则其含义不如speed直观，
      * 也没必要引入另一个变量来表示时间间隔
      */
-    startTimer(Timer_Fall, speed);
 }
 
 /*
@@ -250,15 +605,15 @@ void levelUp()
  * 根据同时消除的行数来增加分数
  * 参数类型：int，代表同时消除的行数
  */
-void addScore(int eliminated)
+void addScore(tetGame* g, int eliminated)
 {
     // 基准分数：每行10分
-    score += 10 * eliminated;
-    lines += eliminated;
+    g->score += 10 * eliminated;
+    g->lines += eliminated;
 
     // 额外分数：同时消除多行时，每多一行增加5分
     if (eliminated > 1)
-        score += 5 * (eliminated - 1);
+        g->score += 5 * (eliminated - 1);
 }
 
 /*
@@ -267,9 +622,9 @@ void addScore(int eliminated)
  * 取得当前分数
  * 返回类型：int，表示分数
  */
-int getScore()
+int getScore(const tetGame* g)
 {
-    return score;
+    return g->score;
 }
 
 /*
@@ -278,9 +633,9 @@ int getScore()
  * 取得当前难度等级
  * 返回类型：int，表示难度等级
  */
-int getLevel()
+int getLevel(const tetGame* g)
 {
-    return level;
+    return g->level;
 }
 
 /*
@@ -289,9 +644,9 @@ int getLevel()
  * 取得已消除行数
  * 返回类型：int，表示已消除行数
  */
-int getLines()
+int getLines(const tetGame* g)
 {
-    return lines;
+    return g->lines;
 }
 
 /*
@@ -301,13 +656,21 @@ int getLines()
  */
 void gameStart()
 {
+    uint64_t seed = (uint64_t)time(NULL);
+
     initTetris();
-    initGameData();
+    // 上一局（如重新开始时）的记录就此结束
+    closeReplay(&recorder, &game);
+    // 上一局的快照不能再恢复
+    clearUndoRing(&history);
+    // 界面上的游戏以当前时间为种子，保持原有的均匀随机玩法
+    initGame(&game, seed, RAND_UNIFORM);
+    if (recordReplay && !autoPlay)
+        startRecording(seed);
+    botTimer = 0;
     setGameStatu(ON_PLAYING);
-    startTimer(Timer_Fall, speed);
-    geneNext();
-    newRound();
-    display();
+    startClock();
+    platDisplay();
 }
 
 /*
@@ -317,8 +680,10 @@ void gameStart()
  */
 void gamePause()
 {
+    releaseShift(&game);
     setGameStatu(ON_PAUSE);
-    cancelTimer(Timer_Fall);
+    platCancelTimer(Timer_Frame);
+    flushReplay(&recorder);
 }
 
 /*
@@ -328,8 +693,11 @@ void gamePause()
  */
 void gameResume()
 {
+    // 读档后还没有快照，以读入的局面作为第一个，使其第一轮也能撤销
+    if (history.cur < 0)
+        pushUndo(&history, &game, &game.falling);
     setGameStatu(ON_PLAYING);
-    startTimer(Timer_Fall, speed);
+    startClock();
 }
 
 /* （内部函数）
@@ -337,8 +705,114 @@ void gameResume()
  * -------------
  * 游戏失败
  */
-void gameOver()
+void gameOver(tetGame* g)
+{
+    g->over = true;
+
+    // 只有界面上的游戏才需要切换界面、停止计时器
+    if (g == &game)
+    {
+        closeReplay(&recorder, g);
+        setGameStatu(ON_GAMEOVER);
+        platCancelTimer(Timer_Frame);
+    }
+}
+
+/*
+ * 函数名：toggleAutoPlay
+ * -------------
+ * 切换界面上的游戏是否由电脑玩家操作
+ */
+void toggleAutoPlay()
+{
+    // 改由电脑玩家操作后，本局的回放不再能由输入重现，不予保存
+    if (!autoPlay)
+    {
+        initAI(&bot);
+        discardReplay(&recorder);
+    }
+    autoPlay = !autoPlay;
+}
+
+/*
+ * 函数名：isAutoPlay
+ * -------------
+ * 界面上的游戏是否由电脑玩家操作
+ * 返回类型：bool
+ */
+bool isAutoPlay()
 {
-    setGameStatu(ON_GAMEOVER);
-    cancelTimer(Timer_Fall);
-}
\ No newline at end of file
+    return autoPlay;
+}
+
+/*
+ * 函数名：toggleRecordReplay
+ * -------------
+ * 切换是否为界面上的新游戏记录回放，从下一局起生效
+ */
+void toggleRecordReplay()
+{
+    recordReplay = !recordReplay;
+}
+
+/*
+ * 函数名：isRecordReplay
+ * -------------
+ * 是否为界面上的新游戏记录回放
+ * 返回类型：bool
+ */
+bool isRecordReplay()
+{
+    return recordReplay;
+}
+
+/*
+ * 函数名：undoPlacement
+ * -------------
+ * 撤销界面上的游戏的上一次落定（或暂存），回到上一轮开始时
+ */
+bool undoPlacement()
+{
+    if (getGameStatu() != ON_PLAYING || !undoRound(&history, &game))
+        return false;
+
+    // 撤销后本局的回放不再能由输入重现，不予保存
+    discardReplay(&recorder);
+    platDisplay();
+    return true;
+}
+
+/*
+ * 函数名：redoPlacement
+ * -------------
+ * 重做界面上的游戏刚撤销的一轮
+ */
+bool redoPlacement()
+{
+    if (getGameStatu() != ON_PLAYING || !redoRound(&history, &game))
+        return false;
+
+    platDisplay();
+    return true;
+}
+
+/*
+ * 函数名：setUndoDepth
+ * -------------
+ * 设置界面上的游戏至多可连续撤销的轮数，从下一局起生效：只记下容量，
+ * 由下一次开局或读档时的 initTetris 重新分配，当前这一局仍可照常撤销
+ */
+void setUndoDepth(int depth)
+{
+    undoDepth = depth + 1;
+}
+
+/*
+ * 函数名：watchWrites
+ * -------------
+ * 启动后台写入的完成检查计时器，之后写入任务的完成通知在界面线程中依次调用
+ */
+void watchWrites()
+{
+    platStartTimer(Timer_Write, WriteInterval);
+}
@@ -9,6 +9,8 @@
  * 外部接口：
  *      游戏流程初始化：
  *           initTetris
+ *           initGame
+ *           getGame
  *      游戏状态的读取与改变函数：
  *           setGameStatu
  *           getGameStatu
@@ -23,9 +25,20 @@
  *      游戏进程控制函数
  *           newRound
  *           hold
+ *           gameTick
+ *           applyAction
+ *           queueAction
  *           gameStart
  *           gamePause
  *           gameResume
+ *           toggleAutoPlay
+ *           isAutoPlay
+ *           toggleRecordReplay
+ *           isRecordReplay
+ *           undoPlacement
+ *           redoPlacement
+ *           setUndoDepth
+ *           watchWrites
  */
 
 #ifndef FLOW_H
@@ -33,6 +46,29 @@
 
 #include <stdbool.h>
 
+#include "tetris.h"  // 需要取得方块及方块堆结构定义
+#include "rng.h"     // 需要取得方块序列生成器定义
+#include "input.h"   // 需要取得游戏操作定义
+
+/* 固定步长的游戏逻辑
+ * 下落、落定延迟等游戏逻辑以固定的频率（TickRate 次/秒）逐步推进，每一步称为一帧，
+ * 与界面刷新的频率无关：界面每次刷新前，按实际经过的时间补足应推进的帧数，
+ * 因此同样的输入在任何机器上都得到同样的结果
+ *      TickRate   - 每秒的帧数
+ *      LockDelay  - 方块触底后，经过多少帧才落定（期间仍可移动、旋转）
+ *      MaxCatchUp - 界面每次刷新前至多补足的帧数，避免卡顿后一次推进过多
+ */
+#define TickRate   60
+#define LockDelay  30
+#define MaxCatchUp 10
+
+/* 左右移动的自动重复（DAS/ARR）默认设置，单位为毫秒
+ *      DefaultDAS - 按住方向键后，经过多久开始自动重复
+ *      DefaultARR - 自动重复时每移动一格的间隔，0 代表立即移到尽头
+ */
+#define DefaultDAS 167
+#define DefaultARR 33
+
 // 当前游戏状态
 // 前4个分别代表：游戏暂停、游戏中、在主菜单界面、在排行榜界面
 // 其余依此类推
@@ -40,14 +76,51 @@ typedef enum
 {
   ON_PAUSE, ON_PLAYING, ON_MAIN, ON_RANKING, ON_HELP,
   ON_LOAD, ON_SAVE, ON_SUCCESS, ON_LOADFAIL, ON_SAVEFAIL,
-  ON_RESTART, ON_BACKTOMAIN, ON_GAMEOVER, ON_RECORD
+  ON_RESTART, ON_BACKTOMAIN, ON_GAMEOVER, ON_RECORD, ON_SAVING
 } tetGameStatus;
 
 
+/* 游戏上下文定义
+ * 一局游戏的全部数据都保存在该结构中，各个游戏操作函数均以其指针为参数，
+ * 因此一个进程中可以同时进行任意多局互不干扰的游戏（例如无界面的模拟对局）
+ *
+ * 界面上显示的那一局游戏由本模块持有，通过 getGame 取得
+ */
+struct tetGame
+{
+  tetBoard stored;     // 已落下的方块堆
+  tetBlock falling;    // 正在下落的方块
+  tetBlock nextBlock;  // 下一个下落方块
+  tetBlock holdBlock;  // 当前暂存的方块
+
+  tetRandomizer random;  // 本局的方块序列生成器
+
+  int speed;  // 游戏速度
+  int score;  // 当前分数
+  int level;  // 当前难度等级，最高为5
+  int lines;  // 已消除的行数
+
+  bool OnHolding;      // 是否有暂存方块
+  bool OnRelease;      // 是否刚释放了暂存方块
+  bool delayOneRound;  // 释放暂存方块后需暂停一轮hold功能
+  bool over;           // 游戏是否已经失败
+
+  uint32_t frame;      // 已推进的帧数
+  int gravity;         // 下落累计量：每帧加1000，满 speed*TickRate 即下落一格
+  int lockTicks;       // 方块已触底的帧数
+
+  int das;             // 自动重复的延迟（毫秒）
+  int arr;             // 自动重复的间隔（毫秒），0 代表立即移到尽头
+  int shiftHeld;       // 按住的方向键：位0为左，位1为右
+  int shiftDir;        // 正在自动重复的方向（TM_LEFT、TM_RIGHT），0 代表没有
+  int shiftWait;       // 距下一次自动移动的累计量，单位与 gravity 相同
+};
+
+
 /*
  * 函数名称：initTetris
  * 函数原型：void initTetris()
- * 功能描述：初始化游戏控制机制（随机数种子及计时器回调事件）
+ * 功能描述：初始化游戏控制机制（计时器回调事件）
  * 副作用？：无
  *
  * 参数描述：无
@@ -58,6 +131,38 @@ typedef enum
 void initTetris();
 
 
+/*
+ * 函数名称：initGame
+ * 函数原型：void initGame(tetGame* g, uint64_t seed, tetRandMode mode)
+ * 功能描述：将游戏 g 设为一局新游戏的初始状态（清空方块堆、重置分数等），
+ *          并生成第一个下落方块
+ *         | 种子与模式相同的两局游戏，方块序列完全相同
+ * 副作用？：改变游戏 g 的全部数据
+ *
+ * 参数描述：游戏上下文 g :: tetGame*
+ *         随机种子 seed :: uint64_t
+ *         方块序列生成模式 mode :: tetRandMode（定义见 rng.h）
+ * 返回类型：无
+ * --------------
+ * 使用方法：initGame(&yourGame, seed, RAND_BAG);
+ */
+void initGame(tetGame* g, uint64_t seed, tetRandMode mode);
+
+
+/*
+ * 函数名称：getGame
+ * 函数原型：tetGame* getGame()
+ * 功能描述：取得界面上正在显示的那一局游戏
+ * 副作用？：无
+ *
+ * 参数描述：无
+ * 返回类型：tetGame*，界面上的游戏上下文
+ * --------------
+ * 使用方法：tetGame* g = getGame();
+ */
+tetGame* getGame();
+
+
 /*
  * 函数名称：setGameStatu
  * 函数原型：void setGameStatu(tetGameStatus gs)
@@ -119,105 +224,160 @@ void restoreGameStatu();
 
 /*
  * 函数名称：isOnHolding
- * 函数原型：bool isOnHolding()
- * 功能描述：判断当前是否有方块暂存
+ * 函数原型：bool isOnHolding(const tetGame* g)
+ * 功能描述：判断游戏 g 当前是否有方块暂存
  * 副作用？：无
  *
- * 参数描述：无
+ * 参数描述：游戏上下文 g :: const tetGame*
  * 返回类型：bool，表示当前是否有方块暂存
  * --------------
- * 使用方法：bool whatever = isOnHolding();
+ * 使用方法：bool whatever = isOnHolding(yourGame);
  */
-bool isOnHolding();
+bool isOnHolding(const tetGame* g);
 
 
 /*
  * 函数名称：newRound
- * 函数原型：void newRound()
+ * 函数原型：void newRound(tetGame* g)
  * 功能描述：结束本轮，开始下一轮方块下落
  *         | 检测游戏是否失败，以及处理难度升级的情况
  *         | 无需调用者判断暂存与释放状态，该函数自动处理）
- * 副作用？：引起游戏进程改变
+ * 副作用？：引起游戏 g 的进程改变
  *
- * 参数描述：无
+ * 参数描述：游戏上下文 g :: tetGame*
  * 返回类型：无
  * --------------
- * 使用方法：newRound();
+ * 使用方法：newRound(yourGame);
  */
-void newRound();
+void newRound(tetGame* g);
 
 
 /*
  * 函数名称：hold
- * 函数原型：void hold()
+ * 函数原型：void hold(tetGame* g)
  * 功能描述：处理方块暂存与释放功能
            | 无需调用者判断暂存状态，该函数自动处理）
- * 副作用？：引起游戏进程改变
+ * 副作用？：引起游戏 g 的进程改变
  *
- * 参数描述：无
+ * 参数描述：游戏上下文 g :: tetGame*
+ * 返回类型：无
+ * --------------
+ * 使用方法：hold(yourGame);
+ */
+void hold(tetGame* g);
+
+
+/*
+ * 函数名称：gameTick
+ * 函数原型：bool gameTick(tetGame* g)
+ * 功能描述：将游戏 g 推进一帧（1/TickRate 秒）：
+ *          累计下落量，满 speed 毫秒即下落一格；
+ *          方块触底后累计 LockDelay 帧才落定，期间若移离支撑则重新计数；
+ *          按住方向键时，按 das、arr 自动左右移动
+ *          只用整数运算，结果只取决于帧数与操作，与实际时间无关
+ * 副作用？：引起游戏 g 的进程改变
+ *
+ * 参数描述：游戏上下文 g :: tetGame*
+ * 返回类型：bool，本帧中方块是否移动或落定，即界面是否需要刷新
+ * --------------
+ * 使用方法：if (gameTick(yourGame)) display();
+ */
+bool gameTick(tetGame* g);
+
+
+/*
+ * 函数名称：applyAction
+ * 函数原型：void applyAction(tetGame* g, tetAction a, bool release, int late)
+ * 功能描述：对游戏 g 执行一个操作（move、rotate、drop、hold 之一），在下一帧之前调用
+ *          按下左右键时立即移动一格，并开始计算自动重复的延迟；松开时停止自动重复
+ *          late 为按键发生在本帧之前多久，自动重复从按键的那一刻算起，不受帧的边界影响
+ * 副作用？：引起游戏 g 的进程改变
+ *
+ * 参数描述：游戏上下文 g :: tetGame*
+ *         操作 a :: tetAction（定义见 input.h）
+ *         是否为松开按键 release :: bool（只对 ACT_LEFT、ACT_RIGHT 有意义，其余操作忽略松开）
+ *         按键早于本帧的时间 late :: int（单位为 1/1000 帧，0 ~ 999）
  * 返回类型：无
  * --------------
- * 使用方法：hold();
+ * 使用方法：applyAction(yourGame, ACT_ROTATE, false, 0);
  */
-void hold();
+void applyAction(tetGame* g, tetAction a, bool release, int late);
+
+
+/*
+ * 函数名称：queueAction
+ * 函数原型：bool queueAction(tetAction a, bool release)
+ * 功能描述：以按键消息产生的时刻为时间戳（见 platEventTime），将界面上的游戏的一个按键事件放入输入队列，
+ *          在游戏逻辑推进到该时刻所在的帧之前执行
+ *          只能由一个线程（窗口的事件回调）调用
+ * 副作用？：改变输入队列
+ *
+ * 参数描述：操作 a :: tetAction（定义见 input.h）
+ *         是否为松开按键 release :: bool
+ * 返回类型：bool，false 代表队列已满，操作被丢弃
+ * --------------
+ * 使用方法：queueAction(ACT_LEFT, false);
+ */
+bool queueAction(tetAction a, bool release);
 
 
 /*
  * 函数名称：addScore
- * 函数原型：void addScore(int eliminated)
+ * 函数原型：void addScore(tetGame* g, int eliminated)
  * 功能描述：根据消除的行数来增加分数
            | 基准分数：每行10分
            | 额外分数：同时消除多行时，每多一行增加5分
- * 副作用？：引起游戏分数改变
+ * 副作用？：引起游戏 g 的分数改变
  *
- * 参数描述：同时消除的行数 eliminated :: int
+ * 参数描述：游戏上下文 g :: tetGame*
+ *         同时消除的行数 eliminated :: int
  * 返回类型：无
  * --------------
- * 使用方法：addScore(yourEliminatedLines);
+ * 使用方法：addScore(yourGame, yourEliminatedLines);
  */
-void addScore(int eliminated);
+void addScore(tetGame* g, int eliminated);
 
 
 /*
  * 函数名称：getScore
- * 函数原型：int getScore()
- * 功能描述：取得当前游戏分数
+ * 函数原型：int getScore(const tetGame* g)
+ * 功能描述：取得游戏 g 当前游戏分数
  * 副作用？：无
  *
- * 参数描述：无
+ * 参数描述：游戏上下文 g :: const tetGame*
  * 返回类型：int，代表当前分数
  * --------------
- * 使用方法：int whatever = getScore();
+ * 使用方法：int whatever = getScore(yourGame);
  */
-int getScore();
+int getScore(const tetGame* g);
 
 
 /*
  * 函数名称：getLevel
- * 函数原型：int getLevel()
- * 功能描述：取得当前游戏难度等级
+ * 函数原型：int getLevel(const tetGame* g)
+ * 功能描述：取得游戏 g 当前游戏难度等级
  * 副作用？：无
  *
- * 参数描述：无
+ * 参数描述：游戏上下文 g :: const tetGame*
  * 返回类型：int，代表当前游戏难度等级
  * --------------
- * 使用方法：int whatever = getLevel();
+ * 使用方法：int whatever = getLevel(yourGame);
  */
-int getLevel();
+int getLevel(const tetGame* g);
 
 
 /*
  * 函数名称：getLines
- * 函数原型：int getLines()
- * 功能描述：取得当前已消除行数
+ * 函数原型：int getLines(const tetGame* g)
+ * 功能描述：取得游戏 g 当前已消除行数
  * 副作用？：无
  *
- * 参数描述：无
+ * 参数描述：游戏上下文 g :: const tetGame*
  * 返回类型：int，代表当前已消除行数
  * --------------
- * 使用方法：int whatever = getLines();
+ * 使用方法：int whatever = getLines(yourGame);
  */
-int getLines();
+int getLines(const tetGame* g);
 
 
 /*
@@ -261,4 +421,86 @@ void gamePause();
  */
 void gameResume();
 
+
+/*
+ * 函数名称：toggleAutoPlay / isAutoPlay
+ * 函数原型：void toggleAutoPlay()
+ *          bool isAutoPlay()
+ * 功能描述：切换/查询界面上的游戏是否由电脑玩家（见 ai.h）操作
+ *          由电脑玩家操作时，下落计时器每触发一次，电脑玩家落下一个方块
+ * 副作用？：toggleAutoPlay 改变之后下落计时器的行为
+ *
+ * 参数描述：无
+ * 返回类型：isAutoPlay 返回 bool，true 代表由电脑玩家操作
+ * --------------
+ * 使用方法：toggleAutoPlay();
+ */
+void toggleAutoPlay();
+bool isAutoPlay();
+
+
+/*
+ * 函数名称：toggleRecordReplay / isRecordReplay
+ * 函数原型：void toggleRecordReplay()
+ *          bool isRecordReplay()
+ * 功能描述：切换 / 取得是否为界面上的每局新游戏记录回放（文件格式见 replay.h）
+ *         | 从下一局新游戏起生效；回放保存在 saves/replays 中，以开局时刻命名。
+ *         | 回到主菜单或游戏失败时结束记录，改由电脑玩家操作的一局不予保存
+ * 副作用？：toggleRecordReplay 改变之后新游戏是否记录回放
+ *
+ * 参数描述：无
+ * 返回类型：isRecordReplay 返回 bool，true 代表记录回放
+ * --------------
+ * 使用方法：toggleRecordReplay();
+ */
+void toggleRecordReplay();
+bool isRecordReplay();
+
+
+/*
+ * 函数名称：undoPlacement / redoPlacement
+ * 函数原型：bool undoPlacement()
+ *          bool redoPlacement()
+ * 功能描述：撤销界面上的游戏的上一次落定（或暂存） / 重做刚撤销的一轮（见 undo.h）
+ *         | 只在游戏进行中有效；撤销过的一局不再记录回放
+ * 副作用？：改变界面上的游戏，并刷新界面
+ *
+ * 参数描述：无
+ * 返回类型：bool，false 代表没有可撤销 / 可重做的一轮
+ * --------------
+ * 使用方法：undoPlacement();
+ */
+bool undoPlacement();
+bool redoPlacement();
+
+
+/*
+ * 函数名称：setUndoDepth
+ * 函数原型：void setUndoDepth(int depth)
+ * 功能描述：设置界面上的游戏至多可连续撤销的轮数（默认 UndoDepth-1），从下一局起生效
+ *          （当前这一局的撤销不受影响）
+ * 副作用？：下一次开局或读档时重新分配快照的空间
+ *
+ * 参数描述：轮数 depth :: int，不大于0时不能撤销
+ * 返回类型：无
+ * --------------
+ * 使用方法：setUndoDepth(100);
+ */
+void setUndoDepth(int depth);
+
+
+/*
+ * 函数名称：watchWrites
+ * 函数原型：void watchWrites()
+ * 功能描述：提交后台写入任务（见 writer.h）后调用，使其完成通知在界面线程中得到调用
+ *         | 定期检查，全部任务完成后即停止检查
+ * 副作用？：启动计时器
+ *
+ * 参数描述：无
+ * 返回类型：无
+ * --------------
+ * 使用方法：if (saveGame(yourGame, username, yourDone) == SUCCESS) watchWrites();
+ */
+void watchWrites();
+
 #endif
\ No newline at end of file
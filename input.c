@@ -0,0 +1,73 @@
+/*
+ * 项目：Tetris
+ * 文件名：input.c
+ * 概览：输入队列模块
+ * -------------
+ * 负责功能：
+ *      单生产者、单消费者无锁环形队列的放入与取出
+ */
+
+#include "input.h"  // 本模块
+
+/*
+ * 函数名：initInputRing
+ * -------------
+ * 两端下标归零
+ */
+void initInputRing(tetInputRing* r)
+{
+    __atomic_store_n(&r->head, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->tail, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * 函数名：pushInput
+ * -------------
+ * 先写入事件，再以 release 语义推进 tail，
+ * 取出的一方以 acquire 语义读到新的 tail 时，必然也能读到完整的事件
+ */
+bool pushInput(tetInputRing* r, const tetInput* in)
+{
+    unsigned int tail = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+    unsigned int head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+
+    if (tail - head == InputRingSize)
+        return false;
+
+    r->slot[tail & (InputRingSize - 1)] = *in;
+    __atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/*
+ * 函数名：peekInput
+ * -------------
+ * 读出 head 处的事件，不推进 head
+ */
+bool peekInput(tetInputRing* r, tetInput* in)
+{
+    unsigned int head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    unsigned int tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+
+    if (head == tail)
+        return false;
+
+    *in = r->slot[head & (InputRingSize - 1)];
+    return true;
+}
+
+/*
+ * 函数名：popInput
+ * -------------
+ * 读出 head 处的事件后，以 release 语义推进 head，
+ * 保证放入的一方复用这个位置时，事件已经读完
+ */
+bool popInput(tetInputRing* r, tetInput* in)
+{
+    if (!peekInput(r, in))
+        return false;
+
+    unsigned int head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
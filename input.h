@@ -0,0 +1,124 @@
+/*
+ * 项目：Tetris
+ * 文件名：input.h
+ * 概览：输入队列模块
+ * -------------
+ * 主要内容：
+ *      游戏操作（左移、右移、旋转等）及带时间戳的输入事件的定义
+ *      单生产者、单消费者的无锁环形队列
+ *
+ * 窗口的键盘回调只把带时间戳的输入事件放入队列，立即返回；
+ * 游戏逻辑每推进一帧前，取出时间戳不晚于该帧的事件依次执行。
+ * 键盘回调与计时器都在界面线程中执行，界面刷新慢时按键消息仍要等刷新完才被处理；
+ * 但时间戳取按键消息产生的时刻（见 platform.h 中的 platEventTime），之后补上的各帧按此时刻
+ * 决定它在哪一帧执行，因此执行的帧与刷新快慢无关（精度为系统消息时间的精度），输入也不会丢失；
+ * 每个操作在哪一帧执行是确定的，可以原样记录下来
+ *
+ * 队列只允许一个线程放入、一个线程取出，两端各自只写自己的下标，不需要加锁
+ *
+ * 外部接口：
+ *      initInputRing
+ *      pushInput
+ *      peekInput
+ *      popInput
+ */
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdbool.h>
+
+// 队列容量，须为2的幂
+#define InputRingSize 256
+
+// 缓存行大小，用于隔开两端各自频繁写入的下标
+#define InputCacheLine 64
+
+
+/* 游戏操作定义
+ *      ACT_LEFT     - 左移
+ *      ACT_RIGHT    - 右移
+ *      ACT_ROTATE   - 顺时针旋转
+ *      ACT_DROP     - 直接落底
+ *      ACT_SOFTDROP - 下移一格（触底则立即落定）
+ *      ACT_HOLD     - 暂存/释放方块
+ */
+typedef enum {
+  ACT_LEFT, ACT_RIGHT, ACT_ROTATE, ACT_DROP, ACT_SOFTDROP, ACT_HOLD,
+  actionNum
+} tetAction;
+
+
+/* 输入事件
+ *      time    - 事件发生的时刻（platNow 的返回值，秒）
+ *      action  - 操作
+ *      release - 是否为松开按键；只有左右移动关心松开，用于结束自动重复
+ */
+typedef struct {
+  double    time;
+  tetAction action;
+  bool      release;
+} tetInput;
+
+
+/* 输入队列
+ *      head - 下一个要取出的位置，只由取出的一方改变
+ *      tail - 下一个要放入的位置，只由放入的一方改变
+ *      slot - 事件
+ * 下标只增不减，与 InputRingSize-1 按位与得到位置；tail - head 即队列中的事件数
+ */
+typedef struct {
+  unsigned int head;
+  char         padHead[InputCacheLine - sizeof(unsigned int)];
+  unsigned int tail;
+  char         padTail[InputCacheLine - sizeof(unsigned int)];
+  tetInput     slot[InputRingSize];
+} tetInputRing;
+
+
+/*
+ * 函数名称：initInputRing
+ * 函数原型：void initInputRing(tetInputRing* r)
+ * 功能描述：清空队列（此时不得有其他线程在使用它）
+ * 副作用？：改变传入的队列
+ *
+ * 参数描述：输入队列 r :: tetInputRing*
+ * 返回类型：无
+ * --------------
+ * 使用方法：initInputRing(&yourRing);
+ */
+void initInputRing(tetInputRing* r);
+
+
+/*
+ * 函数名称：pushInput
+ * 函数原型：bool pushInput(tetInputRing* r, const tetInput* in)
+ * 功能描述：放入一个事件（只能由放入的一方调用）
+ * 副作用？：改变队列
+ *
+ * 参数描述：输入队列 r :: tetInputRing*
+ *         事件 in :: const tetInput*
+ * 返回类型：bool，false 代表队列已满，事件被丢弃
+ * --------------
+ * 使用方法：pushInput(&yourRing, &in);
+ */
+bool pushInput(tetInputRing* r, const tetInput* in);
+
+
+/*
+ * 函数名称：peekInput / popInput
+ * 函数原型：bool peekInput(tetInputRing* r, tetInput* in)
+ *          bool popInput(tetInputRing* r, tetInput* in)
+ * 功能描述：查看最早的事件而不取出 / 取出最早的事件（只能由取出的一方调用）
+ * 副作用？：改变传入的事件；popInput 还改变队列
+ *
+ * 参数描述：输入队列 r :: tetInputRing*
+ *         事件 in :: tetInput*
+ * 返回类型：bool，false 代表队列为空，此时 in 不变
+ * --------------
+ * 使用方法：while (peekInput(&yourRing, &in) && in.time <= now) { popInput(&yourRing, &in); ... }
+ */
+bool peekInput(tetInputRing* r, tetInput* in);
+bool popInput(tetInputRing* r, tetInput* in);
+
+#endif
@@ -35,6 +35,14 @@ extern double winwidth, winheight;
 // 错误的存档名
 static char errName[NAMELEN];
 
+// 正在后台保存时，提交保存的对话框所在的状态（ON_SAVE 或 ON_RECORD）
+static tetGameStatus savingFrom;
+
+
+// 内部函数声明
+void beginSaving();
+void saveDone(int result);
+
 
 /*
  * 函数名：MsgBox
@@ -180,8 +188,8 @@ void MsgBoxSave()
 
     if (choice == 0 && username[0] != '\0')
     {
-        if (SUCCESS == saveGame(username))
-            setGameStatu(ON_SUCCESS);
+        if (SUCCESS == saveGame(getGame(), username, saveDone))
+            beginSaving();
         else
             setGameStatu(ON_SAVEFAIL);
     }
@@ -217,7 +225,7 @@ void MsgBoxLoad()
 
     if (choice == 0 && username[0] != '\0')
     {
-        if (SUCCESS == loadGame(username))
+        if (SUCCESS == loadGame(getGame(), username))
         {
             initTetris();
             setGameStatu(ON_SUCCESS);
@@ -255,7 +263,9 @@ void MsgBoxSuccess()
 
     if (MsgBox(prompt, buttons, 1, NoTextBox, NULL, 0) == 0)
     {
-        if (getPrevStatu() == ON_RECORD)
+        tetGameStatus from = getPrevStatu() == ON_SAVING ? savingFrom : getPrevStatu();
+
+        if (from == ON_RECORD)
             setGameStatu(ON_MAIN);
         else
             gameResume();
@@ -373,22 +383,23 @@ void MsgBoxBackToMain()
 /*
  * 函数名：MsgBoxGameOver
  * --------------
- * 提示总得分，及是否保存记录（游戏失败时使用）
-             --------------------------------------------
-            |                                            |
-            |      You got XXX points! Save record?      |
-            |                                            |
-            |           --------     --------            |
-            |          |   Ok   |   | Cancel |           |
-            |           --------     --------            |
-             --------------------------------------------
+ * 提示总得分及其在排行榜中的名次，及是否保存记录（游戏失败时使用）
+             ------------------------------------------------------
+            |                                                      |
+            |      You got XXX points, rank #YYY! Save record?     |
+            |                                                      |
+            |                --------     --------                 |
+            |               |   Ok   |   | Cancel |                |
+            |                --------     --------                 |
+             ------------------------------------------------------
  */
 void MsgBoxGameOver()
 {
-    static char  prompt[50];
+    static char  prompt[64];
     static char* buttons[] = {"Ok", "Cancel"};
 
-    sprintf(prompt, "You got %d points! Save record?", getScore());
+    int score = getScore(getGame());
+    sprintf(prompt, "You got %d points, rank #%d! Save record?", score, getRank(score));
 
     int choice = MsgBox(prompt, buttons, 2, NoTextBox, NULL, 0);
 
@@ -428,8 +439,8 @@ void MsgBoxRecord()
 
     if (choice == 0 && strBuffer[0] != '\0')
     {
-        if (SUCCESS == saveRecord(strBuffer, getScore()))
-            setGameStatu(ON_SUCCESS);
+        if (SUCCESS == saveRecord(strBuffer, getScore(getGame()), saveDone))
+            beginSaving();
         else
             setGameStatu(ON_SAVEFAIL);
     }
@@ -437,4 +448,27 @@ void MsgBoxRecord()
     {
         setGameStatu(ON_MAIN);
     }
-}
\ No newline at end of file
+}
+
+
+/* （内部函数）
+ * 函数名：beginSaving
+ * -------------
+ * 保存已交给后台写入，在完成之前显示"正在保存"，不再响应对话框
+ */
+void beginSaving()
+{
+    savingFrom = getGameStatu();
+    setGameStatu(ON_SAVING);
+    watchWrites();
+}
+
+/* （内部函数）
+ * 函数名：saveDone
+ * -------------
+ * 后台保存完成的通知（在界面线程中调用），提示成功或失败
+ */
+void saveDone(int result)
+{
+    setGameStatu(result == SUCCESS ? ON_SUCCESS : ON_SAVEFAIL);
+}
@@ -34,17 +34,16 @@
 #define cellSide    0.30
 
 
-tetRecord* records;
+// 排行榜每页显示 RankShown 名：当前页的记录及读入的条数，当前页第一条的名次（0起），记录总数
+#define RankShown 10
+tetRecord records[RankShown];
+int recordCount;
+int recordFirst;
+int recordTotal;
 
 // 引入main模块中的表示窗口宽度及高度的变量
 extern double winwidth, winheight;
 
-// 引入流程控制模块 flow.c 中定义的方块，用于绘制
-extern tetBoard stored[MaxCoordY+1][MaxCoordX+1];
-extern tetBlock falling;
-extern tetBlock nextBlock;
-extern tetBlock holdBlock;
-
 
 /*
  * 函数名：dispFrame
@@ -81,14 +80,15 @@ void dispStat()
 {
     static char strBuffer[10];
     double h = 1.3*GetFontHeight();
+    const tetGame* g = getGame();
 
     SetPenColor("White");
     drawLabel(statX, statY,     "Score");
-    drawLabel(statX, statY-h,   itoa(getScore(), strBuffer, 10));
+    drawLabel(statX, statY-h,   itoa(getScore(g), strBuffer, 10));
     drawLabel(statX, statY-2*h, "Level");
-    drawLabel(statX, statY-3*h, itoa(getLevel(), strBuffer, 10));
+    drawLabel(statX, statY-3*h, itoa(getLevel(g), strBuffer, 10));
     drawLabel(statX, statY-4*h, "Lines");
-    drawLabel(statX, statY-5*h, itoa(getLines(), strBuffer, 10));
+    drawLabel(statX, statY-5*h, itoa(getLines(g), strBuffer, 10));
 
 }
 
@@ -212,9 +212,9 @@ void dispStartWindow()
     {
         clicked = true;
         // 点击排行榜按钮，则读取记录数据
-        if (records != NULL)
-            freeRecords(records);
-        records = loadRecords();
+        recordFirst = 0;
+        recordTotal = getRecordCount();
+        recordCount = loadRecords(records, recordFirst, RankShown);
         setGameStatu(ON_RANKING);
     }
 
@@ -244,6 +244,8 @@ void dispRankWindow()
 
     static double buttonBackWidth   = 0.55;
     static double buttonBackHeight  = 0.30;
+    static double buttonPageWidth   = 0.40;
+    static double buttonGap         = 0.80;
 
     double frmRankX = (winwidth  - frmRankWidth) / 2;
     double frmRankY = (winheight - frmRankHeight) / 2;
@@ -280,32 +282,48 @@ void dispRankWindow()
     }
 
     // 显示玩家名、分数数据
-    char labelMsg[10];
-    char strScore[10];
-    tetRecord *rec = records;
+    char labelMsg[16];
+    char strScore[12];
     // 前三名颜色高亮
     SetPenColor("Green");
-    for (i = 1; i <= 10; ++i)
+    for (i = 1; i <= RankShown; ++i)
     {
-        if (i > 3) SetPenColor("White");
+        if (recordFirst + i > 3) SetPenColor("White");
 
-        sprintf(labelMsg, "NO.%d", i);
+        sprintf(labelMsg, "NO.%d", recordFirst + i);
         MovePen(labelX, labelY - i*labelGap);
         DrawTextString(labelMsg);
 
         // 即使数据不足10个，也要显示第一栏
-        if (rec != NULL)
+        if (i <= recordCount)
         {
             MovePen(labelX + columnGap, labelY - i*labelGap);
-            DrawTextString(rec->name);
+            DrawTextString(records[i-1].name);
 
             MovePen(labelX + 2*columnGap, labelY - i*labelGap);
-            DrawTextString(itoa(rec->score, strScore, 10));
-
-            rec = rec->next;
+            DrawTextString(itoa(records[i-1].score, strScore, 10));
         }
     }
 
+    // 点击翻页按钮，读入上一页 / 下一页的记录
+    if (recordFirst > 0 && button(GenUIID(0), buttonBackX - buttonGap, buttonBackY,
+        buttonPageWidth, buttonBackHeight, "<"))
+    {
+        recordFirst = recordFirst > RankShown ? recordFirst - RankShown : 0;
+        recordCount = loadRecords(records, recordFirst, RankShown);
+        display();
+        return;
+    }
+    if (recordFirst + RankShown < recordTotal && button(GenUIID(0),
+        buttonBackX + buttonBackWidth + buttonGap - buttonPageWidth, buttonBackY,
+        buttonPageWidth, buttonBackHeight, ">"))
+    {
+        recordFirst += RankShown;
+        recordCount = loadRecords(records, recordFirst, RankShown);
+        display();
+        return;
+    }
+
     // 点击返回按钮
     if (button(GenUIID(0), buttonBackX, buttonBackY,
         buttonBackWidth, buttonBackHeight, "Back"))
@@ -487,87 +505,90 @@ void fillCell(tetCoord coord, tetColor color)
  * 用法：drawBlock(&yourBlock);
  * ------------------------
  * 绘制一个方块
- * （因为方块结构的特殊，我们不必考虑方块的类型和方向）
+ * （周围格从形态表中取得，我们不必另行考虑方块的类型和方向）
  */
-void drawBlock(tetBlock* b)
+void drawBlock(const tetBlock* b)
 {
+    const tetShape* s = ShapeOf(*b);
+    tetCoord cell = b->coord;
+
     // 绘制中心格
-    fillCell(b->coord, b->color);
+    fillCell(cell, b->color);
 
     // 绘制3个周围格
     int i;
     for (i = 0; i < 3; ++i)
     {
-        ShiftCoord(b->coord, b->surround[i]);
+        ShiftCoord(cell, s->surround[i]);
         // 只有处于有效范围内的格子才绘制
         // 有效范围即 board 界面和两个方块盒
-        if (b->coord.x > 10 || InBound(b->coord))
-            fillCell(b->coord, b->color);
-        UnshiftCoord(b->coord, b->surround[i]);
+        if (cell.x > 10 || InBound(cell))
+            fillCell(cell, b->color);
+        UnshiftCoord(cell, s->surround[i]);
     }
 }
 
 /* （内部函数）
  * 函数：dispStored
- * 用法：dispStored();
+ * 用法：dispStored(yourGame);
  * ------------------------
  * 绘制已落下的方块堆
  */
-void dispStored()
+void dispStored(const tetGame* g)
 {
     int x, y;
     tetCoord coord;
-    // 利用二维数组在内存中连续的特性
-    // 使用指针遍历，能节省索引的开销
-    tetBoard* curp = &stored[0][0];
     for (y = 0; y <= MaxCoordY; ++y)
     {
+        // 利用位棋盘，空行直接跳过
+        if (g->stored.rows[y] == 0)
+            continue;
+
         for (x = 0; x <= MaxCoordX; ++x)
         {
-            if (curp->statu == CELL_TAKEN)
+            if (CellTaken(g->stored, x, y))
             {
                 coord.x = x;
                 coord.y = y;
-                fillCell(coord, curp->color);
+                fillCell(coord, g->stored.color[y][x]);
             }
-            curp++;
         }
     }
 }
 
 /* （内部函数）
  * 函数：dispFalling
- * 用法：dispFalling();
+ * 用法：dispFalling(yourGame);
  * ------------------------
  * 绘制正在下落的方块
  */
-void dispFalling()
+void dispFalling(const tetGame* g)
 {
-    drawBlock(&falling);
+    drawBlock(&g->falling);
 }
 
 /* （内部函数）
  * 函数：dispNext
- * 用法：dispNext();
+ * 用法：dispNext(yourGame);
  * ------------------------
  * 绘制下一个下落的方块
  */
-void dispNext()
+void dispNext(const tetGame* g)
 {
-    drawBlock(&nextBlock);
+    drawBlock(&g->nextBlock);
 }
 
 /* （内部函数）
  * 函数：dispHold
- * 用法：dispHold();
+ * 用法：dispHold(yourGame);
  * ------------------------
  * 绘制暂存的方块
  */
-void dispHold()
+void dispHold(const tetGame* g)
 {
-    if (isOnHolding())
+    if (isOnHolding(g))
     {
-        drawBlock(&holdBlock);
+        drawBlock(&g->holdBlock);
     }
 }
 
@@ -578,8 +599,10 @@ void dispHold()
  */
 void dispAllBlocks()
 {
-    dispNext();
-    dispHold();
-    dispFalling();
-    dispStored();
+    const tetGame* g = getGame();
+
+    dispNext(g);
+    dispHold(g);
+    dispFalling(g);
+    dispStored(g);
 }
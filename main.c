@@ -30,6 +30,7 @@
 #include "flow.h"     // 需控制游戏流程
 #include "layout.h"   // 需更新界面
 #include "interact.h" // 需用到交互界面
+#include "platform.h" // 需注册界面钩子
 
 
 // 游戏控制键及菜单快捷键定义
@@ -44,6 +45,10 @@
 #define Key_Restart     0x4E   // N
 #define Key_BackToMain  0x4D   // M
 #define Key_Help        0x4C   // L
+#define Key_AutoPlay    0x49   // I
+#define Key_Record      0x52   // R
+#define Key_Undo        0x5A   // Z
+#define Key_Redo        0x58   // X
 
 double winwidth, winheight;
 
@@ -57,6 +62,23 @@ void KeyboardEventProcess(int key, int event);
 void SetBackground();
 void display();
 
+// libgraphics 中已实现、但未在头文件中声明的计时器函数
+void startTimer(int id, int timeinterval);
+void cancelTimer(int id);
+
+// 正在处理的消息的等待时间
+double messageAge();
+
+// 游戏核心所用的界面钩子，由 libgraphics 实现
+static tetPlatform win32Platform =
+{
+    registerTimerEvent,
+    startTimer,
+    cancelTimer,
+    display,
+    messageAge
+};
+
 void Main()
 {
     SetWindowTitle("Tetris");
@@ -72,6 +94,9 @@ void Main()
     winwidth  = GetWindowWidth();
     winheight = GetWindowHeight();
 
+    // 注册界面钩子，游戏核心通过它控制计时器、刷新界面
+    setPlatform(&win32Platform);
+
     // 注册用户输入事件回调函数
     registerCharEvent(CharEventProcess);
     registerMouseEvent(MouseEventProcess);
@@ -117,12 +142,19 @@ void KeyboardEventProcess(int key, int event)
     uiGetKeyboard(key, event);
 
     // 一次按下/抬起中，键位只处理一次
+    // 只有左右键的松开需要告知游戏逻辑，以结束自动重复
     if (event == KEY_UP)
     {
+        if (getGameStatu() == ON_PLAYING && (key == Key_Left || key == Key_Right))
+            queueAction(key == Key_Left ? ACT_LEFT : ACT_RIGHT, true);
         display();
         return;
     }
 
+    // 在主菜单或游戏中切换是否记录回放，从下一局起生效
+    if ((getGameStatu() == ON_MAIN || getGameStatu() == ON_PLAYING) && key == Key_Record)
+        toggleRecordReplay();
+
     // 当前为暂停状态且按下继续键，则继续游戏
     if (getGameStatu() == ON_PAUSE && key == Key_Pause)
         gameResume();
@@ -132,30 +164,44 @@ void KeyboardEventProcess(int key, int event)
     {
         switch (key)
         {
+            // 游戏操作放入输入队列，由游戏逻辑在对应的帧执行并刷新界面
             case Key_Left:
-                move(TM_LEFT);
-                break;
+                queueAction(ACT_LEFT, false);
+                return;
 
             case Key_Right:
-                move(TM_RIGHT);
-                break;
+                queueAction(ACT_RIGHT, false);
+                return;
 
             case Key_Rotate:
-                rotate();
-                break;
+                queueAction(ACT_ROTATE, false);
+                return;
 
             case Key_Drop:
-                drop();
-                break;
+                queueAction(ACT_DROP, false);
+                return;
 
             case Key_SpeedUp:
-                move(TM_DOWN);
-                break;
+                queueAction(ACT_SOFTDROP, false);
+                return;
 
             case Key_Hold:
-                hold();
+                queueAction(ACT_HOLD, false);
+                return;
+
+            case Key_AutoPlay:
+                toggleAutoPlay();
                 break;
 
+            // 撤销、重做立即生效并刷新界面，不经过输入队列
+            case Key_Undo:
+                undoPlacement();
+                return;
+
+            case Key_Redo:
+                redoPlacement();
+                return;
+
             case Key_Pause:
                 gamePause();
                 break;
@@ -187,6 +233,17 @@ void KeyboardEventProcess(int key, int event)
     display();
 }
 
+/*
+ * 函数名：messageAge
+ * -------------
+ * 正在处理的消息从产生到现在经过的秒数：GetMessageTime 与 GetTickCount 同为开机以来的毫秒数，
+ * 按无符号数相减，系统运行超过49.7天时钟回绕也不影响
+ */
+double messageAge()
+{
+    return (DWORD)(GetTickCount() - (DWORD)GetMessageTime()) / 1000.0;
+}
+
 /*
  * 函数名：SetBackground
  * -------------
@@ -254,6 +311,12 @@ void display()
             MsgBoxSave();
             break;
 
+        // 正在后台保存（分数或存档），完成后切换为成功或失败
+        case ON_SAVING:
+            dispHeader("Saving...");
+            dispAllBlocks();
+            break;
+
         // 操作成功
         case ON_SUCCESS:
             dispHeader("Congratulations!");
@@ -0,0 +1,354 @@
+/*
+ * 项目：Tetris
+ * 文件名：movegen.c
+ * 概览：落点生成模块
+ * -------------
+ * 负责功能：
+ *      以位运算扩展方块可到达的状态，列举所有可落定的位置
+ *      以广度优先搜索求到达指定落点的最短操作序列
+ */
+
+#include <string.h>
+
+#include "tetris.h"   // 需要方块形态表
+#include "movegen.h"  // 本模块
+
+/* 位置掩码
+ * 对某一方向、某一中心格横坐标 x，第 y 位代表中心格位于 (x, y) 的状态
+ * 方块堆只有 MaxCoordY+1 行，unsigned long 足以容纳
+ */
+typedef unsigned long tetSpan;
+
+// 由方向、中心格坐标得到状态编号，及其逆运算
+#define StateOf(o, x, y)  ((((o) * (MaxCoordY+1)) + (y)) * (MaxCoordX+1) + (x))
+#define StateX(id)        ((id) % (MaxCoordX+1))
+#define StateY(id)        ((id) / (MaxCoordX+1) % (MaxCoordY+1))
+#define StateO(id)        ((id) / ((MaxCoordX+1) * (MaxCoordY+1)))
+
+// 位置掩码 m 中是否包含纵坐标 y
+#define SpanHas(m, y)     (((m) >> (y)) & 1)
+
+
+// 内部函数声明
+void    freeSpans(const tetBoard* board, tetType type, tetSpan free[4][MaxCoordX+1]);
+tetSpan fillDown(tetSpan gen, tetSpan pro);
+int     kickX(const tetShape* s, int x);
+void    canonOrients(tetType type, int canon[4]);
+
+
+/* （内部函数）
+ * 函数名称：freeSpans
+ * 函数原型：void freeSpans(const tetBoard* board, tetType type, tetSpan free[4][MaxCoordX+1])
+ * 功能描述：对 type 型方块的每个方向、每个中心格横坐标，求出方块可以停留（无碰撞）的纵坐标
+ * 副作用？：改变传入的数组
+ *
+ * 参数描述：方块堆 board :: const tetBoard*
+ *         方块类型 type :: tetType
+ *         结果 free :: tetSpan[4][MaxCoordX+1]，越过左右边界的横坐标为0
+ * 返回类型：无
+ * --------------
+ * 使用方法：freeSpans(&yourBoard, TET_T, free);
+ */
+void freeSpans(const tetBoard* board, tetType type, tetSpan free[4][MaxCoordX+1])
+{
+    tetSpan col[MaxCoordX+1];
+    int x, y, o, i, top = 0;
+
+    // 将行掩码转置为列掩码，只需转置到最高的一列为止
+    for (x = 0; x <= MaxCoordX; ++x)
+    {
+        col[x] = 0;
+        if (board->heights[x] > top)
+            top = board->heights[x];
+    }
+    for (y = 0; y < top; ++y)
+    {
+        tetRow row = board->rows[y];
+        while (row)
+        {
+            col[__builtin_ctz(row)] |= 1UL << y;
+            row &= row - 1;
+        }
+    }
+
+    // 方块的4个格子各自对应一列，将该列的占用情况按格子的纵向偏移平移后求并，
+    // 即得到方块在各纵坐标上是否碰撞；超出顶端的部分列掩码为0，不会碰撞
+    for (o = 0; o < 4; ++o)
+    {
+        const tetShape* s = &shapeTable[type][o];
+        tetSpan valid = ((1UL << (MaxCoordY+1)) - 1) & ~((1UL << -s->minY) - 1);
+
+        for (x = 0; x <= MaxCoordX; ++x)
+        {
+            if (x + s->minX < 0 || x + s->maxX > MaxCoordX)
+            {
+                free[o][x] = 0;
+                continue;
+            }
+
+            tetSpan hit = col[x];
+            for (i = 0; i < 3; ++i)
+            {
+                int dx = s->surround[i].x;
+                int dy = s->surround[i].y;
+                hit |= dy >= 0 ? col[x + dx] >> dy : col[x + dx] << -dy;
+            }
+            free[o][x] = valid & ~hit;
+        }
+    }
+}
+
+/* （内部函数）
+ * 函数名称：fillDown
+ * 函数原型：tetSpan fillDown(tetSpan gen, tetSpan pro)
+ * 功能描述：由已到达的位置 gen 在无碰撞的位置 pro 中一直向下移动，求所有能到达的位置
+ *          每步将可移动的距离加倍，5步即可覆盖整个方块堆的高度
+ * 副作用？：无
+ *
+ * 参数描述：已到达的位置 gen :: tetSpan
+ *         无碰撞的位置 pro :: tetSpan
+ * 返回类型：tetSpan，向下移动后能到达的位置（包括 gen 本身）
+ * --------------
+ * 使用方法：reach = fillDown(reach, free[o][x]);
+ */
+tetSpan fillDown(tetSpan gen, tetSpan pro)
+{
+    gen |= pro & (gen >> 1);
+    pro &= pro >> 1;
+    gen |= pro & (gen >> 2);
+    pro &= pro >> 2;
+    gen |= pro & (gen >> 4);
+    pro &= pro >> 4;
+    gen |= pro & (gen >> 8);
+    pro &= pro >> 8;
+    gen |= pro & (gen >> 16);
+    return gen;
+}
+
+/* （内部函数）
+ * 函数名：kickX
+ * -------------
+ * 旋转到形态 s 后越过左右边界，则平移回边界内，规则同 rotateBlock
+ */
+int kickX(const tetShape* s, int x)
+{
+    if (x + s->minX < 0)
+        return -s->minX;
+    else if (x + s->maxX > MaxCoordX)
+        return MaxCoordX - s->maxX;
+    return x;
+}
+
+/* （内部函数）
+ * 函数名：canonOrients
+ * -------------
+ * 对 type 型方块的每个方向，找出形态与其相同的最小方向序号
+ * 形态相同的两个方向，只要包围盒位置相同，占据的格子就相同，视为同一落点
+ */
+void canonOrients(tetType type, int canon[4])
+{
+    int o, k;
+    for (o = 0; o < 4; ++o)
+    {
+        const tetShape* s = &shapeTable[type][o];
+        canon[o] = o;
+        for (k = 0; k < o; ++k)
+        {
+            const tetShape* t = &shapeTable[type][k];
+            if (t->maxX - t->minX == s->maxX - s->minX
+                && t->maxY - t->minY == s->maxY - s->minY
+                && memcmp(t->mask, s->mask, sizeof(s->mask)) == 0)
+            {
+                canon[o] = k;
+                break;
+            }
+        }
+    }
+}
+
+/*
+ * 函数名：genPlacements
+ * -------------
+ * 反复做左右移动、旋转、向下移动三种扩展，直到可到达的位置不再增加；
+ * 其中下一格有碰撞的位置即为落点
+ */
+int genPlacements(const tetBoard* board, const tetBlock* start, tetPlacementList* out)
+{
+    tetSpan free[4][MaxCoordX+1];
+    tetSpan reach[4][MaxCoordX+1];
+    tetSpan landed[4][MaxCoordX+1];  // 已记录的落点，以规范方向、包围盒左下角编号
+    int canon[4];
+    int o, x, t, tx;
+    bool changed;
+
+    freeSpans(board, start->type, free);
+    memset(reach, 0, sizeof(reach));
+    reach[start->orient][start->coord.x] = 1UL << start->coord.y;
+
+    do {
+        changed = false;
+
+        for (o = 0; o < 4; ++o)
+        {
+            // 自左向右、再自右向左各扫一遍，左右移动一遍即可传遍整行
+            for (x = 0; x <= MaxCoordX; ++x)
+            {
+                tetSpan r = reach[o][x];
+                if (x > 0)
+                    r |= reach[o][x-1] & free[o][x];
+                r = fillDown(r, free[o][x]);
+                if (r != reach[o][x])
+                {
+                    reach[o][x] = r;
+                    changed = true;
+                }
+            }
+            for (x = MaxCoordX; x >= 0; --x)
+            {
+                tetSpan r = reach[o][x];
+                if (x < MaxCoordX)
+                    r |= reach[o][x+1] & free[o][x];
+                r = fillDown(r, free[o][x]);
+                if (r != reach[o][x])
+                {
+                    reach[o][x] = r;
+                    changed = true;
+                }
+            }
+
+            // O型方块无法旋转
+            if (start->type == TET_O)
+                continue;
+
+            // 旋转到下一个方向，纵坐标不变
+            t = (o + 1) & 3;
+            for (x = 0; x <= MaxCoordX; ++x)
+            {
+                if (reach[o][x] == 0)
+                    continue;
+                tx = kickX(&shapeTable[start->type][t], x);
+                tetSpan r = reach[t][tx] | (reach[o][x] & free[t][tx]);
+                if (r != reach[t][tx])
+                {
+                    reach[t][tx] = r;
+                    changed = true;
+                }
+            }
+        }
+    } while (changed);
+
+    // 可到达且向下一格有碰撞（或已触底）的位置即为落点
+    canonOrients(start->type, canon);
+    memset(landed, 0, sizeof(landed));
+    out->count = 0;
+
+    for (o = 0; o < 4; ++o)
+    {
+        const tetShape* s = &shapeTable[start->type][o];
+        int k = canon[o];
+
+        for (x = 0; x <= MaxCoordX; ++x)
+        {
+            tetSpan lock = reach[o][x] & ~(free[o][x] << 1);
+            if (lock == 0)
+                continue;
+
+            // 换算为包围盒左下角的位置，与形态相同的方向上已记录的落点去重
+            int left = x + s->minX;
+            tetSpan bottom = (lock >> -s->minY) & ~landed[k][left];
+            landed[k][left] |= bottom;
+
+            while (bottom && out->count < MaxPlacements)
+            {
+                tetBlock* b = &out->list[out->count++];
+                *b = *start;
+                b->orient  = o;
+                b->coord.x = x;
+                b->coord.y = __builtin_ctzl(bottom) - s->minY;
+                bottom &= bottom - 1;
+            }
+        }
+    }
+
+    return out->count;
+}
+
+/*
+ * 函数名：placementPath
+ * -------------
+ * 由起始状态做广度优先搜索，到达目标状态后沿搜索树倒推，再反转为正序
+ */
+int placementPath(const tetBoard* board, const tetBlock* start,
+                  const tetBlock* target, tetStep path[])
+{
+    tetSpan free[4][MaxCoordX+1];
+    tetSpan seen[4][MaxCoordX+1];
+    short parent[MaxStates];
+    unsigned char via[MaxStates];
+    short queue[MaxStates];
+    int head = 0, tail = 0;
+    int goal = StateOf(target->orient, target->coord.x, target->coord.y);
+    int id, len, k;
+
+    freeSpans(board, start->type, free);
+    memset(seen, 0, sizeof(seen));
+
+    id = StateOf(start->orient, start->coord.x, start->coord.y);
+    seen[start->orient][start->coord.x] = 1UL << start->coord.y;
+    parent[id] = -1;
+    queue[tail++] = id;
+
+    while (head < tail && !SpanHas(seen[target->orient][target->coord.x], target->coord.y))
+    {
+        int from = queue[head++];
+        int o = StateO(from), x = StateX(from), y = StateY(from);
+        int step;
+
+        for (step = STEP_LEFT; step <= STEP_ROTATE; ++step)
+        {
+            int no = o, nx = x, ny = y;
+            switch (step)
+            {
+            case STEP_LEFT:
+                nx--;
+                break;
+            case STEP_RIGHT:
+                nx++;
+                break;
+            case STEP_DOWN:
+                ny--;
+                break;
+            case STEP_ROTATE:
+                if (start->type == TET_O)
+                    continue;
+                no = (o + 1) & 3;
+                nx = kickX(&shapeTable[start->type][no], x);
+                break;
+            }
+
+            if (nx < 0 || nx > MaxCoordX || ny < 0 || !SpanHas(free[no][nx], ny)
+                || SpanHas(seen[no][nx], ny))
+                continue;
+
+            seen[no][nx] |= 1UL << ny;
+            id = StateOf(no, nx, ny);
+            parent[id] = from;
+            via[id] = step;
+            queue[tail++] = id;
+        }
+    }
+
+    if (!SpanHas(seen[target->orient][target->coord.x], target->coord.y))
+        return -1;
+
+    for (len = 0, id = goal; parent[id] >= 0; id = parent[id])
+        path[len++] = via[id];
+
+    for (k = 0; k < len / 2; ++k)
+    {
+        tetStep tmp       = path[k];
+        path[k]           = path[len - 1 - k];
+        path[len - 1 - k] = tmp;
+    }
+    return len;
+}
@@ -0,0 +1,94 @@
+/*
+ * 项目：Tetris
+ * 文件名：movegen.h
+ * 概览：落点生成模块
+ * -------------
+ * 主要内容：
+ *      列举一个方块在方块堆中所有可以落定的位置（落点），
+ *      以及到达每个落点所需的操作序列
+ *
+ * 从方块的当前状态出发，以左移、右移、下移、旋转四种操作所能到达的 (x, y, 方向) 状态中，
+ * 向下移动会碰撞的状态即为可落定的状态。形态相同、占据格子也相同的落点
+ *（如 O 型的4个方向、S/Z/I 的对称方向）只保留一个
+ *
+ * 列举落点时，每个 (方向, x) 的所有纵坐标用一个位掩码表示，
+ * 先由各列占用位掩码算出方块可以停留的位置，再以位运算扩展可到达的位置，
+ * 不必逐个状态做碰撞检测，足以在搜索中对每个方块调用
+ * 到达某一落点的操作序列只在需要时另做一次广度优先搜索得到，因而是最短的
+ *
+ * 外部接口：
+ *      genPlacements
+ *      placementPath
+ */
+
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include "tetris.h"  // 需要取得方块及方块堆定义
+
+// 状态总数：方向 * 纵坐标 * 横坐标，也是操作序列长度的上限
+#define MaxStates   (4 * (MaxCoordY+1) * (MaxCoordX+1))
+
+// 落点个数上限，每个方向每列至多约 (MaxCoordY+1)/2 个落点，512 足够
+#define MaxPlacements 512
+
+
+/* 操作定义
+ *      STEP_LEFT   - 左移一格
+ *      STEP_RIGHT  - 右移一格
+ *      STEP_DOWN   - 下移一格（不落定）
+ *      STEP_ROTATE - 顺时针旋转
+ */
+typedef enum {
+  STEP_LEFT, STEP_RIGHT, STEP_DOWN, STEP_ROTATE
+} tetStep;
+
+
+/* 落点列表
+ *      count - 落点个数
+ *      list  - 各个落点，即落定时的方块（类型、颜色、方向、中心格坐标）
+ */
+typedef struct {
+  int      count;
+  tetBlock list[MaxPlacements];
+} tetPlacementList;
+
+
+/*
+ * 函数名称：genPlacements
+ * 函数原型：int genPlacements(const tetBoard* board, const tetBlock* start, tetPlacementList* out)
+ * 功能描述：列举方块 start 在方块堆 board 中能够到达的所有落点（已去重）
+ * 副作用？：改变传入的落点列表
+ *
+ * 参数描述：方块堆 board :: const tetBoard*
+ *         起始方块 start :: const tetBlock*（通常即正在下落的方块，
+ *                                       须处于无碰撞的位置，且中心格不高于 MaxCoordY）
+ *         落点列表 out :: tetPlacementList*
+ * 返回类型：int，落点个数（同 out->count）
+ * --------------
+ * 使用方法：int n = genPlacements(&yourGame->stored, &yourGame->falling, &yourList);
+ */
+int genPlacements(const tetBoard* board, const tetBlock* start, tetPlacementList* out);
+
+
+/*
+ * 函数名称：placementPath
+ * 函数原型：int placementPath(const tetBoard* board, const tetBlock* start,
+ *                            const tetBlock* target, tetStep path[])
+ * 功能描述：求由方块 start 到达 target 的最短操作序列（target 通常取自 genPlacements 的结果）
+ *          依次执行这些操作后方块恰好位于 target 上，此时再 drop 即在此落定
+ * 副作用？：改变传入的数组
+ *
+ * 参数描述：方块堆 board :: const tetBoard*
+ *         起始方块 start :: const tetBlock*
+ *         目标方块 target :: const tetBlock*
+ *         操作序列 path :: tetStep[]（长度不少于 MaxStates）
+ * 返回类型：int，操作序列长度；无法到达时为 -1
+ * --------------
+ * 使用方法：tetStep path[MaxStates];
+ *          int len = placementPath(&yourGame->stored, &yourGame->falling, &yourList.list[i], path);
+ */
+int placementPath(const tetBoard* board, const tetBlock* start,
+                  const tetBlock* target, tetStep path[]);
+
+#endif
@@ -0,0 +1,661 @@
+/*
+ * 项目：Tetris
+ * 文件名：perft.c
+ * 概览：落点计数校验程序 tetris-perft
+ * -------------
+ * 负责功能：
+ *      仿照国际象棋引擎的 perft，从给定的方块堆与方块序列出发，
+ *      统计依次放置 1 ~ N 个方块的所有不同落点序列数，并报告每秒节点数
+ *      同时以逐状态搜索的慢速参照实现计数，两者逐层比较，并在每个节点比较落点集合，
+ *      作为改写落点生成（movegen.c）及碰撞检测等核心代码时的正确性与速度标尺
+ *      参照实现不经过被校验的代码：方块堆为自己的逐格数组，不用位棋盘；
+ *      方块的格子由自带的初始形态逐次旋转（复数乘法）得到，不用形态表；碰撞逐格检测；
+ *      移动、旋转、落定、消行也都自行完成（规则与游戏中相同，消行为逐行 memcpy 下移），
+ *      并在每个节点把自己消行后的方块堆与 addToBoard、eliminateLines 得到的比较
+ *      （占用、颜色、各列高度及增量维护的哈希值），
+ *      因此位棋盘、形态表、blockCheck、消行等有错时，两者的结果会不同
+ *
+ * 用法：tetris-perft [-d 深度] [-s 种子] [-k 方块数] [-b] [-q 方块序列] [-f]
+ *      -d  放置的方块数 N，默认 3
+ *      -s  随机种子，决定起始局面及方块序列，默认 1
+ *      -k  起始局面为电脑玩家由种子开局后落下的方块数，默认 0（空方块堆）
+ *      -b  使用 7-bag 方块序列，默认为均匀随机
+ *      -q  直接给出方块序列，如 TIOLJSZ，默认取该局之后的方块
+ *      -f  只运行快速实现，不运行参照实现（用于更大的深度下测速）
+ *
+ * 每个节点为一个落点：放置后消行，再以下一个方块继续。最后一层只计数不展开
+ * 不使用 hold；出现位置已被占据的局面没有落点。
+ * 有不一致（计数、落点集合或消行后的方块堆）时返回值为1
+ * 只依赖核心库（libtetris_core.a）
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tetris.h"   // 需要方块操作及碰撞检测
+#include "flow.h"     // 需要游戏上下文
+#include "rng.h"      // 需要方块序列
+#include "platform.h" // 需要计时
+#include "movegen.h"  // 被校验的落点生成
+#include "ai.h"       // 由电脑玩家生成起始局面
+
+// 深度上限
+#define MaxDepth 16
+
+#define Min(x,y) ((x)<(y) ? (x):(y))
+#define Max(x,y) ((x)>(y) ? (x):(y))
+
+// 方块类型的字母，下标为 tetType
+#define TypeLetters "IJLOSZT"
+
+// 参照实现自带的初始形态：方向0时3个周围格相对中心格的坐标，下标为 tetType
+static const tetCoord refSpawn[typeNum][3] =
+{
+    {{ 0, -1}, { 0,  1}, { 0,  2}},   // I
+    {{-1,  0}, { 0,  1}, { 0,  2}},   // J
+    {{ 1,  0}, { 0,  1}, { 0,  2}},   // L
+    {{ 1,  0}, { 0,  1}, { 1,  1}},   // O
+    {{-1,  0}, { 0,  1}, { 1,  1}},   // S
+    {{-1,  1}, { 0,  1}, { 1,  0}},   // Z
+    {{ 0,  1}, {-1,  0}, { 1,  0}}    // T
+};
+
+
+/* 参照实现的方块堆：逐格的占用及颜色，第 y 行第 x 列为 [y][x]
+ *      taken - 是否被占用
+ *      color - 颜色，空格为0
+ */
+typedef struct {
+  bool          taken[MaxCoordY+1][MaxCoordX+1];
+  unsigned char color[MaxCoordY+1][MaxCoordX+1];
+} tetRefGrid;
+
+
+/* 参照实现的计数及检查结果
+ *      count      - 各层的节点数
+ *      mismatches - 落点集合与快速实现不一致的节点数
+ *      boards     - 放置并消行后，方块堆与快速实现不一致的节点数
+ */
+typedef struct {
+  long long count[MaxDepth];
+  long long mismatches;
+  long long boards;
+} tetPerftRef;
+
+
+// 内部函数声明
+tetBlock spawnPiece(tetType type);
+uint64_t footprint(const tetBlock* b);
+void     sortedFootprints(const tetBlock* list, int n, uint64_t* keys);
+void     refCells(const tetBlock* b, tetCoord* cells);
+tetBoundStatu refCheck(const tetRefGrid* grid, const tetBlock* b);
+uint64_t refFootprint(const tetBlock* b);
+void     refLoadGrid(tetRefGrid* grid, const tetBoard* board);
+void     refAddToGrid(tetRefGrid* grid, const tetBlock* b);
+int      refEliminate(tetRefGrid* grid);
+bool     refSameBoard(const tetRefGrid* grid, const tetBoard* board);
+int      refPlacements(const tetRefGrid* grid, const tetBlock* start, tetBlock* out);
+void     perftFast(const tetBoard* board, const tetType* queue, int depth, long long* count);
+void     perftRef(const tetBoard* board, const tetRefGrid* grid, const tetType* queue,
+                  int depth, int level, tetPerftRef* ref);
+void     reportMismatch(const tetBoard* board, tetType type);
+int      compareKey(const void* a, const void* b);
+
+
+int main(int argc, char* argv[])
+{
+    int depth  = 3;
+    int prefix = 0;
+    unsigned long long seed = 1;
+    tetRandMode mode = RAND_UNIFORM;
+    const char* letters = NULL;
+    bool fastOnly = false;
+    tetType queue[MaxDepth];
+    int i;
+
+    // 解析命令行参数
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+            depth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+            prefix = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-b") == 0)
+            mode = RAND_BAG;
+        else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc)
+            letters = argv[++i];
+        else if (strcmp(argv[i], "-f") == 0)
+            fastOnly = true;
+        else
+        {
+            fprintf(stderr, "usage: %s [-d depth] [-s seed] [-k pieces] [-b] [-q queue] [-f]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (depth < 1 || depth > MaxDepth || prefix < 0)
+    {
+        fprintf(stderr, "depth must be 1 ~ %d, pieces must not be negative\n", MaxDepth);
+        return 1;
+    }
+
+    // 由电脑玩家落下若干方块，得到起始局面
+    tetGame g;
+    tetAI ai;
+    initAI(&ai);
+    initGame(&g, seed, mode);
+    for (i = 0; i < prefix && !g.over; ++i)
+        aiPlay(&ai, &g);
+
+    // 方块序列：给定的字母，或正在下落、下一个及其后由生成器产生的方块
+    if (letters != NULL)
+    {
+        if ((int)strlen(letters) < depth)
+        {
+            fprintf(stderr, "queue must have at least %d pieces\n", depth);
+            return 1;
+        }
+        for (i = 0; i < depth; ++i)
+        {
+            const char* p = strchr(TypeLetters, letters[i]);
+            if (p == NULL || letters[i] == '\0')
+            {
+                fprintf(stderr, "unknown piece '%c', use %s\n", letters[i], TypeLetters);
+                return 1;
+            }
+            queue[i] = (tetType)(p - TypeLetters);
+        }
+    }
+    else
+    {
+        tetRandomizer r = g.random;
+        queue[0] = g.falling.type;
+        for (i = 1; i < depth; ++i)
+            queue[i] = i == 1 ? g.nextBlock.type : randomType(&r);
+    }
+
+    printf("start: %d pieces played, queue ", prefix);
+    for (i = 0; i < depth; ++i)
+        putchar(TypeLetters[queue[i]]);
+    printf("\n%-6s %16s %16s\n", "depth", "perft", "reference");
+
+    // 快速实现：一次递归得到各层计数
+    long long fast[MaxDepth] = { 0 };
+    double begin = platNow();
+    perftFast(&g.stored, queue, depth, fast);
+    double fastTime = platNow() - begin;
+
+    // 参照实现
+    tetPerftRef ref;
+    tetRefGrid grid;
+    double refTime = 0;
+    memset(&ref, 0, sizeof(ref));
+    if (!fastOnly)
+    {
+        refLoadGrid(&grid, &g.stored);
+        begin = platNow();
+        perftRef(&g.stored, &grid, queue, depth, 0, &ref);
+        refTime = platNow() - begin;
+    }
+
+    // 各层的计数在同一次递归中得到，逐层只报告计数，速度按所有节点报告一次
+    bool ok = true;
+    long long fastNodes = 0, refNodes = 0;
+    for (i = 0; i < depth; ++i)
+    {
+        fastNodes += fast[i];
+        refNodes  += ref.count[i];
+        if (fastOnly)
+            printf("%-6d %16lld\n", i + 1, fast[i]);
+        else
+        {
+            printf("%-6d %16lld %16lld%s\n", i + 1, fast[i], ref.count[i],
+                   fast[i] == ref.count[i] ? "" : "  MISMATCH");
+            ok = ok && fast[i] == ref.count[i];
+        }
+    }
+
+    if (fastTime <= 0)
+        fastTime = 1e-9;
+    if (refTime <= 0)
+        refTime = 1e-9;
+    printf("%-6s %16lld", "total", fastNodes);
+    if (!fastOnly)
+        printf(" %16lld", refNodes);
+    printf("\n%-6s %16.0f", "nodes/s", fastNodes / fastTime);
+    if (!fastOnly)
+        printf(" %16.0f", refNodes / refTime);
+    printf("\n");
+
+    if (!fastOnly)
+    {
+        ok = ok && ref.mismatches == 0 && ref.boards == 0;
+        printf("nodes with different placement sets: %lld\n", ref.mismatches);
+        printf("nodes with different boards after line clears: %lld\n", ref.boards);
+        printf("%s\n", ok ? "OK" : "FAILED");
+    }
+    return ok ? 0 : 1;
+}
+
+/* （内部函数）
+ * 函数名：spawnPiece
+ * -------------
+ * 生成位于出现位置、方向为0的方块
+ */
+tetBlock spawnPiece(tetType type)
+{
+    tetBlock b;
+    memset(&b, 0, sizeof(b));
+    b.type = type;
+    initBlock(&b);
+    moveToTop(&b);
+    return b;
+}
+
+/* （内部函数）
+ * 函数名：footprint
+ * -------------
+ * 方块所占格子的编码：最低行的纵坐标（5位）及其上各行的占用掩码（各10位）
+ * 占据的格子相同则编码相同，与类型内的方向无关
+ */
+uint64_t footprint(const tetBlock* b)
+{
+    const tetShape* s = ShapeOf(*b);
+    uint64_t key = (uint64_t)(b->coord.y + s->minY);
+    int i;
+
+    for (i = 0; i <= s->maxY - s->minY; ++i)
+        key |= (uint64_t)(s->mask[i] << (b->coord.x + s->minX)) << (5 + 10 * i);
+    return key;
+}
+
+/* （内部函数）
+ * 函数名：sortedFootprints
+ * -------------
+ * 求一组落点的编码并排序
+ */
+void sortedFootprints(const tetBlock* list, int n, uint64_t* keys)
+{
+    int i;
+    for (i = 0; i < n; ++i)
+        keys[i] = footprint(&list[i]);
+    qsort(keys, n, sizeof(uint64_t), compareKey);
+}
+
+/* （内部函数）
+ * 函数名：refCells
+ * -------------
+ * 方块所占的4个格子的坐标：中心格，及初始形态的周围格绕中心格顺时针旋转 orient 次
+ * （复数乘以 -i，即 (x, y) 变为 (y, -x)）后平移到中心格；O型方块不旋转
+ */
+void refCells(const tetBlock* b, tetCoord* cells)
+{
+    int i, k, tmp;
+
+    cells[0] = b->coord;
+    for (i = 0; i < 3; ++i)
+    {
+        tetCoord c = refSpawn[b->type][i];
+        for (k = 0; b->type != TET_O && k < b->orient; ++k)
+        {
+            tmp = -c.x;
+            c.x = c.y;
+            c.y = tmp;
+        }
+        cells[i + 1].x = b->coord.x + c.x;
+        cells[i + 1].y = b->coord.y + c.y;
+    }
+}
+
+/* （内部函数）
+ * 函数名：refCheck
+ * -------------
+ * 逐格的碰撞检测：先检测左右边界，再检测底部及方块堆中的格子；超出顶端的格子不会碰撞
+ */
+tetBoundStatu refCheck(const tetRefGrid* grid, const tetBlock* b)
+{
+    tetCoord cells[4];
+    int i;
+
+    refCells(b, cells);
+    for (i = 0; i < 4; ++i)
+    {
+        if (cells[i].x < 0)
+            return LEFT_BOUND;
+        if (cells[i].x > MaxCoordX)
+            return RIGHT_BOUND;
+    }
+    for (i = 0; i < 4; ++i)
+    {
+        if (cells[i].y < 0)
+            return COLLIDED;
+        if (cells[i].y <= MaxCoordY && grid->taken[cells[i].y][cells[i].x])
+            return COLLIDED;
+    }
+    return FREEMOVE;
+}
+
+/* （内部函数）
+ * 函数名：refFootprint
+ * -------------
+ * 由 refCells 得到的格子编码，格式与 footprint 相同，形态表正确时两者相等
+ */
+uint64_t refFootprint(const tetBlock* b)
+{
+    tetCoord cells[4];
+    int i, low;
+
+    refCells(b, cells);
+    for (i = 1, low = cells[0].y; i < 4; ++i)
+        low = Min(low, cells[i].y);
+
+    uint64_t key = (uint64_t)low;
+    for (i = 0; i < 4; ++i)
+        key |= (uint64_t)1 << (5 + 10 * (cells[i].y - low) + cells[i].x);
+    return key;
+}
+
+/* （内部函数）
+ * 函数名：refLoadGrid
+ * -------------
+ * 由起始局面的方块堆逐格得到参照实现的方块堆
+ */
+void refLoadGrid(tetRefGrid* grid, const tetBoard* board)
+{
+    int x, y;
+
+    for (y = 0; y <= MaxCoordY; ++y)
+    {
+        for (x = 0; x <= MaxCoordX; ++x)
+        {
+            grid->taken[y][x] = CellTaken(*board, x, y);
+            grid->color[y][x] = grid->taken[y][x] ? board->color[y][x] : 0;
+        }
+    }
+}
+
+/* （内部函数）
+ * 函数名：refAddToGrid
+ * -------------
+ * 逐格将方块加入方块堆，超出顶端的格子舍去
+ */
+void refAddToGrid(tetRefGrid* grid, const tetBlock* b)
+{
+    tetCoord cells[4];
+    int i;
+
+    refCells(b, cells);
+    for (i = 0; i < 4; ++i)
+    {
+        if (cells[i].y > MaxCoordY)
+            continue;
+        grid->taken[cells[i].y][cells[i].x] = true;
+        grid->color[cells[i].y][cells[i].x] = b->color;
+    }
+}
+
+/* （内部函数）
+ * 函数名：refEliminate
+ * -------------
+ * 参照实现的消行：从上到下逐行逐格检测，满行则把其上各行依次 memcpy 下移一行，
+ * 最高一行补为空行；返回消除的行数
+ */
+int refEliminate(tetRefGrid* grid)
+{
+    int x, y, yy;
+    int eliminated = 0;
+    bool lineFilled;
+
+    for (y = MaxCoordY; y >= 0; --y)
+    {
+        lineFilled = true;
+        for (x = 0; x <= MaxCoordX && lineFilled; ++x)
+            lineFilled = grid->taken[y][x];
+        if (!lineFilled)
+            continue;
+
+        for (yy = y; yy < MaxCoordY; ++yy)
+        {
+            memcpy(grid->taken[yy], grid->taken[yy + 1], sizeof(grid->taken[0]));
+            memcpy(grid->color[yy], grid->color[yy + 1], sizeof(grid->color[0]));
+        }
+        memset(grid->taken[MaxCoordY], 0, sizeof(grid->taken[0]));
+        memset(grid->color[MaxCoordY], 0, sizeof(grid->color[0]));
+        eliminated++;
+    }
+    return eliminated;
+}
+
+/* （内部函数）
+ * 函数名：refSameBoard
+ * -------------
+ * 参照实现的方块堆与快速实现的是否一致：逐格比较占用及颜色，各列高度由逐格扫描求出后比较，
+ * 哈希值与由逐格内容重新组成的行掩码全量计算的 boardHash 比较（快速实现的为增量维护）
+ */
+bool refSameBoard(const tetRefGrid* grid, const tetBoard* board)
+{
+    tetBoard rebuilt;
+    int x, y, h;
+
+    memset(&rebuilt, 0, sizeof(rebuilt));
+    for (y = 0; y <= MaxCoordY; ++y)
+    {
+        for (x = 0; x <= MaxCoordX; ++x)
+        {
+            if (grid->taken[y][x] != (bool)CellTaken(*board, x, y) || grid->color[y][x] != board->color[y][x])
+                return false;
+            if (grid->taken[y][x])
+                rebuilt.rows[y] |= (tetRow)(1 << x);
+        }
+    }
+
+    for (x = 0; x <= MaxCoordX; ++x)
+    {
+        for (h = MaxCoordY + 1; h > 0 && !grid->taken[h - 1][x]; --h)
+            ;
+        if (board->heights[x] != h)
+            return false;
+    }
+    return board->hash == boardHash(&rebuilt);
+}
+
+/* （内部函数）
+ * 函数名：refPlacements
+ * -------------
+ * 参照实现：从 start 出发逐个状态广度优先搜索，碰撞均由 refCheck 在 grid 上逐格检测：
+ *      左右移动  - 移动一格，有碰撞则不动
+ *      旋转      - 换到下一个方向，越过左右边界时按格子的范围平移回界内，仍有碰撞则不动
+ *      下移      - 下移一格有碰撞（底部或方块堆）时，该状态即为落点
+ * 占据格子相同的落点只保留第一个
+ * 返回落点个数
+ */
+int refPlacements(const tetRefGrid* grid, const tetBlock* start, tetBlock* out)
+{
+    bool seen[4][MaxCoordY + 1][MaxCoordX + 1];
+    tetBlock queue[MaxStates];
+    uint64_t keys[MaxPlacements];
+    tetCoord cells[4];
+    int head = 0, tail = 0, count = 0;
+    int i, k;
+
+    if (refCheck(grid, start) != FREEMOVE)
+        return 0;
+
+    memset(seen, 0, sizeof(seen));
+    seen[start->orient][start->coord.y][start->coord.x] = true;
+    queue[tail++] = *start;
+
+    while (head < tail)
+    {
+        tetBlock cur = queue[head++];
+        tetBlock next[4];
+
+        // 左移、右移
+        for (i = 0; i < 2; ++i)
+        {
+            next[i] = cur;
+            next[i].coord.x += i == 0 ? -1 : 1;
+            if (refCheck(grid, &next[i]) != FREEMOVE)
+                next[i] = cur;
+        }
+
+        // 旋转
+        next[2] = cur;
+        if (cur.type != TET_O)
+        {
+            next[2].orient = (cur.orient + 1) & 3;
+            refCells(&next[2], cells);
+            int left = cells[0].x, right = cells[0].x;
+            for (k = 1; k < 4; ++k)
+            {
+                left  = Min(left, cells[k].x);
+                right = Max(right, cells[k].x);
+            }
+            if (left < 0)
+                next[2].coord.x -= left;
+            else if (right > MaxCoordX)
+                next[2].coord.x -= right - MaxCoordX;
+            if (refCheck(grid, &next[2]) != FREEMOVE)
+                next[2] = cur;
+        }
+
+        // 下移，碰撞时不落定
+        next[3] = cur;
+        next[3].coord.y--;
+        bool landed = refCheck(grid, &next[3]) == COLLIDED;
+        if (landed)
+        {
+            next[3] = cur;
+            uint64_t key = refFootprint(&cur);
+            for (k = 0; k < count && keys[k] != key; ++k)
+                ;
+            if (k == count)
+            {
+                keys[count]  = key;
+                out[count++] = cur;
+            }
+        }
+
+        for (i = 0; i < 4; ++i)
+        {
+            bool* s = &seen[next[i].orient][next[i].coord.y][next[i].coord.x];
+            if (!*s)
+            {
+                *s = true;
+                queue[tail++] = next[i];
+            }
+        }
+    }
+    return count;
+}
+
+/* （内部函数）
+ * 函数名：perftFast
+ * -------------
+ * 以 genPlacements 列举落点，count[i] 累加第 i+1 层的节点数
+ */
+void perftFast(const tetBoard* board, const tetType* queue, int depth, long long* count)
+{
+    tetPlacementList list;
+    tetBlock start = spawnPiece(queue[0]);
+    int i;
+
+    if (blockCheck(board, &start) != FREEMOVE)
+        return;
+
+    int n = genPlacements(board, &start, &list);
+    count[0] += n;
+    if (depth == 1)
+        return;
+
+    for (i = 0; i < n; ++i)
+    {
+        tetBoard next = *board;
+        addToBoard(&next, &list.list[i]);
+        eliminateLines(&next);
+        perftFast(&next, queue + 1, depth - 1, count + 1);
+    }
+}
+
+/* （内部函数）
+ * 函数名：perftRef
+ * -------------
+ * 以参照实现在 grid 上列举落点，并与 genPlacements 在 board 上的落点集合比较；
+ * 参照实现的落点编码及其后的方块堆也由自己逐格得出，每个落点放置并消行后
+ * 与 addToBoard、eliminateLines 得到的 board 比较，两者再分别传给下一层
+ */
+void perftRef(const tetBoard* board, const tetRefGrid* grid, const tetType* queue,
+              int depth, int level, tetPerftRef* ref)
+{
+    tetBlock list[MaxPlacements];
+    uint64_t refKeys[MaxPlacements], fastKeys[MaxPlacements];
+    tetPlacementList fast;
+    tetBlock start = spawnPiece(queue[0]);
+    int i;
+
+    int n = refPlacements(grid, &start, list);
+    ref->count[level] += n;
+
+    // 与快速实现比较落点集合
+    int m = blockCheck(board, &start) == FREEMOVE ? genPlacements(board, &start, &fast) : 0;
+    for (i = 0; i < n; ++i)
+        refKeys[i] = refFootprint(&list[i]);
+    qsort(refKeys, n, sizeof(uint64_t), compareKey);
+    sortedFootprints(fast.list, m, fastKeys);
+    if (m != n || memcmp(refKeys, fastKeys, n * sizeof(uint64_t)) != 0)
+    {
+        if (ref->mismatches++ == 0)
+            reportMismatch(board, queue[0]);
+    }
+
+    if (level + 1 == depth)
+        return;
+
+    for (i = 0; i < n; ++i)
+    {
+        tetRefGrid nextGrid = *grid;
+        refAddToGrid(&nextGrid, &list[i]);
+        refEliminate(&nextGrid);
+
+        tetBoard next = *board;
+        addToBoard(&next, &list[i]);
+        eliminateLines(&next);
+        if (!refSameBoard(&nextGrid, &next) && ref->boards++ == 0)
+            reportMismatch(board, queue[0]);
+
+        perftRef(&next, &nextGrid, queue + 1, depth, level + 1, ref);
+    }
+}
+
+/* （内部函数）
+ * 函数名：reportMismatch
+ * -------------
+ * 打印第一个不一致节点的方块堆及方块类型，便于复现
+ */
+void reportMismatch(const tetBoard* board, tetType type)
+{
+    int x, y;
+    fprintf(stderr, "first mismatch: piece %c on board\n", TypeLetters[type]);
+    for (y = MaxCoordY; y >= 0; --y)
+    {
+        fputc('|', stderr);
+        for (x = 0; x <= MaxCoordX; ++x)
+            fputc(board->rows[y] >> x & 1 ? '#' : '.', stderr);
+        fputs("|\n", stderr);
+    }
+}
+
+/* （内部函数）
+ * 函数名：compareKey
+ * -------------
+ * qsort 用的比较函数，由小到大
+ */
+int compareKey(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
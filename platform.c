@@ -0,0 +1,322 @@
+/*
+ * 项目：Tetris
+ * 文件名：platform.c
+ * 概览：平台接口模块
+ * -------------
+ * 负责功能：
+ *      界面钩子的注册与转发
+ *      计时、建目录等与操作系统相关的功能
+ *      线程与信号量
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#include <io.h>
+#else
+#include <time.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#include "platform.h"  // 本模块
+
+// 线程函数及其参数，由 threadEntry 转交给 tetThreadFunc
+typedef struct {
+  tetThreadFunc func;
+  void*         arg;
+} tetThreadStart;
+
+// 当前注册的界面钩子，NULL 代表无界面
+static const tetPlatform* platform = NULL;
+
+/*
+ * 函数名：setPlatform
+ * -------------
+ * 注册界面钩子
+ */
+void setPlatform(const tetPlatform* p)
+{
+    platform = p;
+}
+
+/*
+ * 函数名：platRegisterTimer
+ * -------------
+ * 注册计时器回调函数
+ */
+void platRegisterTimer(tetTimerCallback callback)
+{
+    if (platform != NULL && platform->registerTimer != NULL)
+        platform->registerTimer(callback);
+}
+
+/*
+ * 函数名：platStartTimer
+ * -------------
+ * 启动计时器
+ */
+void platStartTimer(int timerID, int interval)
+{
+    if (platform != NULL && platform->startTimer != NULL)
+        platform->startTimer(timerID, interval);
+}
+
+/*
+ * 函数名：platCancelTimer
+ * -------------
+ * 停止计时器
+ */
+void platCancelTimer(int timerID)
+{
+    if (platform != NULL && platform->cancelTimer != NULL)
+        platform->cancelTimer(timerID);
+}
+
+/*
+ * 函数名：platDisplay
+ * -------------
+ * 刷新界面
+ */
+void platDisplay()
+{
+    if (platform != NULL && platform->display != NULL)
+        platform->display();
+}
+
+/*
+ * 函数名：platNow
+ * -------------
+ * 取得单调递增的高精度时间（秒）
+ */
+double platNow()
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+
+    return (double)now.QuadPart / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+/*
+ * 函数名：platEventTime
+ * -------------
+ * 当前时刻减去消息已等待的时间；钩子给出负值（系统时钟回绕等）时视为0
+ */
+double platEventTime()
+{
+    double age = 0;
+
+    if (platform != NULL && platform->eventAge != NULL)
+        age = platform->eventAge();
+    return platNow() - (age > 0 ? age : 0);
+}
+
+/*
+ * 函数名：platMakeDir
+ * -------------
+ * 创建目录，已存在则什么都不做
+ */
+int platMakeDir(const char* path)
+{
+#ifdef _WIN32
+    return mkdir(path);
+#else
+    return mkdir(path, 0755);
+#endif
+}
+
+/*
+ * 函数名：platReplaceFile
+ * -------------
+ * 以新文件原子地替换旧文件
+ * Win32 下 rename 不能覆盖已存在的文件，改用 MoveFileEx
+ */
+bool platReplaceFile(const char* from, const char* to)
+{
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(from, to) == 0;
+#endif
+}
+
+/*
+ * 函数名：platSyncFile
+ * -------------
+ * 先清空 C 库的缓冲区，再要求系统写到磁盘
+ * Win32 下用 _commit（即 FlushFileBuffers），其他平台用 fsync
+ */
+bool platSyncFile(FILE* fp)
+{
+    if (fflush(fp) != 0)
+        return false;
+#ifdef _WIN32
+    return _commit(_fileno(fp)) == 0;
+#else
+    return fsync(fileno(fp)) == 0;
+#endif
+}
+
+/* （内部函数）
+ * 函数名：threadEntry
+ * -------------
+ * 各平台的线程入口，释放启动参数后调用 tetThreadFunc
+ */
+#ifdef _WIN32
+DWORD WINAPI threadEntry(LPVOID p)
+#else
+void* threadEntry(void* p)
+#endif
+{
+    tetThreadStart start = *(tetThreadStart*)p;
+    free(p);
+    start.func(start.arg);
+    return 0;
+}
+
+/*
+ * 函数名：platStartThread
+ * -------------
+ * 创建线程执行 func(arg)
+ */
+bool platStartThread(tetThread* t, tetThreadFunc func, void* arg)
+{
+    tetThreadStart* start = malloc(sizeof(tetThreadStart));
+    if (start == NULL)
+        return false;
+    start->func = func;
+    start->arg  = arg;
+
+#ifdef _WIN32
+    *t = CreateThread(NULL, 0, threadEntry, start, 0, NULL);
+    if (*t == NULL)
+#else
+    if (pthread_create(t, NULL, threadEntry, start) != 0)
+#endif
+    {
+        free(start);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * 函数名：platJoinThread
+ * -------------
+ * 等待线程结束并释放其资源
+ */
+void platJoinThread(tetThread t)
+{
+#ifdef _WIN32
+    WaitForSingleObject(t, INFINITE);
+    CloseHandle(t);
+#else
+    pthread_join(t, NULL);
+#endif
+}
+
+/*
+ * 函数名：platCpuCount
+ * -------------
+ * 取得逻辑处理器个数
+ */
+int platCpuCount()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+/*
+ * 函数名：platYield
+ * -------------
+ * 让出当前线程的时间片
+ */
+void platYield()
+{
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+/*
+ * 函数名：platInitSemaphore
+ * -------------
+ * 以初值 count 创建信号量
+ */
+bool platInitSemaphore(tetSemaphore* s, int count)
+{
+#ifdef _WIN32
+    *s = CreateSemaphore(NULL, count, 0x7FFFFFFF, NULL);
+    return *s != NULL;
+#else
+    return sem_init(s, 0, count) == 0;
+#endif
+}
+
+/*
+ * 函数名：platPostSemaphore
+ * -------------
+ * 信号量计数加1，唤醒一个等待的线程
+ */
+void platPostSemaphore(tetSemaphore* s)
+{
+#ifdef _WIN32
+    ReleaseSemaphore(*s, 1, NULL);
+#else
+    sem_post(s);
+#endif
+}
+
+/*
+ * 函数名：platWaitSemaphore
+ * -------------
+ * 等待信号量计数大于0并减1
+ */
+void platWaitSemaphore(tetSemaphore* s)
+{
+#ifdef _WIN32
+    WaitForSingleObject(*s, INFINITE);
+#else
+    while (sem_wait(s) != 0 && errno == EINTR)
+        ;
+#endif
+}
+
+/*
+ * 函数名：platFreeSemaphore
+ * -------------
+ * 释放信号量
+ */
+void platFreeSemaphore(tetSemaphore* s)
+{
+#ifdef _WIN32
+    CloseHandle(*s);
+#else
+    sem_destroy(s);
+#endif
+}
@@ -0,0 +1,253 @@
+/*
+ * 项目：Tetris
+ * 文件名：platform.h
+ * 概览：平台接口模块
+ * -------------
+ * 主要内容：
+ *      游戏核心（tetris.c、flow.c、fileIO.c）与具体平台之间的一层小接口
+ *      一、界面钩子：计时器与界面刷新。图形界面程序在启动时注册 Win32 实现，
+ *          无界面的模拟程序不注册，此时这些操作什么也不做
+ *      二、与操作系统相关的少量功能：计时、建目录、路径分隔符
+ *      三、线程与信号量：Win32 下用 CreateThread，其他平台用 pthreads
+ *
+ * 这样核心部分不再直接依赖 libgraphics 与 <windows.h>，可以在任何平台上编译链接
+ *
+ * 外部接口：
+ *      界面钩子：
+ *          setPlatform
+ *          platRegisterTimer
+ *          platStartTimer
+ *          platCancelTimer
+ *          platDisplay
+ *      系统功能：
+ *          platNow
+ *          platEventTime
+ *          platMakeDir
+ *          platReplaceFile
+ *          platSyncFile
+ *      线程：
+ *          platStartThread
+ *          platJoinThread
+ *          platCpuCount
+ *          platYield
+ *      信号量：
+ *          platInitSemaphore
+ *          platPostSemaphore
+ *          platWaitSemaphore
+ *          platFreeSemaphore
+ */
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <semaphore.h>
+#endif
+
+// 路径分隔符，用于拼接存档路径
+#ifdef _WIN32
+#define PathSep "\\"
+#else
+#define PathSep "/"
+#endif
+
+// 线程及信号量句柄，Win32 下均为 HANDLE
+#ifdef _WIN32
+typedef void* tetThread;
+typedef void* tetSemaphore;
+#else
+typedef pthread_t tetThread;
+typedef sem_t     tetSemaphore;
+#endif
+
+// 线程函数类型
+typedef void (*tetThreadFunc)(void* arg);
+
+// 计时器回调函数类型，与 libgraphics 中的 TimerEventCallback 相同
+typedef void (*tetTimerCallback)(int timerID);
+
+/* 界面钩子定义
+ *      registerTimer - 注册计时器回调函数
+ *      startTimer    - 以给定的时间间隔（毫秒）启动计时器
+ *      cancelTimer   - 停止计时器
+ *      display       - 刷新界面
+ *      eventAge      - 正在处理的输入消息从产生到现在经过的时间（秒），
+ *                      界面线程忙于绘制时，消息要等绘制完才被处理
+ * 任何一项为 NULL 时，对应操作什么也不做（eventAge 视为0）
+ */
+typedef struct {
+  void   (*registerTimer)(tetTimerCallback callback);
+  void   (*startTimer)(int timerID, int interval);
+  void   (*cancelTimer)(int timerID);
+  void   (*display)();
+  double (*eventAge)();
+} tetPlatform;
+
+
+/*
+ * 函数名称：setPlatform
+ * 函数原型：void setPlatform(const tetPlatform* p)
+ * 功能描述：注册界面钩子；传入 NULL 则恢复为无界面（所有钩子为空操作）
+ * 副作用？：改变之后所有界面钩子调用的行为
+ *
+ * 参数描述：界面钩子 p :: const tetPlatform*（须在使用期间保持有效）
+ * 返回类型：无
+ * --------------
+ * 使用方法：setPlatform(&yourPlatform);
+ */
+void setPlatform(const tetPlatform* p);
+
+
+/*
+ * 函数名称：platRegisterTimer / platStartTimer / platCancelTimer / platDisplay
+ * 函数原型：void platRegisterTimer(tetTimerCallback callback)
+ *          void platStartTimer(int timerID, int interval)
+ *          void platCancelTimer(int timerID)
+ *          void platDisplay()
+ * 功能描述：通过已注册的界面钩子完成对应操作，未注册时什么也不做
+ * 副作用？：取决于所注册的钩子（图形界面下为计时器控制及界面绘制）
+ *
+ * 参数描述：同 tetPlatform 中的对应项
+ * 返回类型：无
+ * --------------
+ * 使用方法：platStartTimer(Timer_Frame, FrameInterval);
+ */
+void platRegisterTimer(tetTimerCallback callback);
+void platStartTimer(int timerID, int interval);
+void platCancelTimer(int timerID);
+void platDisplay();
+
+
+/*
+ * 函数名称：platNow
+ * 函数原型：double platNow()
+ * 功能描述：取得单调递增的高精度时间，用于计时与测速
+ * 副作用？：无
+ *
+ * 参数描述：无
+ * 返回类型：double，以秒为单位的时间（起点不定，只有差值有意义）
+ * --------------
+ * 使用方法：double begin = platNow(); ... double elapsed = platNow() - begin;
+ */
+double platNow();
+
+
+/*
+ * 函数名称：platEventTime
+ * 函数原型：double platEventTime()
+ * 功能描述：正在处理的输入消息产生的时刻，与 platNow 同一时间基准
+ *         | 由界面钩子 eventAge 推算，精度取决于系统消息时间（Win32 下约10~16毫秒）；
+ *         | 未注册该钩子时即 platNow()
+ * 副作用？：无
+ *
+ * 参数描述：无
+ * 返回类型：double，以秒为单位的时间
+ * --------------
+ * 使用方法：在按键回调中 in.time = platEventTime();
+ */
+double platEventTime();
+
+
+/*
+ * 函数名称：platMakeDir
+ * 函数原型：int platMakeDir(const char* path)
+ * 功能描述：创建目录，目录已存在时什么也不做
+ * 副作用？：引起磁盘写入
+ *
+ * 参数描述：目录路径 path :: const char*
+ * 返回类型：int，0 代表创建成功，其他值代表失败或已存在
+ * --------------
+ * 使用方法：platMakeDir("saves");
+ */
+int platMakeDir(const char* path);
+
+
+/*
+ * 函数名称：platReplaceFile
+ * 函数原型：bool platReplaceFile(const char* from, const char* to)
+ * 功能描述：将文件 from 改名为 to，to 已存在时将其原子地替换：
+ *          其他程序看到的 to 要么是旧文件，要么是完整的新文件
+ * 副作用？：引起磁盘写入
+ *
+ * 参数描述：已写好的临时文件 from :: const char*
+ *         目标文件 to :: const char*
+ * 返回类型：bool，false 代表失败（此时 from 与 to 均保持原样）
+ * --------------
+ * 使用方法：写完 "x.tmp" 后 platReplaceFile("x.tmp", "x");
+ */
+bool platReplaceFile(const char* from, const char* to);
+
+
+/*
+ * 函数名称：platSyncFile
+ * 函数原型：bool platSyncFile(FILE* fp)
+ * 功能描述：将已写入文件 fp 的内容（含 C 库的缓冲区）真正写到磁盘上，
+ *          之后即使断电或系统崩溃，文件内容也不会丢失
+ * 副作用？：引起磁盘写入，可能阻塞较长时间
+ *
+ * 参数描述：以写入方式打开的文件 fp :: FILE*
+ * 返回类型：bool，false 代表写入失败
+ * --------------
+ * 使用方法：if (platSyncFile(fp) && fclose(fp) == 0) platReplaceFile("x.tmp", "x");
+ */
+bool platSyncFile(FILE* fp);
+
+
+/*
+ * 函数名称：platStartThread / platJoinThread
+ * 函数原型：bool platStartThread(tetThread* t, tetThreadFunc func, void* arg)
+ *          void platJoinThread(tetThread t)
+ * 功能描述：创建线程执行 func(arg) / 等待线程结束并释放其资源
+ * 副作用？：创建/回收线程
+ *
+ * 参数描述：线程句柄 t :: tetThread* / tetThread
+ *         线程函数 func :: tetThreadFunc，及其参数 arg :: void*
+ * 返回类型：platStartThread 返回 bool，false 代表创建失败
+ * --------------
+ * 使用方法：if (platStartThread(&t, worker, arg)) { ... platJoinThread(t); }
+ */
+bool platStartThread(tetThread* t, tetThreadFunc func, void* arg);
+void platJoinThread(tetThread t);
+
+
+/*
+ * 函数名称：platCpuCount / platYield
+ * 函数原型：int platCpuCount()
+ *          void platYield()
+ * 功能描述：取得逻辑处理器个数 / 让出当前线程的时间片
+ * 副作用？：无
+ *
+ * 参数描述：无
+ * 返回类型：platCpuCount 返回 int，至少为1
+ * --------------
+ * 使用方法：int n = platCpuCount();
+ */
+int  platCpuCount();
+void platYield();
+
+
+/*
+ * 函数名称：platInitSemaphore / platPostSemaphore / platWaitSemaphore / platFreeSemaphore
+ * 函数原型：bool platInitSemaphore(tetSemaphore* s, int count)
+ *          void platPostSemaphore(tetSemaphore* s)
+ *          void platWaitSemaphore(tetSemaphore* s)
+ *          void platFreeSemaphore(tetSemaphore* s)
+ * 功能描述：以初值 count 创建信号量 / 计数加1 / 等待计数大于0并减1 / 释放信号量
+ * 副作用？：可能阻塞或唤醒线程
+ *
+ * 参数描述：信号量 s :: tetSemaphore*
+ *         初值 count :: int
+ * 返回类型：platInitSemaphore 返回 bool，false 代表创建失败
+ * --------------
+ * 使用方法：platInitSemaphore(&s, 0); ... platPostSemaphore(&s); ... platWaitSemaphore(&s);
+ */
+bool platInitSemaphore(tetSemaphore* s, int count);
+void platPostSemaphore(tetSemaphore* s);
+void platWaitSemaphore(tetSemaphore* s);
+void platFreeSemaphore(tetSemaphore* s);
+
+#endif
@@ -0,0 +1,318 @@
+/*
+ * 项目：Tetris
+ * 文件名：pool.c
+ * 概览：线程池模块
+ * -------------
+ * 负责功能：
+ *      后台线程的创建、唤醒与回收
+ *      各线程任务队列（Chase-Lev 双端队列）的取出与窃取
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "platform.h"  // 需要线程与信号量
+#include "pool.h"      // 本模块
+
+// 每个线程的队列一批最多容纳的任务数，超出时分成多批执行
+#define DequeSize 1024
+
+// 缓存行大小，用于隔开不同线程频繁写入的数据
+#define CacheLine 64
+
+// 窃取的结果：队列为空 / 与其他线程争抢失败
+#define StealEmpty (-1)
+#define StealAbort (-2)
+
+
+/* 任务队列
+ *      top    - 窃取端，其他线程从这里取任务
+ *      bottom - 所属线程的一端
+ *      task   - 本批任务的下标；一批任务开始前装满，执行期间只取不放
+ */
+typedef struct {
+  long top;
+  char padTop[CacheLine - sizeof(long)];
+  long bottom;
+  char padBottom[CacheLine - sizeof(long)];
+  int  task[DequeSize];
+} tetDeque;
+
+
+/* 线程池
+ *      threads - 线程数，包括调用者（0号）在内
+ *      handle  - 后台线程（1 ~ threads-1 号）
+ *      arg     - 各后台线程的启动参数
+ *      deque   - 各线程的任务队列
+ *      wake    - 每批任务开始时唤醒后台线程
+ *      func, args, size - 本批任务
+ *      active  - 仍在处理本批任务的后台线程数
+ *      quit    - 通知后台线程结束
+ */
+struct tetPool {
+  int           threads;
+  tetThread*    handle;
+  struct tetWorker* arg;
+  tetDeque*     deque;
+  tetSemaphore  wake;
+  tetTaskFunc   func;
+  char*         args;
+  size_t        size;
+  int           active;
+  bool          quit;
+};
+
+// 后台线程的启动参数：所属线程池及线程编号
+typedef struct tetWorker {
+  tetPool* pool;
+  int      id;
+} tetWorker;
+
+
+// 内部函数声明
+int  popTask(tetDeque* d);
+int  stealTask(tetDeque* d);
+int  findTask(tetPool* p, int self);
+void workBatch(tetPool* p, int self);
+void workerMain(void* arg);
+
+
+/*
+ * 函数名：createPool
+ * -------------
+ * 创建各线程的任务队列及后台线程，后台线程创建后即等待第一批任务
+ */
+tetPool* createPool(int threads)
+{
+    int i;
+    tetPool* p = calloc(1, sizeof(tetPool));
+    if (p == NULL)
+        return NULL;
+
+    p->threads = threads > 0 ? threads : platCpuCount();
+    p->handle  = calloc(p->threads, sizeof(tetThread));
+    p->arg     = calloc(p->threads, sizeof(tetWorker));
+    p->deque   = calloc(p->threads, sizeof(tetDeque));
+    if (p->handle == NULL || p->arg == NULL || p->deque == NULL
+        || !platInitSemaphore(&p->wake, 0))
+    {
+        free(p->handle);
+        free(p->arg);
+        free(p->deque);
+        free(p);
+        return NULL;
+    }
+
+    for (i = 1; i < p->threads; ++i)
+    {
+        p->arg[i].pool = p;
+        p->arg[i].id   = i;
+        if (!platStartThread(&p->handle[i], workerMain, &p->arg[i]))
+        {
+            // 创建失败，则只使用已创建的线程
+            p->threads = i;
+            break;
+        }
+    }
+    return p;
+}
+
+/*
+ * 函数名：destroyPool
+ * -------------
+ * 设置结束标志后唤醒所有后台线程，等待其结束
+ */
+void destroyPool(tetPool* p)
+{
+    int i;
+    if (p == NULL)
+        return;
+
+    __atomic_store_n(&p->quit, true, __ATOMIC_RELEASE);
+    for (i = 1; i < p->threads; ++i)
+        platPostSemaphore(&p->wake);
+    for (i = 1; i < p->threads; ++i)
+        platJoinThread(p->handle[i]);
+
+    platFreeSemaphore(&p->wake);
+    free(p->handle);
+    free(p->arg);
+    free(p->deque);
+    free(p);
+}
+
+/*
+ * 函数名：poolThreads
+ * -------------
+ * 取得线程池的线程数
+ */
+int poolThreads(const tetPool* p)
+{
+    return p != NULL ? p->threads : 1;
+}
+
+/*
+ * 函数名：poolRun
+ * -------------
+ * 将任务按下标分段装入各线程的队列，唤醒后台线程一起执行，
+ * 调用者做完自己能取到的任务后，等待所有后台线程离开本批任务
+ */
+void poolRun(tetPool* p, tetTaskFunc func, void* args, size_t size, int count)
+{
+    int i, t, batch;
+
+    // 单线程，或只有一个任务，直接依次执行
+    if (p == NULL || p->threads == 1 || count <= 1)
+    {
+        for (i = 0; i < count; ++i)
+            func((char*)args + i * size);
+        return;
+    }
+
+    while (count > 0)
+    {
+        batch = count < p->threads * DequeSize ? count : p->threads * DequeSize;
+
+        // 第 t 个线程分到下标连续的一段任务
+        for (t = 0; t < p->threads; ++t)
+        {
+            tetDeque* d = &p->deque[t];
+            int from = (long)batch * t / p->threads;
+            int to   = (long)batch * (t + 1) / p->threads;
+            d->top    = 0;
+            d->bottom = to - from;
+            for (i = from; i < to; ++i)
+                d->task[to - 1 - i] = i;
+        }
+
+        p->func   = func;
+        p->args   = args;
+        p->size   = size;
+        p->active = p->threads - 1;
+
+        // 信号量保证以上写入对被唤醒的线程可见
+        for (t = 1; t < p->threads; ++t)
+            platPostSemaphore(&p->wake);
+
+        workBatch(p, 0);
+        while (__atomic_load_n(&p->active, __ATOMIC_ACQUIRE) > 0)
+            platYield();
+
+        args   = (char*)args + batch * size;
+        count -= batch;
+    }
+}
+
+/* （内部函数）
+ * 函数名：popTask
+ * -------------
+ * 从所属线程的一端取出一个任务，队列为空时返回 StealEmpty
+ * 只剩最后一个任务时，与窃取者以 top 上的比较交换决定归属
+ */
+int popTask(tetDeque* d)
+{
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&d->bottom, b, __ATOMIC_SEQ_CST);
+    long t = __atomic_load_n(&d->top, __ATOMIC_SEQ_CST);
+
+    if (t > b)
+    {
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+        return StealEmpty;
+    }
+
+    int task = d->task[b];
+    if (t == b)
+    {
+        if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, false,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            task = StealEmpty;
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return task;
+}
+
+/* （内部函数）
+ * 函数名：stealTask
+ * -------------
+ * 从其他线程队列的窃取端取出一个任务
+ * 返回 StealEmpty 代表队列已空，StealAbort 代表被其他线程抢先，可以重试
+ */
+int stealTask(tetDeque* d)
+{
+    long t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+
+    if (t >= b)
+        return StealEmpty;
+
+    int task = d->task[t];
+    if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return StealAbort;
+    return task;
+}
+
+/* （内部函数）
+ * 函数名：findTask
+ * -------------
+ * 先取自己队列中的任务，没有则依次窃取其他线程的任务
+ * 本批任务执行期间不会产生新任务，所有队列都已空时即可返回 StealEmpty
+ */
+int findTask(tetPool* p, int self)
+{
+    int task = popTask(&p->deque[self]);
+    int k;
+    bool retry;
+
+    while (task < 0)
+    {
+        retry = false;
+        for (k = 1; k < p->threads; ++k)
+        {
+            task = stealTask(&p->deque[(self + k) % p->threads]);
+            if (task >= 0)
+                return task;
+            if (task == StealAbort)
+                retry = true;
+        }
+        if (!retry)
+            return StealEmpty;
+    }
+    return task;
+}
+
+/* （内部函数）
+ * 函数名：workBatch
+ * -------------
+ * 执行本批任务，直到所有队列都已取空
+ */
+void workBatch(tetPool* p, int self)
+{
+    int task;
+    while ((task = findTask(p, self)) >= 0)
+        p->func(p->args + task * p->size);
+}
+
+/* （内部函数）
+ * 函数名：workerMain
+ * -------------
+ * 后台线程：等待唤醒，执行一批任务，如此往复直到线程池销毁
+ */
+void workerMain(void* arg)
+{
+    tetWorker* w = arg;
+    tetPool*   p = w->pool;
+
+    for (;;)
+    {
+        platWaitSemaphore(&p->wake);
+        if (__atomic_load_n(&p->quit, __ATOMIC_ACQUIRE))
+            break;
+
+        workBatch(p, w->id);
+        __atomic_sub_fetch(&p->active, 1, __ATOMIC_RELEASE);
+    }
+}
@@ -0,0 +1,93 @@
+/*
+ * 项目：Tetris
+ * 文件名：pool.h
+ * 概览：线程池模块
+ * -------------
+ * 主要内容：
+ *      固定线程数、以工作窃取（work stealing）调度的线程池
+ *
+ * 每批任务开始时，任务按下标平均分配到各线程的双端队列中；
+ * 各线程从自己队列的一端取任务，做完后从其他线程队列的另一端窃取，
+ * 这样任务耗时不均时各线程也能同时做完。调用者本身也参与执行任务
+ *
+ * 任务之间不得共享可写的数据：每个任务只写自己的参数，
+ * 汇总由调用者在整批任务完成后按下标顺序进行，结果因此与线程数及调度无关
+ *
+ * 外部接口：
+ *      createPool
+ *      destroyPool
+ *      poolThreads
+ *      poolRun
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+// 任务函数类型，arg 指向该任务的参数
+typedef void (*tetTaskFunc)(void* arg);
+
+// 线程池，定义见 pool.c
+typedef struct tetPool tetPool;
+
+
+/*
+ * 函数名称：createPool
+ * 函数原型：tetPool* createPool(int threads)
+ * 功能描述：创建线程池
+ * 副作用？：创建 threads-1 个后台线程（调用者自身算作一个）
+ *
+ * 参数描述：线程数 threads :: int，不大于0时取逻辑处理器个数
+ * 返回类型：tetPool*，失败时为 NULL
+ * --------------
+ * 使用方法：tetPool* pool = createPool(0);
+ */
+tetPool* createPool(int threads);
+
+
+/*
+ * 函数名称：destroyPool
+ * 函数原型：void destroyPool(tetPool* p)
+ * 功能描述：结束所有后台线程并释放线程池
+ * 副作用？：回收线程
+ *
+ * 参数描述：线程池 p :: tetPool*（可为 NULL）
+ * 返回类型：无
+ * --------------
+ * 使用方法：destroyPool(pool);
+ */
+void destroyPool(tetPool* p);
+
+
+/*
+ * 函数名称：poolThreads
+ * 函数原型：int poolThreads(const tetPool* p)
+ * 功能描述：取得线程池的线程数（包括调用者）
+ * 副作用？：无
+ *
+ * 参数描述：线程池 p :: const tetPool*，NULL 视为单线程
+ * 返回类型：int，线程数
+ * --------------
+ * 使用方法：int n = poolThreads(pool);
+ */
+int poolThreads(const tetPool* p);
+
+
+/*
+ * 函数名称：poolRun
+ * 函数原型：void poolRun(tetPool* p, tetTaskFunc func, void* args, size_t size, int count)
+ * 功能描述：执行一批共 count 个任务，第 i 个任务为 func(args + i*size)，全部完成后返回
+ * 副作用？：取决于任务函数
+ *
+ * 参数描述：线程池 p :: tetPool*，为 NULL 时在调用者线程中依次执行
+ *         任务函数 func :: tetTaskFunc
+ *         参数数组 args :: void*，每项大小为 size :: size_t
+ *         任务数 count :: int
+ * 返回类型：无
+ * --------------
+ * 使用方法：poolRun(pool, expandTask, tasks, sizeof(tasks[0]), n);
+ */
+void poolRun(tetPool* p, tetTaskFunc func, void* args, size_t size, int count);
+
+#endif
@@ -0,0 +1,217 @@
+/*
+ * 项目：Tetris
+ * 文件名：rank.c
+ * 概览：名次索引模块
+ * -------------
+ * 负责功能：
+ *      treap 的插入及旋转（旋转时维护子树大小）
+ *      按子树大小进行的名次查询
+ */
+
+#include <stdlib.h>
+
+#include "rank.h"  // 本模块
+
+// 结点 i 的子树大小，空结点为0
+#define SizeOf(t, i) ((t)->node[i].size)
+
+
+// 内部函数声明
+int insertNode(tetRankTree* t, int n, int fresh);
+int rotateLeft(tetRankTree* t, int n);
+int rotateRight(tetRankTree* t, int n);
+void updateSize(tetRankTree* t, int n);
+uint32_t priority(uint32_t index);
+
+
+/*
+ * 函数名：initRankTree
+ * -------------
+ * 分配初始容量，并放入空结点
+ */
+bool initRankTree(tetRankTree* t)
+{
+    t->node = calloc(RankInitNodes, sizeof(tetRankNode));
+    t->cap  = t->node != NULL ? RankInitNodes : 0;
+    t->used = t->node != NULL ? 1 : 0;
+    t->root = 0;
+    return t->node != NULL;
+}
+
+/*
+ * 函数名：freeRankTree
+ * -------------
+ * 释放结点数组
+ */
+void freeRankTree(tetRankTree* t)
+{
+    free(t->node);
+    t->node = NULL;
+    t->cap  = 0;
+    t->used = 0;
+    t->root = 0;
+}
+
+/*
+ * 函数名：rankInsert
+ * -------------
+ * 分数已有结点时，沿查找路径把各结点的子树大小加1，并增加其重复次数；
+ * 否则新建结点，按 treap 的方式插入
+ */
+bool rankInsert(tetRankTree* t, int score)
+{
+    int n = t->root;
+
+    if (t->node == NULL)
+        return false;
+
+    while (n != 0 && t->node[n].score != score)
+        n = score > t->node[n].score ? t->node[n].left : t->node[n].right;
+
+    if (n != 0)
+    {
+        for (n = t->root; t->node[n].score != score;
+             n = score > t->node[n].score ? t->node[n].left : t->node[n].right)
+            t->node[n].size++;
+        t->node[n].size++;
+        t->node[n].count++;
+        return true;
+    }
+
+    if (t->used == t->cap)
+    {
+        tetRankNode* grown = realloc(t->node, 2 * t->cap * sizeof(tetRankNode));
+        if (grown == NULL)
+            return false;
+        t->node = grown;
+        t->cap *= 2;
+    }
+
+    int fresh = t->used++;
+    tetRankNode* f = &t->node[fresh];
+    f->score = score;
+    f->count = 1;
+    f->size  = 1;
+    f->prio  = priority((uint32_t)fresh);
+    f->left  = 0;
+    f->right = 0;
+
+    t->root = insertNode(t, t->root, fresh);
+    return true;
+}
+
+/*
+ * 函数名：rankAbove
+ * -------------
+ * 从根向下查找 score：向右（分数更低）走时，左子树及该结点的分数都比它高
+ */
+int rankAbove(const tetRankTree* t, int score)
+{
+    int n = t->node != NULL ? t->root : 0;
+    int above = 0;
+
+    while (n != 0)
+    {
+        if (t->node[n].score > score)
+        {
+            above += SizeOf(t, t->node[n].left) + t->node[n].count;
+            n = t->node[n].right;
+        }
+        else
+        {
+            n = t->node[n].left;
+        }
+    }
+    return above;
+}
+
+/*
+ * 函数名：rankSize
+ * -------------
+ * 即根结点的子树大小
+ */
+int rankSize(const tetRankTree* t)
+{
+    return t->node != NULL ? SizeOf(t, t->root) : 0;
+}
+
+/* （内部函数）
+ * 函数名：insertNode
+ * -------------
+ * 把新结点 fresh 插入以 n 为根的子树，返回新的子树根；
+ * 插入后子结点的优先级高于 n 时，旋转使其成为子树根
+ */
+int insertNode(tetRankTree* t, int n, int fresh)
+{
+    if (n == 0)
+        return fresh;
+
+    t->node[n].size++;
+    if (t->node[fresh].score > t->node[n].score)
+    {
+        t->node[n].left = insertNode(t, t->node[n].left, fresh);
+        if (t->node[t->node[n].left].prio > t->node[n].prio)
+            n = rotateRight(t, n);
+    }
+    else
+    {
+        t->node[n].right = insertNode(t, t->node[n].right, fresh);
+        if (t->node[t->node[n].right].prio > t->node[n].prio)
+            n = rotateLeft(t, n);
+    }
+    return n;
+}
+
+/* （内部函数）
+ * 函数名：rotateLeft / rotateRight
+ * -------------
+ * 以 n 的右 / 左子结点为新的子树根，返回新的子树根；子树大小随之重新计算
+ */
+int rotateLeft(tetRankTree* t, int n)
+{
+    int r = t->node[n].right;
+
+    t->node[n].right = t->node[r].left;
+    t->node[r].left  = n;
+    updateSize(t, n);
+    updateSize(t, r);
+    return r;
+}
+
+int rotateRight(tetRankTree* t, int n)
+{
+    int l = t->node[n].left;
+
+    t->node[n].left  = t->node[l].right;
+    t->node[l].right = n;
+    updateSize(t, n);
+    updateSize(t, l);
+    return l;
+}
+
+/* （内部函数）
+ * 函数名：updateSize
+ * -------------
+ * 由子结点重新计算结点 n 的子树大小
+ */
+void updateSize(tetRankTree* t, int n)
+{
+    t->node[n].size = SizeOf(t, t->node[n].left) + SizeOf(t, t->node[n].right) + t->node[n].count;
+}
+
+/* （内部函数）
+ * 函数名：priority
+ * -------------
+ * 由结点下标散列出的优先级：与分数无关，即使分数按顺序插入，树的期望高度也是 O(log n)
+ */
+uint32_t priority(uint32_t index)
+{
+    uint32_t x = index * 0x9E3779B9u;
+
+    x ^= x >> 16;
+    x *= 0x85EBCA6Bu;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35u;
+    x ^= x >> 16;
+    return x;
+}
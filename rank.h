@@ -0,0 +1,127 @@
+/*
+ * 项目：Tetris
+ * 文件名：rank.h
+ * 概览：名次索引模块
+ * -------------
+ * 主要内容：
+ *      分数的多重集合，按分数从高到低排列的顺序统计树
+ *      O(log n) 的插入、名次查询（比某分数高的有几个）
+ *
+ * 树为 treap（按分数排序的二叉查找树，同时按随机优先级构成堆），期望高度 O(log n)；
+ * 相同的分数只占一个结点，结点记录其重复次数，及子树中分数的总个数
+ * 结点存放在一个数组中，以下标相连（0 为空结点），只增不删
+ *
+ * 只存分数、不存玩家名，几十万条记录只需几兆字节；
+ * 按名次取分数、玩家名等完整记录，由排行榜文件按名次直接读取（见 fileIO.h）
+ *
+ * 外部接口：
+ *      initRankTree
+ *      freeRankTree
+ *      rankInsert
+ *      rankAbove
+ *      rankSize
+ */
+
+#ifndef RANK_H
+#define RANK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// 结点数组的初始容量，不足时加倍
+#define RankInitNodes 64
+
+
+/* 树的一个结点
+ *      score - 分数
+ *      count - 该分数的个数
+ *      size  - 子树中分数的总个数（含重复）
+ *      prio  - 随机优先级，父结点不小于子结点
+ *      left  - 分数更高的子树
+ *      right - 分数更低的子树
+ */
+typedef struct {
+  int32_t  score;
+  int32_t  count;
+  int32_t  size;
+  uint32_t prio;
+  int32_t  left;
+  int32_t  right;
+} tetRankNode;
+
+
+/* 顺序统计树
+ *      node - 结点数组，node[0] 为空结点（各项均为0）
+ *      used - 已用的结点数（含空结点）
+ *      cap  - 容量
+ *      root - 根结点，0 代表空树
+ */
+typedef struct {
+  tetRankNode* node;
+  int          used;
+  int          cap;
+  int          root;
+} tetRankTree;
+
+
+/*
+ * 函数名称：initRankTree / freeRankTree
+ * 函数原型：bool initRankTree(tetRankTree* t)
+ *          void freeRankTree(tetRankTree* t)
+ * 功能描述：初始化为空树 / 释放树的空间，此后须重新初始化才能使用
+ * 副作用？：改变传入的树，分配 / 释放内存
+ *
+ * 参数描述：树 t :: tetRankTree*
+ * 返回类型：bool，false 代表内存不足
+ * --------------
+ * 使用方法：if (initRankTree(&yourTree)) ...
+ */
+bool initRankTree(tetRankTree* t);
+void freeRankTree(tetRankTree* t);
+
+
+/*
+ * 函数名称：rankInsert
+ * 函数原型：bool rankInsert(tetRankTree* t, int score)
+ * 功能描述：加入一个分数，期望 O(log n)
+ * 副作用？：改变传入的树，可能分配内存
+ *
+ * 参数描述：树 t :: tetRankTree*
+ *         分数 score :: int
+ * 返回类型：bool，false 代表内存不足，此时树不变
+ * --------------
+ * 使用方法：rankInsert(&yourTree, score);
+ */
+bool rankInsert(tetRankTree* t, int score);
+
+
+/*
+ * 函数名称：rankAbove
+ * 函数原型：int rankAbove(const tetRankTree* t, int score)
+ * 功能描述：比 score 高的分数的个数，期望 O(log n)
+ *         | 加1即 score 的名次（与排行榜相同，同分时后来者居上）
+ * 副作用？：无
+ *
+ * 参数描述：树 t :: const tetRankTree*
+ *         分数 score :: int
+ * 返回类型：int，个数
+ * --------------
+ * 使用方法：int rank = rankAbove(&yourTree, score) + 1;
+ */
+int rankAbove(const tetRankTree* t, int score);
+
+
+/*
+ * 函数名称：rankSize
+ * 函数原型：int rankSize(const tetRankTree* t)
+ * 功能描述：分数的总个数（含重复），O(1)
+ * 副作用？：无
+ *
+ * 参数描述：树 t :: const tetRankTree*
+ * 返回类型：int，个数
+ * --------------
+ * 使用方法：int total = rankSize(&yourTree);
+ */
+int rankSize(const tetRankTree* t);
+
+#endif
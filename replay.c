@@ -0,0 +1,741 @@
+/*
+ * 项目：Tetris
+ * 文件名：replay.c
+ * 概览：回放记录模块
+ * -------------
+ * 负责功能：
+ *      回放文件头部、事件、关键帧、结尾及索引的编码
+ *      带缓冲的只追加写入
+ *      回放的解码、校验、定位及重新模拟
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tetris.h"  // 需要恢复方块及方块堆
+#include "replay.h"  // 本模块
+
+// 有符号整数与 zigzag 编码（0, -1, 1, -2, ... 依次编为 0, 1, 2, 3, ...）的互相转换
+#define ZigZag(v)   ((uint64_t)(((uint32_t)(v) << 1) ^ (uint32_t)((int32_t)(v) >> 31)))
+#define UnZigZag(u) ((int32_t)((uint32_t)((u) >> 1) ^ -(uint32_t)((u) & 1)))
+
+// 方块的1字节编码：类型3位、方向2位、颜色3位
+#define PackBlock(b) ((unsigned char)((b).type | (b).orient << 3 | (b).color << 5))
+
+/* 快照中方块堆部分的位流，低位在前
+ *      out      - 写入时的下一个字节
+ *      in, end  - 读出时的下一个字节及数据末尾
+ *      acc      - 尚未凑满一字节（写入时）或尚未取用（读出时）的位
+ *      bits     - acc 中的位数
+ */
+typedef struct {
+  unsigned char*       out;
+  const unsigned char* in;
+  const unsigned char* end;
+  uint32_t             acc;
+  int                  bits;
+} tetBitStream;
+
+
+// 内部函数声明
+int  putVarint(unsigned char* p, uint64_t v);
+bool getVarint(const unsigned char** p, const unsigned char* end, uint64_t* v);
+void putBits(tetBitStream* s, unsigned v, int width);
+bool getBits(tetBitStream* s, unsigned* v, int width);
+int  nextEvent(const unsigned char** p, const unsigned char* end, uint32_t* tick, int* arg);
+void writeKeyframe(tetReplayWriter* w, const tetGame* g);
+bool unpackBlock(unsigned char c, tetBlock* b);
+bool checkKeys(const tetReplay* r);
+bool simulate(const tetReplay* r, tetGame* g, const unsigned char* p, uint32_t at, uint32_t tick, bool check);
+
+
+/*
+ * 函数名：openReplay
+ * -------------
+ * 新建文件，头部先放入缓冲区，与之后的事件一起写入
+ */
+bool openReplay(tetReplayWriter* w, const char* path, uint64_t seed, const tetGame* g, int keyEvery)
+{
+    w->fp = fopen(path, "wb");
+    if (w->fp == NULL)
+        return false;
+
+    strncpy(w->path, path, ReplayPathLen - 1);
+    w->path[ReplayPathLen - 1] = '\0';
+    w->lastTick = g->frame;
+    w->keyEvery = keyEvery > 0 ? keyEvery : 0;
+    w->nextKey  = g->frame + w->keyEvery;
+    w->keys     = NULL;
+    w->keyCount = 0;
+    w->keyCap   = 0;
+    w->written  = 0;
+
+    memcpy(w->buf, ReplayMagic, 4);
+    w->buf[4] = ReplayVersion;
+    w->buf[5] = (unsigned char)g->random.mode;
+    w->used   = 6;
+    w->used  += putVarint(w->buf + w->used, seed);
+    w->used  += putVarint(w->buf + w->used, (uint64_t)g->das);
+    w->used  += putVarint(w->buf + w->used, (uint64_t)g->arr);
+    w->used  += putVarint(w->buf + w->used, (uint64_t)w->keyEvery);
+    return true;
+}
+
+/*
+ * 函数名：recordInput
+ * -------------
+ * 事件编码后放入缓冲区，剩余空间不足一个事件时写入文件
+ */
+void recordInput(tetReplayWriter* w, uint32_t tick, tetAction a, bool release, int late)
+{
+    if (w->fp == NULL)
+        return;
+
+    w->used += putVarint(w->buf + w->used, ((uint64_t)(tick - w->lastTick) << ReplayCodeBits) | (a * 2 + release));
+    if ((a == ACT_LEFT || a == ACT_RIGHT) && !release)
+        w->used += putVarint(w->buf + w->used, (uint64_t)late);
+    w->lastTick = tick;
+
+    if (w->used > ReplayBufSize - ReplayEventMax)
+        flushReplay(w);
+}
+
+/*
+ * 函数名：recordTick
+ * -------------
+ * 满间隔时记录关键帧
+ */
+void recordTick(tetReplayWriter* w, const tetGame* g)
+{
+    if (w->fp != NULL && w->keyEvery > 0 && g->frame >= w->nextKey)
+        writeKeyframe(w, g);
+}
+
+/*
+ * 函数名：flushReplay
+ * -------------
+ * 缓冲区中的数据追加到文件末尾，写入失败由 closeReplay 报告
+ */
+void flushReplay(tetReplayWriter* w)
+{
+    if (w->fp == NULL || w->used == 0)
+        return;
+
+    fwrite(w->buf, 1, w->used, w->fp);
+    w->written += w->used;
+    w->used = 0;
+}
+
+/*
+ * 函数名：closeReplay
+ * -------------
+ * 写入结尾（结束的帧及分数、行数、等级）、关键帧索引及其偏移后关闭文件
+ */
+bool closeReplay(tetReplayWriter* w, const tetGame* g)
+{
+    tetReplayKey prev = { 0, 0 };
+    int i;
+
+    if (w->fp == NULL)
+        return false;
+
+    w->used += putVarint(w->buf + w->used, ((uint64_t)(g->frame - w->lastTick) << ReplayCodeBits) | ReplayEnd);
+    w->used += putVarint(w->buf + w->used, (uint64_t)g->score);
+    w->used += putVarint(w->buf + w->used, (uint64_t)g->lines);
+    w->used += putVarint(w->buf + w->used, (uint64_t)g->level);
+    flushReplay(w);
+
+    // 索引中的帧与位置都记为与上一项之差
+    uint32_t index = w->written;
+    w->used += putVarint(w->buf + w->used, (uint64_t)w->keyCount);
+    for (i = 0; i < w->keyCount; ++i)
+    {
+        w->used += putVarint(w->buf + w->used, w->keys[i].tick - prev.tick);
+        w->used += putVarint(w->buf + w->used, w->keys[i].pos - prev.pos);
+        prev = w->keys[i];
+        if (w->used > ReplayBufSize - ReplayEventMax)
+            flushReplay(w);
+    }
+    for (i = 0; i < 4; ++i)
+        w->buf[w->used++] = (unsigned char)(index >> (8 * i));
+    memcpy(w->buf + w->used, ReplayIndexMagic, 4);
+    w->used += 4;
+    flushReplay(w);
+
+    bool ok = !ferror(w->fp);
+    ok = fclose(w->fp) == 0 && ok;
+    w->fp = NULL;
+    free(w->keys);
+    w->keys = NULL;
+    return ok;
+}
+
+/*
+ * 函数名：discardReplay
+ * -------------
+ * 关闭并删除回放文件
+ */
+void discardReplay(tetReplayWriter* w)
+{
+    if (w->fp == NULL)
+        return;
+
+    fclose(w->fp);
+    w->fp = NULL;
+    free(w->keys);
+    w->keys = NULL;
+    remove(w->path);
+}
+
+/*
+ * 函数名：loadReplay
+ * -------------
+ * 整个文件读入内存后解析头部，再解码一遍全部事件直到结尾，
+ * 然后由文件末尾找到紧接在结尾之后的索引，核对它与事件中的关键帧一一对应，
+ * 之后 runReplay、seekReplay 不必再做任何检查
+ */
+bool loadReplay(tetReplay* r, const char* path)
+{
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL)
+        return false;
+
+    long size = -1;
+    if (fseek(fp, 0, SEEK_END) == 0)
+        size = ftell(fp);
+    rewind(fp);
+
+    r->data = size > 14 ? malloc(size) : NULL;
+    if (r->data == NULL || fread(r->data, 1, size, fp) != (size_t)size)
+    {
+        free(r->data);
+        fclose(fp);
+        return false;
+    }
+    fclose(fp);
+    r->size     = size;
+    r->keys     = NULL;
+    r->keyCount = 0;
+
+    // 末尾8字节之前为头部、事件、结尾及索引
+    const unsigned char* p   = r->data + 6;
+    const unsigned char* end = r->data + r->size - 8;
+    uint64_t seed, das, arr, keyEvery, score, lines, level, count, dt, dp;
+    uint32_t tick = 0, index = 0;
+    int code, arg, seen = 0, i;
+
+    bool ok = memcmp(r->data, ReplayMagic, 4) == 0 && r->data[4] == ReplayVersion
+              && r->data[5] <= RAND_BAG
+              && getVarint(&p, end, &seed) && getVarint(&p, end, &das) && getVarint(&p, end, &arr)
+              && getVarint(&p, end, &keyEvery)
+              && das <= 10000 && arr <= 10000 && keyEvery <= INT32_MAX;
+    if (ok)
+    {
+        r->seed     = seed;
+        r->mode     = (tetRandMode)r->data[5];
+        r->das      = (int)das;
+        r->arr      = (int)arr;
+        r->keyEvery = (int)keyEvery;
+        r->events   = p - r->data;
+
+        while ((code = nextEvent(&p, end, &tick, &arg)) >= 0 && code != ReplayEnd)
+            seen += code == ReplayKey;
+        ok = code == ReplayEnd
+             && getVarint(&p, end, &score) && getVarint(&p, end, &lines) && getVarint(&p, end, &level)
+             && score <= INT32_MAX && lines <= INT32_MAX && level <= INT32_MAX;
+    }
+
+    if (ok)
+    {
+        for (i = 0; i < 4; ++i)
+            index |= (uint32_t)end[i] << (8 * i);
+        ok = memcmp(end + 4, ReplayIndexMagic, 4) == 0 && index == (uint32_t)(p - r->data)
+             && getVarint(&p, end, &count) && count == (uint64_t)seen;
+    }
+    if (ok && seen > 0)
+    {
+        r->keys = malloc(seen * sizeof(tetReplayKey));
+        ok = r->keys != NULL;
+    }
+    for (i = 0; ok && i < seen; ++i)
+    {
+        ok = getVarint(&p, end, &dt) && getVarint(&p, end, &dp) && dt <= UINT32_MAX && dp <= UINT32_MAX;
+        if (ok)
+        {
+            r->keys[i].tick = (uint32_t)dt + (i > 0 ? r->keys[i - 1].tick : 0);
+            r->keys[i].pos  = (uint32_t)dp + (i > 0 ? r->keys[i - 1].pos : 0);
+        }
+    }
+    r->keyCount = seen;
+    ok = ok && p == end && checkKeys(r);
+
+    if (!ok)
+    {
+        free(r->keys);
+        free(r->data);
+        return false;
+    }
+
+    r->endTick = tick;
+    r->score   = (int)score;
+    r->lines   = (int)lines;
+    r->level   = (int)level;
+    return true;
+}
+
+/*
+ * 函数名：freeReplay
+ * -------------
+ * 释放文件内容及索引
+ */
+void freeReplay(tetReplay* r)
+{
+    free(r->data);
+    free(r->keys);
+    r->data = NULL;
+    r->keys = NULL;
+}
+
+/*
+ * 函数名：runReplay
+ * -------------
+ * 从第0帧开始模拟到结尾，途中核对每个关键帧
+ */
+bool runReplay(const tetReplay* r, tetGame* g)
+{
+    initGame(g, r->seed, r->mode);
+    g->das = r->das;
+    g->arr = r->arr;
+    return simulate(r, g, r->data + r->events, 0, UINT32_MAX, true);
+}
+
+/*
+ * 函数名：seekReplay
+ * -------------
+ * 二分查找帧不晚于 tick 的最后一个关键帧，由其快照恢复后从快照之后的事件继续模拟；
+ * 没有这样的关键帧（或其快照无法解码）时从第0帧开始
+ */
+void seekReplay(const tetReplay* r, tetGame* g, uint32_t tick)
+{
+    const unsigned char* p = r->data + r->events;
+    uint32_t at = 0;
+    uint64_t len;
+    int lo = 0, hi = r->keyCount, mid;
+
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (r->keys[mid].tick <= tick)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    // 关键帧已由 loadReplay 校验过；万一仍无法恢复，则退回从第0帧开始，结果相同
+    if (lo > 0)
+    {
+        const unsigned char* q   = r->data + r->keys[lo - 1].pos;
+        const unsigned char* end = r->data + r->size;
+        if (getVarint(&q, end, &len) && len <= (uint64_t)(end - q) && unpackSnapshot(q, (int)len, g))
+        {
+            at = r->keys[lo - 1].tick;
+            p  = q + len;
+            g->random.mode = r->mode;
+            g->frame       = at;
+        }
+        else
+        {
+            lo = 0;
+        }
+    }
+    if (lo == 0)
+        initGame(g, r->seed, r->mode);
+    g->das = r->das;
+    g->arr = r->arr;
+    simulate(r, g, p, at, tick, false);
+}
+
+/* （内部函数）
+ * 函数名：checkKeys
+ * -------------
+ * 再解码一遍事件，核对第 i 个关键帧事件所在的帧及快照位置与索引第 i 项相同，
+ * 且快照完整有效
+ */
+bool checkKeys(const tetReplay* r)
+{
+    const unsigned char* p   = r->data + r->events;
+    const unsigned char* end = r->data + r->size;
+    uint32_t tick = 0;
+    int code, arg, i = 0;
+    tetGame scratch;
+
+    while ((code = nextEvent(&p, end, &tick, &arg)) != ReplayEnd)
+    {
+        if (code != ReplayKey)
+            continue;
+
+        const unsigned char* snap = p - arg;
+        const unsigned char* q    = r->data + r->keys[i].pos;
+        uint64_t len;
+        if (r->keys[i].tick != tick || r->keys[i].pos >= r->size
+            || !getVarint(&q, end, &len) || q != snap || !unpackSnapshot(snap, arg, &scratch))
+            return false;
+        i++;
+    }
+    return true;
+}
+
+/* （内部函数）
+ * 函数名：simulate
+ * -------------
+ * 由 p 处的事件（上一事件在第 at 帧）继续模拟：每个事件之前推进到其所在的帧，
+ * 直到第 tick 帧的事件都已执行、或到达结尾、或游戏失败；
+ * 游戏失败后 gameTick 不再推进，因此失败的帧之后不会有事件
+ * check 为 true 时，经过关键帧即将当前游戏数据编码后与快照比较，返回是否全部一致
+ */
+bool simulate(const tetReplay* r, tetGame* g, const unsigned char* p, uint32_t at, uint32_t tick, bool check)
+{
+    const unsigned char* end = r->data + r->size;
+    unsigned char snap[ReplayKeyMax];
+    bool same = true;
+    int code, arg;
+
+    for (;;)
+    {
+        code = nextEvent(&p, end, &at, &arg);
+        while (g->frame < at && g->frame < tick && !g->over)
+            gameTick(g);
+        if (code == ReplayEnd || at > tick || g->over)
+            break;
+
+        if (code != ReplayKey)
+            applyAction(g, (tetAction)(code >> 1), code & 1, arg);
+        else if (check)
+            same = packSnapshot(g, snap) == arg && memcmp(snap, p - arg, arg) == 0 && same;
+    }
+    return same;
+}
+
+/* （内部函数）
+ * 函数名：writeKeyframe
+ * -------------
+ * 快照编码后连同其字节数作为关键帧事件放入缓冲区，并在索引中记下其位置；
+ * 索引无法扩容时不再记录关键帧，不影响事件的记录
+ */
+void writeKeyframe(tetReplayWriter* w, const tetGame* g)
+{
+    unsigned char snap[ReplayKeyMax];
+    int len = packSnapshot(g, snap);
+
+    if (w->keyCount == w->keyCap)
+    {
+        int cap = w->keyCap > 0 ? w->keyCap * 2 : 16;
+        tetReplayKey* keys = realloc(w->keys, cap * sizeof(tetReplayKey));
+        if (keys == NULL)
+        {
+            w->keyEvery = 0;
+            return;
+        }
+        w->keys   = keys;
+        w->keyCap = cap;
+    }
+
+    if (w->used > ReplayBufSize - ReplayEventMax - ReplayKeyMax)
+        flushReplay(w);
+
+    w->used += putVarint(w->buf + w->used, ((uint64_t)(g->frame - w->lastTick) << ReplayCodeBits) | ReplayKey);
+    w->keys[w->keyCount].tick = g->frame;
+    w->keys[w->keyCount].pos  = w->written + w->used;
+    w->keyCount++;
+
+    w->used += putVarint(w->buf + w->used, (uint64_t)len);
+    memcpy(w->buf + w->used, snap, len);
+    w->used += len;
+
+    w->lastTick = g->frame;
+    w->nextKey  = g->frame + w->keyEvery;
+}
+
+/*
+ * 函数名：packSnapshot
+ * -------------
+ * 按 replay.h 中所述的快照格式编码游戏 g，返回字节数（不超过 ReplayKeyMax）
+ * 没有暂存方块时，暂存方块记为0，使相同的局面总是得到相同的快照
+ */
+int packSnapshot(const tetGame* g, unsigned char* out)
+{
+    const tetBoard* b = &g->stored;
+    unsigned char* p = out;
+    tetBitStream s;
+    int i, x, y, h;
+
+    p += putVarint(p, (uint64_t)g->speed);
+    p += putVarint(p, (uint64_t)g->score);
+    p += putVarint(p, (uint64_t)g->level);
+    p += putVarint(p, (uint64_t)g->lines);
+    p += putVarint(p, (uint64_t)g->gravity);
+    p += putVarint(p, (uint64_t)g->lockTicks);
+    p += putVarint(p, ZigZag(g->shiftWait));
+
+    *p++ = (unsigned char)(g->OnHolding | g->OnRelease << 1 | g->delayOneRound << 2 | g->over << 3
+                           | g->shiftHeld << 4 | (g->shiftDir + 1) << 6);
+    *p++ = PackBlock(g->falling);
+    *p++ = PackBlock(g->nextBlock);
+    *p++ = g->OnHolding ? PackBlock(g->holdBlock) : 0;
+    p += putVarint(p, ZigZag(g->falling.coord.x));
+    p += putVarint(p, ZigZag(g->falling.coord.y));
+
+    for (i = 0; i < 16; ++i)
+        *p++ = (unsigned char)(g->random.rng.s[i / 4] >> (8 * (i % 4)));
+    *p++ = (unsigned char)g->random.bagLeft;
+    for (i = 0; i < g->random.bagLeft; ++i)
+        *p++ = g->random.bag[i];
+
+    // 只编码最高的非空行及其以下各行
+    for (h = MaxCoordY + 1; h > 0 && b->rows[h - 1] == 0; --h)
+        ;
+    *p++ = (unsigned char)h;
+
+    s.out  = p;
+    s.acc  = 0;
+    s.bits = 0;
+    for (y = 0; y < h; ++y)
+        putBits(&s, b->rows[y], MaxCoordX + 1);
+    for (y = 0; y < h; ++y)
+        for (x = 0; x <= MaxCoordX; ++x)
+            if (CellTaken(*b, x, y))
+                putBits(&s, b->color[y][x], 3);
+    if (s.bits > 0)
+        *s.out++ = (unsigned char)s.acc;
+
+    return s.out - out;
+}
+
+/*
+ * 函数名：unpackSnapshot
+ * -------------
+ * 由 p 起的 len 字节快照恢复游戏 g（方块序列生成模式、das、arr、帧数除外），
+ * 各列高度及哈希值由占用情况重新计算；快照不完整、有多余字节或数值无效时返回 false
+ */
+bool unpackSnapshot(const unsigned char* p, int len, tetGame* g)
+{
+    const unsigned char* end = p + len;
+    tetBoard* b = &g->stored;
+    tetBitStream s;
+    uint64_t v[7], cx, cy;
+    unsigned row, color;
+    int i, x, y, h;
+
+    for (i = 0; i < 7; ++i)
+        if (!getVarint(&p, end, &v[i]) || v[i] > (i < 6 ? INT32_MAX : UINT32_MAX))
+            return false;
+    if (v[0] == 0 || end - p < 4)
+        return false;
+
+    g->speed     = (int)v[0];
+    g->score     = (int)v[1];
+    g->level     = (int)v[2];
+    g->lines     = (int)v[3];
+    g->gravity   = (int)v[4];
+    g->lockTicks = (int)v[5];
+    g->shiftWait = UnZigZag(v[6]);
+
+    unsigned char flags = *p++;
+    g->OnHolding     = flags & 1;
+    g->OnRelease     = (flags >> 1) & 1;
+    g->delayOneRound = (flags >> 2) & 1;
+    g->over          = (flags >> 3) & 1;
+    g->shiftHeld     = (flags >> 4) & 3;
+    g->shiftDir      = ((flags >> 6) & 3) - 1;
+    if (g->shiftDir > 1)
+        return false;
+
+    if (!unpackBlock(*p++, &g->falling) || !unpackBlock(*p++, &g->nextBlock)
+        || !unpackBlock(*p++, &g->holdBlock) || !getVarint(&p, end, &cx) || !getVarint(&p, end, &cy)
+        || cx > UINT32_MAX || cy > UINT32_MAX)
+        return false;
+    g->falling.coord.x = UnZigZag(cx);
+    g->falling.coord.y = UnZigZag(cy);
+    if (g->falling.coord.x < 0 || g->falling.coord.x > MaxCoordX
+        || g->falling.coord.y < 0 || g->falling.coord.y > MaxCoordY)
+        return false;
+    moveToNextBox(&g->nextBlock);
+    moveToHoldBox(&g->holdBlock);
+
+    if (end - p < 17)
+        return false;
+    for (i = 0; i < 4; ++i)
+        g->random.rng.s[i] = 0;
+    for (i = 0; i < 16; ++i)
+        g->random.rng.s[i / 4] |= (uint32_t)*p++ << (8 * (i % 4));
+    g->random.bagLeft = *p++;
+    if (g->random.bagLeft > typeNum || end - p < g->random.bagLeft + 1)
+        return false;
+    for (i = 0; i < g->random.bagLeft; ++i)
+        if ((g->random.bag[i] = *p++) >= typeNum)
+            return false;
+
+    h = *p++;
+    if (h > MaxCoordY + 1)
+        return false;
+
+    memset(b, 0, sizeof(*b));
+    s.in   = p;
+    s.end  = end;
+    s.acc  = 0;
+    s.bits = 0;
+    for (y = 0; y < h; ++y)
+    {
+        if (!getBits(&s, &row, MaxCoordX + 1))
+            return false;
+        b->rows[y] = (tetRow)row;
+    }
+    for (y = 0; y < h; ++y)
+        for (x = 0; x <= MaxCoordX; ++x)
+            if (CellTaken(*b, x, y))
+            {
+                if (!getBits(&s, &color, 3) || color >= colorNum)
+                    return false;
+                b->color[y][x] = (unsigned char)color;
+                b->heights[x]  = (unsigned char)(y + 1);
+            }
+    b->hash = boardHash(b);
+
+    // 最后一个字节中不足8位的部分须为0，且不得有多余字节
+    return s.in == end && s.acc == 0;
+}
+
+/* （内部函数）
+ * 函数名：unpackBlock
+ * -------------
+ * 由1字节编码恢复方块的类型、方向及颜色，类型或颜色无效时返回 false
+ */
+bool unpackBlock(unsigned char c, tetBlock* b)
+{
+    b->type   = (tetType)(c & 7);
+    b->orient = (c >> 3) & 3;
+    b->color  = (tetColor)(c >> 5);
+    return b->type < typeNum && b->color < colorNum;
+}
+
+/* （内部函数）
+ * 函数名：nextEvent
+ * -------------
+ * 解码一个事件（或关键帧、结尾），累加所在的帧：
+ *      左右键按下时 arg 为 late，其余操作为0；
+ *      关键帧时 arg 为快照字节数，解码后 *p 位于快照之后，快照即其前 arg 个字节
+ * 返回事件代码，数据不完整或代码无效时返回 -1
+ */
+int nextEvent(const unsigned char** p, const unsigned char* end, uint32_t* tick, int* arg)
+{
+    uint64_t v, t;
+
+    if (!getVarint(p, end, &v) || (v >> ReplayCodeBits) > UINT32_MAX - *tick)
+        return -1;
+
+    int code = (int)(v & ((1 << ReplayCodeBits) - 1));
+    *tick += (uint32_t)(v >> ReplayCodeBits);
+    *arg = 0;
+
+    if (code == ReplayEnd)
+        return code;
+
+    if (code == ReplayKey)
+    {
+        if (!getVarint(p, end, &t) || t > ReplayKeyMax || (uint64_t)(end - *p) < t)
+            return -1;
+        *p  += t;
+        *arg = (int)t;
+        return code;
+    }
+
+    if (code >= actionNum * 2)
+        return -1;
+
+    if (code == ACT_LEFT * 2 || code == ACT_RIGHT * 2)
+    {
+        if (!getVarint(p, end, &t) || t > 999)
+            return -1;
+        *arg = (int)t;
+    }
+    return code;
+}
+
+/* （内部函数）
+ * 函数名：putBits
+ * -------------
+ * 向位流写入 v 的低 width 位，凑满的字节即写出
+ */
+void putBits(tetBitStream* s, unsigned v, int width)
+{
+    s->acc  |= (uint32_t)v << s->bits;
+    s->bits += width;
+    while (s->bits >= 8)
+    {
+        *s->out++ = (unsigned char)s->acc;
+        s->acc  >>= 8;
+        s->bits  -= 8;
+    }
+}
+
+/* （内部函数）
+ * 函数名：getBits
+ * -------------
+ * 由位流读出 width 位，数据不足时返回 false
+ */
+bool getBits(tetBitStream* s, unsigned* v, int width)
+{
+    while (s->bits < width)
+    {
+        if (s->in == s->end)
+            return false;
+        s->acc  |= (uint32_t)*s->in++ << s->bits;
+        s->bits += 8;
+    }
+    *v = s->acc & ((1u << width) - 1);
+    s->acc  >>= width;
+    s->bits  -= width;
+    return true;
+}
+
+/* （内部函数）
+ * 函数名：getVarint
+ * -------------
+ * 解码一个 varint，超出数据末尾或超过10字节时返回 false
+ */
+bool getVarint(const unsigned char** p, const unsigned char* end, uint64_t* v)
+{
+    const unsigned char* q = *p;
+    uint64_t x = 0;
+    int shift;
+
+    for (shift = 0; shift < 70 && q < end; shift += 7)
+    {
+        x |= (uint64_t)(*q & 0x7F) << shift;
+        if (!(*q++ & 0x80))
+        {
+            *p = q;
+            *v = x;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* （内部函数）
+ * 函数名：putVarint
+ * -------------
+ * 以 varint 编码写入 p：每字节低7位为数据，最高位为1代表后面还有字节
+ * 返回写入的字节数（至多10）
+ */
+int putVarint(unsigned char* p, uint64_t v)
+{
+    int n = 0;
+    while (v >= 0x80)
+    {
+        p[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (unsigned char)v;
+    return n;
+}
@@ -0,0 +1,325 @@
+/*
+ * 项目：Tetris
+ * 文件名：replay.h
+ * 概览：回放记录模块
+ * -------------
+ * 主要内容：
+ *      回放文件格式的定义
+ *      回放记录器（带缓冲、只追加写入）的定义及记录函数声明
+ *      回放的读入、校验、定位及无界面重新模拟
+ *
+ * 一局游戏的结果只由种子、方块序列生成模式、DAS/ARR 设置，
+ * 以及每个操作在哪一帧执行（连同左右键按下时早于该帧的时间）决定，
+ * 因此回放只需记录这些，而不必记录任何局面
+ *
+ * 回放文件格式（整数均为 varint：每字节低7位为数据，最高位为1代表后面还有字节）：
+ *      头部   - "TRPL"，版本号（1字节），模式（1字节），种子，das，arr，关键帧间隔（帧，0代表没有）
+ *      事件   - (帧差 << 4) | 代码，帧差为本事件与上一事件（或第0帧）所在帧之差，
+ *               代码为 操作*2 + 是否松开；按下左右键时后面另有 late（0~999）
+ *      关键帧 - (帧差 << 4) | ReplayKey，其后为快照的字节数及快照，
+ *               快照是该帧推进完毕、该帧的事件尚未执行时的全部游戏数据
+ *      结尾   - (帧差 << 4) | ReplayEnd，帧差为记录结束时的帧与上一事件之差，
+ *               其后为记录结束时的分数、消除行数、难度等级
+ *      索引   - 关键帧个数，各关键帧与上一个的 帧差、位置差（位置为其快照字节数在文件中的偏移）
+ *      末尾   - 索引在文件中的偏移（4字节，小端），"TIDX"
+ * 一局几分钟的游戏通常只有几千个事件，每个事件2~4字节；每个关键帧不超过 ReplayKeyMax 字节
+ *
+ * 快照依次为：
+ *      速度、分数、等级、行数、下落累计量、落定帧数，自动重复等待量（zigzag 编码，可为负）
+ *      标志（1字节）：暂存的三个标志、是否失败、按住的方向键（2位）、自动重复方向+1（2位）
+ *      下落、下一个、暂存方块（各1字节：类型3位、方向2位、颜色3位），下落方块坐标（zigzag 编码）
+ *      发生器状态（16字节，小端），bag 中剩余的个数及方块（各1字节）
+ *      方块堆高度 h（1字节），其后为位流：h 行的占用掩码各10位，再为各被占用格的颜色各3位
+ *
+ * 重新模拟时不需要计时器或界面：依次推进到每个事件所在的帧并执行它，
+ * 最后推进到结尾的帧，所得的分数、行数、等级应与结尾记录的完全相同；
+ * 定位到某一帧时，先恢复不晚于它的最近一个关键帧，只模拟其后的帧
+ *
+ * 外部接口：
+ *      回放记录：
+ *          openReplay
+ *          recordInput
+ *          recordTick
+ *          flushReplay
+ *          closeReplay
+ *          discardReplay
+ *      回放重现：
+ *          loadReplay
+ *          freeReplay
+ *          runReplay
+ *          seekReplay
+ *      快照编解码（游戏存档也使用）：
+ *          packSnapshot
+ *          unpackSnapshot
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "flow.h"   // 需要取得游戏上下文定义
+#include "input.h"  // 需要取得游戏操作定义
+
+#define ReplayMagic   "TRPL"
+#define ReplayVersion 3
+#define ReplayIndexMagic "TIDX"
+
+// 事件代码的位数，及表示关键帧、记录结束的代码
+#define ReplayCodeBits 4
+#define ReplayKey      14
+#define ReplayEnd      15
+
+// 界面上的游戏的关键帧间隔（帧），及一个快照的最大字节数
+#define ReplayKeyEvery (TickRate * 10)
+#define ReplayKeyMax   192
+
+// 回放文件路径的最大长度
+#define ReplayPathLen 64
+
+// 写入缓冲区大小；剩余空间不足一个事件（或结尾）的最大长度时写入文件
+#define ReplayBufSize   4096
+#define ReplayEventMax  32
+
+
+/* 关键帧索引的一项
+ *      tick - 关键帧所在的帧
+ *      pos  - 快照字节数在文件中的偏移
+ */
+typedef struct {
+  uint32_t tick;
+  uint32_t pos;
+} tetReplayKey;
+
+
+/* 回放记录器
+ *      fp       - 回放文件，未在记录时为 NULL
+ *      path     - 回放文件路径
+ *      lastTick - 上一事件（或关键帧）所在的帧
+ *      keyEvery - 关键帧间隔（帧），0 代表不记录关键帧
+ *      nextKey  - 下一个关键帧不早于哪一帧
+ *      keys     - 已记录的关键帧索引，keyCount 项，容量 keyCap 项
+ *      written  - 已写入文件的字节数
+ *      used     - 缓冲区中尚未写入文件的字节数
+ *      buf      - 写入缓冲区
+ */
+typedef struct {
+  FILE*         fp;
+  char          path[ReplayPathLen];
+  uint32_t      lastTick;
+  int           keyEvery;
+  uint32_t      nextKey;
+  tetReplayKey* keys;
+  int           keyCount;
+  int           keyCap;
+  uint32_t      written;
+  int           used;
+  unsigned char buf[ReplayBufSize];
+} tetReplayWriter;
+
+
+/* 读入内存的回放
+ *      seed, mode, das, arr - 头部记录的设置
+ *      keyEvery             - 关键帧间隔
+ *      keys                 - 关键帧索引，keyCount 项，按帧由小到大
+ *      endTick              - 记录结束时的帧
+ *      score, lines, level  - 结尾记录的结果
+ *      data, size           - 整个文件的内容
+ *      events               - 第一个事件在 data 中的位置
+ */
+typedef struct {
+  uint64_t       seed;
+  tetRandMode    mode;
+  int            das;
+  int            arr;
+  int            keyEvery;
+  tetReplayKey*  keys;
+  int            keyCount;
+  uint32_t       endTick;
+  int            score;
+  int            lines;
+  int            level;
+  unsigned char* data;
+  size_t         size;
+  size_t         events;
+} tetReplay;
+
+
+/*
+ * 函数名称：openReplay
+ * 函数原型：bool openReplay(tetReplayWriter* w, const char* path, uint64_t seed, const tetGame* g, int keyEvery)
+ * 功能描述：新建回放文件并写入头部，开始记录游戏 g，每隔 keyEvery 帧记录一个关键帧
+ *         | g 须为刚以种子 seed 初始化、尚未推进的一局游戏
+ * 副作用？：改变记录器，新建（或覆盖）文件
+ *
+ * 参数描述：回放记录器 w :: tetReplayWriter*
+ *         回放文件路径 path :: const char*
+ *         本局的随机种子 seed :: uint64_t
+ *         游戏上下文 g :: const tetGame*
+ *         关键帧间隔 keyEvery :: int，不大于0时不记录关键帧
+ * 返回类型：bool，false 代表文件无法创建，此时记录器不在记录
+ * --------------
+ * 使用方法：initGame(&yourGame, seed, mode);
+ *          openReplay(&w, "a.rpl", seed, &yourGame, ReplayKeyEvery);
+ */
+bool openReplay(tetReplayWriter* w, const char* path, uint64_t seed, const tetGame* g, int keyEvery);
+
+
+/*
+ * 函数名称：recordInput
+ * 函数原型：void recordInput(tetReplayWriter* w, uint32_t tick, tetAction a, bool release, int late)
+ * 功能描述：记录在第 tick 帧执行的一个操作（参数与 applyAction 相同）
+ *         | 只写入内存中的缓冲区，缓冲区将满时才写入文件
+ * 副作用？：改变记录器
+ *
+ * 参数描述：回放记录器 w :: tetReplayWriter*
+ *         执行操作时游戏已推进的帧数 tick :: uint32_t
+ *         操作 a :: tetAction
+ *         是否为松开按键 release :: bool
+ *         早于该帧的时间 late :: int（1/1000 帧，0~999）
+ * 返回类型：无
+ * --------------
+ * 使用方法：recordInput(&w, yourGame.frame, a, release, late);
+ *          applyAction(&yourGame, a, release, late);
+ */
+void recordInput(tetReplayWriter* w, uint32_t tick, tetAction a, bool release, int late);
+
+
+/*
+ * 函数名称：recordTick
+ * 函数原型：void recordTick(tetReplayWriter* w, const tetGame* g)
+ * 功能描述：游戏 g 每推进一帧后调用，距上一个关键帧满间隔时记录一个关键帧
+ *         | 其余的帧只做一次比较
+ * 副作用？：改变记录器
+ *
+ * 参数描述：回放记录器 w :: tetReplayWriter*
+ *         游戏上下文 g :: const tetGame*
+ * 返回类型：无
+ * --------------
+ * 使用方法：gameTick(&yourGame); recordTick(&w, &yourGame);
+ */
+void recordTick(tetReplayWriter* w, const tetGame* g);
+
+
+/*
+ * 函数名称：flushReplay
+ * 函数原型：void flushReplay(tetReplayWriter* w)
+ * 功能描述：将缓冲区中的数据写入文件（如暂停游戏时）
+ * 副作用？：改变记录器，写入文件
+ *
+ * 参数描述：回放记录器 w :: tetReplayWriter*
+ * 返回类型：无
+ * --------------
+ * 使用方法：flushReplay(&w);
+ */
+void flushReplay(tetReplayWriter* w);
+
+
+/*
+ * 函数名称：closeReplay / discardReplay
+ * 函数原型：bool closeReplay(tetReplayWriter* w, const tetGame* g)
+ *          void discardReplay(tetReplayWriter* w)
+ * 功能描述：写入结尾（记录到游戏 g 当前的帧）并关闭回放文件 /
+ *          放弃记录并删除回放文件（如本局改由电脑玩家操作时）
+ * 副作用？：改变记录器，写入或删除文件
+ *
+ * 参数描述：回放记录器 w :: tetReplayWriter*
+ *         游戏上下文 g :: const tetGame*
+ * 返回类型：closeReplay 返回 bool，false 代表写入失败
+ * --------------
+ * 使用方法：if (!closeReplay(&w, &yourGame)) ...
+ */
+bool closeReplay(tetReplayWriter* w, const tetGame* g);
+void discardReplay(tetReplayWriter* w);
+
+
+/*
+ * 函数名称：loadReplay / freeReplay
+ * 函数原型：bool loadReplay(tetReplay* r, const char* path)
+ *          void freeReplay(tetReplay* r)
+ * 功能描述：将回放文件整个读入内存，解析头部、索引并校验全部事件、关键帧及结尾 /
+ *          释放读入的回放
+ * 副作用？：改变 r，分配 / 释放内存
+ *
+ * 参数描述：回放 r :: tetReplay*
+ *         回放文件路径 path :: const char*
+ * 返回类型：loadReplay 返回 bool，false 代表文件无法读取、版本不符或已损坏，
+ *          此时不需要 freeReplay
+ * --------------
+ * 使用方法：if (loadReplay(&r, "a.rpl")) { ...; freeReplay(&r); }
+ */
+bool loadReplay(tetReplay* r, const char* path);
+void freeReplay(tetReplay* r);
+
+
+/*
+ * 函数名称：runReplay
+ * 函数原型：bool runReplay(const tetReplay* r, tetGame* g)
+ * 功能描述：在游戏 g 中从头重新模拟回放 r，直到结尾的帧（或游戏失败），
+ *          不由关键帧恢复，而是将模拟到该帧时的游戏数据与关键帧逐字节比较
+ *         | 不使用计时器、输入队列或界面，可在任意线程中同时模拟多个回放
+ * 副作用？：改变游戏 g 的全部数据
+ *
+ * 参数描述：回放 r :: const tetReplay*（须已由 loadReplay 校验）
+ *         游戏上下文 g :: tetGame*
+ * 返回类型：bool，false 代表有关键帧与模拟结果不一致；
+ *          之后 g 的 frame、score、lines、level 应与 r 中记录的相同
+ * --------------
+ * 使用方法：if (!runReplay(&r, &yourGame)) ...
+ */
+bool runReplay(const tetReplay* r, tetGame* g);
+
+
+/*
+ * 函数名称：seekReplay
+ * 函数原型：void seekReplay(const tetReplay* r, tetGame* g, uint32_t tick)
+ * 功能描述：使游戏 g 成为回放 r 推进到第 tick 帧、执行完该帧之前（含该帧）的事件后的状态
+ *         | 由不晚于 tick 的最近一个关键帧恢复，只模拟其后的帧；
+ *         | tick 超过结尾的帧（或游戏在此之前失败）时，停在结尾（或失败）处
+ * 副作用？：改变游戏 g 的全部数据
+ *
+ * 参数描述：回放 r :: const tetReplay*（须已由 loadReplay 校验）
+ *         游戏上下文 g :: tetGame*
+ *         帧 tick :: uint32_t
+ * 返回类型：无
+ * --------------
+ * 使用方法：seekReplay(&r, &yourGame, 60 * 90);  // 第90秒
+ */
+void seekReplay(const tetReplay* r, tetGame* g, uint32_t tick);
+
+
+/*
+ * 函数名称：packSnapshot
+ * 函数原型：int packSnapshot(const tetGame* g, unsigned char* out)
+ * 功能描述：按本文件开头所述的快照格式编码游戏 g 的全部数据
+ *         | （方块序列生成模式、das、arr、帧数除外），写入 out
+ * 副作用？：改变 out 指向的内存
+ *
+ * 参数描述：游戏上下文 g :: const tetGame*
+ *         输出 out :: unsigned char*，至少 ReplayKeyMax 字节
+ * 返回类型：int，写入的字节数
+ * --------------
+ * 使用方法：unsigned char buf[ReplayKeyMax]; int len = packSnapshot(&yourGame, buf);
+ */
+int packSnapshot(const tetGame* g, unsigned char* out);
+
+
+/*
+ * 函数名称：unpackSnapshot
+ * 函数原型：bool unpackSnapshot(const unsigned char* p, int len, tetGame* g)
+ * 功能描述：由 p 起的 len 字节快照恢复游戏 g，各列高度及哈希值由占用情况重新计算
+ *         | 方块序列生成模式、das、arr、帧数不变
+ * 副作用？：改变游戏 g（失败时 g 的内容不确定）
+ *
+ * 参数描述：快照 p :: const unsigned char*
+ *         字节数 len :: int
+ *         游戏上下文 g :: tetGame*
+ * 返回类型：bool，false 代表快照不完整、有多余字节或数值无效
+ * --------------
+ * 使用方法：if (unpackSnapshot(buf, len, &tmp)) yourGame = tmp;
+ */
+bool unpackSnapshot(const unsigned char* p, int len, tetGame* g);
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * 项目：Tetris
+ * 文件名：replayer.c
+ * 概览：回放校验程序 tetris-replay
+ * -------------
+ * 负责功能：
+ *      读入回放文件（格式见 replay.h），不用计时器、不绘制界面，尽快从头重新模拟，
+ *      检查结束时的帧、分数、消除行数、难度等级是否与回放结尾记录的相同，
+ *      以及模拟到各关键帧时的游戏数据是否与关键帧的快照相同
+ *
+ * 用法：tetris-replay [-t 线程数] [-r 重复次数] [-q] [-s 帧] 回放文件...
+ *      -t  线程数，0 代表逻辑处理器个数，默认 0
+ *      -r  每个回放重复模拟的次数，用于测量速度，默认 1
+ *      -q  只列出不一致或无法读取的回放
+ *      -s  不做校验，而是定位到该帧（由最近的关键帧恢复），列出此时的分数、行数、等级
+ *
+ * 每个回放是线程池（pool.h）中的一个任务，读入、模拟、比较都在任务中完成，
+ * 每个任务只写自己的结果，全部完成后按命令行中的顺序报告
+ * 有回放不一致或无法读取时，返回值为 1
+ * 只依赖核心库（libtetris_core.a）
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flow.h"     // 需要游戏上下文
+#include "replay.h"   // 需要读入并重新模拟回放
+#include "platform.h" // 需要计时
+#include "pool.h"     // 需要线程池
+
+
+/* 一个回放的校验任务
+ *      path   - 回放文件路径
+ *      repeat - 重复模拟的次数
+ *      seek   - 要定位到的帧，-1 代表从头模拟并校验
+ *      loaded - 是否读入成功
+ *      keysOk - 各关键帧是否都与模拟结果相同
+ *      replay - 读入的回放（只保留头部及结尾，文件内容在任务结束前释放）
+ *      result - 最后一次模拟结束时的游戏
+ */
+typedef struct {
+  const char* path;
+  int         repeat;
+  long long   seek;
+  bool        loaded;
+  bool        keysOk;
+  tetReplay   replay;
+  tetGame     result;
+} tetCheck;
+
+
+// 内部函数声明
+void checkTask(void* arg);
+bool matches(const tetCheck* c);
+
+
+int main(int argc, char* argv[])
+{
+    int threads = 0;
+    int repeat  = 1;
+    bool quiet  = false;
+    long long seek = -1;
+    int i, first;
+
+    // 解析命令行参数，其余为回放文件
+    for (i = 1; i < argc && argv[i][0] == '-'; ++i)
+    {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            repeat = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-q") == 0)
+            quiet = true;
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            seek = strtoll(argv[++i], NULL, 10);
+        else
+            break;
+    }
+    first = i;
+
+    if (first == argc || argv[first][0] == '-')
+    {
+        fprintf(stderr, "usage: %s [-t threads] [-r repeat] [-q] [-s tick] replay...\n", argv[0]);
+        return 1;
+    }
+    if (repeat <= 0 || seek < -1 || seek > UINT32_MAX)
+    {
+        fprintf(stderr, "repeat must be positive and tick must be 0 ~ %u\n", UINT32_MAX);
+        return 1;
+    }
+
+    int count = argc - first;
+    tetCheck* check = malloc(count * sizeof(tetCheck));
+    tetPool* pool   = createPool(threads);
+    if (check == NULL || pool == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        check[i].path   = argv[first + i];
+        check[i].repeat = repeat;
+        check[i].seek   = seek;
+    }
+
+    double begin = platNow();
+    poolRun(pool, checkTask, check, sizeof(tetCheck), count);
+    double elapsed = platNow() - begin;
+
+    // 按命令行中的顺序报告
+    int ok = 0, mismatched = 0, unreadable = 0;
+    long long frames = 0;
+    for (i = 0; i < count; ++i)
+    {
+        const tetCheck* c = &check[i];
+
+        if (!c->loaded)
+        {
+            unreadable++;
+            printf("%s  unreadable\n", c->path);
+            continue;
+        }
+
+        if (seek >= 0)
+        {
+            ok++;
+            printf("%s  frames %u  score %d  lines %d  level %d%s\n", c->path,
+                   c->result.frame, c->result.score, c->result.lines, c->result.level,
+                   c->result.over ? "  game over" : "");
+        }
+        else if (matches(c))
+        {
+            frames += (long long)c->result.frame * repeat;
+            ok++;
+            if (!quiet)
+                printf("%s  frames %u  score %d  lines %d  level %d  ok\n", c->path,
+                       c->result.frame, c->result.score, c->result.lines, c->result.level);
+        }
+        else
+        {
+            frames += (long long)c->result.frame * repeat;
+            mismatched++;
+            printf("%s  frames %u  score %d  lines %d  level %d  MISMATCH"
+                   " (recorded frames %u  score %d  lines %d  level %d%s)\n", c->path,
+                   c->result.frame, c->result.score, c->result.lines, c->result.level,
+                   c->replay.endTick, c->replay.score, c->replay.lines, c->replay.level,
+                   c->keysOk ? "" : "  keyframes differ");
+        }
+    }
+
+    if (elapsed <= 0)
+        elapsed = 1e-9;
+
+    printf("replays      %d\n", count);
+    printf("ok           %d\n", ok);
+    printf("mismatched   %d\n", mismatched);
+    printf("unreadable   %d\n", unreadable);
+    printf("threads      %d\n", poolThreads(pool));
+    printf("elapsed      %.3f s\n", elapsed);
+    printf("replays/sec  %.0f\n", (double)(ok + mismatched) * repeat / elapsed);
+    if (seek < 0)
+        printf("frames/sec   %.0f\n", frames / elapsed);
+
+    destroyPool(pool);
+    free(check);
+    return ok == count ? 0 : 1;
+}
+
+/* （内部函数）
+ * 函数名：checkTask
+ * -------------
+ * 线程池任务：读入一个回放，重新模拟（或定位）repeat 次，保留最后一次的结果
+ */
+void checkTask(void* arg)
+{
+    tetCheck* c = arg;
+    int k;
+
+    c->loaded = loadReplay(&c->replay, c->path);
+    if (!c->loaded)
+        return;
+
+    for (k = 0; k < c->repeat; ++k)
+    {
+        if (c->seek >= 0)
+            seekReplay(&c->replay, &c->result, (uint32_t)c->seek);
+        else
+            c->keysOk = runReplay(&c->replay, &c->result);
+    }
+
+    freeReplay(&c->replay);
+}
+
+/* （内部函数）
+ * 函数名：matches
+ * -------------
+ * 重新模拟的结果是否与回放结尾及各关键帧记录的相同
+ */
+bool matches(const tetCheck* c)
+{
+    return c->keysOk
+        && c->result.frame == c->replay.endTick
+        && c->result.score == c->replay.score
+        && c->result.lines == c->replay.lines
+        && c->result.level == c->replay.level;
+}
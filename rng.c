@@ -0,0 +1,123 @@
+/*
+ * 项目：Tetris
+ * 文件名：rng.c
+ * 概览：随机数模块
+ * -------------
+ * 负责功能：
+ *      伪随机数的产生（xoshiro128**）
+ *      方块类型、颜色序列的生成（均匀随机 / 7-bag）
+ */
+
+#include <stdint.h>
+
+#include "tetris.h"  // 需要取得方块类型及颜色定义
+#include "rng.h"     // 本模块
+
+// 32位循环左移
+#define Rotl(x, k) (((x) << (k)) | ((x) >> (32 - (k))))
+
+/*
+ * 函数名：seedRng
+ * -------------
+ * 用 splitmix64 将64位种子展开为128位状态
+ * 这样即使种子只差一位，得到的状态也相差很大；且状态不会全为0
+ */
+void seedRng(tetRng* r, uint64_t seed)
+{
+    int i;
+    uint64_t z;
+    for (i = 0; i < 4; i += 2)
+    {
+        z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z = z ^ (z >> 31);
+
+        r->s[i]   = (uint32_t)z;
+        r->s[i+1] = (uint32_t)(z >> 32);
+    }
+}
+
+/*
+ * 函数名：nextRand
+ * -------------
+ * xoshiro128**：取得下一个32位伪随机数
+ */
+uint32_t nextRand(tetRng* r)
+{
+    uint32_t* s = r->s;
+    uint32_t result = Rotl(s[1] * 5, 7) * 9;
+    uint32_t t = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = Rotl(s[3], 11);
+
+    return result;
+}
+
+/*
+ * 函数名：randBelow
+ * -------------
+ * 取得 [0, n) 范围内的伪随机整数
+ * 用乘法取高位代替取模，避免除法，且低位质量不影响结果
+ */
+int randBelow(tetRng* r, int n)
+{
+    return (int)(((uint64_t)nextRand(r) * (uint32_t)n) >> 32);
+}
+
+/*
+ * 函数名：initRandomizer
+ * -------------
+ * 以给定种子和模式初始化方块序列生成器
+ */
+void initRandomizer(tetRandomizer* r, uint64_t seed, tetRandMode mode)
+{
+    seedRng(&r->rng, seed);
+    r->mode    = mode;
+    r->bagLeft = 0;
+}
+
+/*
+ * 函数名：randomType
+ * -------------
+ * 按生成模式取得下一个方块类型
+ */
+tetType randomType(tetRandomizer* r)
+{
+    if (r->mode == RAND_UNIFORM)
+        return randBelow(&r->rng, typeNum);
+
+    // 当前这一组已取完，则重新装满7种方块并打乱（Fisher-Yates）
+    if (r->bagLeft == 0)
+    {
+        int i, j;
+        unsigned char tmp;
+        for (i = 0; i < typeNum; ++i)
+            r->bag[i] = i;
+        for (i = typeNum - 1; i > 0; --i)
+        {
+            j = randBelow(&r->rng, i + 1);
+            tmp       = r->bag[i];
+            r->bag[i] = r->bag[j];
+            r->bag[j] = tmp;
+        }
+        r->bagLeft = typeNum;
+    }
+
+    return r->bag[--r->bagLeft];
+}
+
+/*
+ * 函数名：randomColor
+ * -------------
+ * 随机取得一种方块颜色
+ */
+tetColor randomColor(tetRandomizer* r)
+{
+    return randBelow(&r->rng, colorNum);
+}
@@ -0,0 +1,142 @@
+/*
+ * 项目：Tetris
+ * 文件名：rng.h
+ * 概览：随机数模块
+ * -------------
+ * 主要内容：
+ *      可设定种子的快速伪随机数发生器（xoshiro128**）
+ *      方块序列生成器（均匀随机 / 7-bag 两种模式）
+ *
+ * 每局游戏持有自己的生成器，不依赖 C 库 rand() 的全局状态，
+ * 因此相同种子必然得到相同的方块序列，多局游戏之间也互不影响
+ *
+ * 外部接口：
+ *      伪随机数发生器：
+ *          seedRng
+ *          nextRand
+ *          randBelow
+ *      方块序列生成器：
+ *          initRandomizer
+ *          randomType
+ *          randomColor
+ */
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+#include "tetris.h"  // 需要取得方块类型及颜色定义
+
+// 伪随机数发生器状态，共128位
+typedef struct {
+  uint32_t s[4];
+} tetRng;
+
+
+/* 方块序列生成模式
+ *      RAND_UNIFORM - 每个方块的类型独立均匀随机（原有玩法）
+ *      RAND_BAG     - 7-bag：每7个方块为一组，恰好包含全部7种类型，组内顺序随机
+ */
+typedef enum {
+  RAND_UNIFORM, RAND_BAG
+} tetRandMode;
+
+
+// 方块序列生成器，包含发生器状态、生成模式及当前这一组（bag）中剩余的方块
+typedef struct {
+  tetRng        rng;
+  tetRandMode   mode;
+  unsigned char bag[typeNum];
+  int           bagLeft;
+} tetRandomizer;
+
+
+/*
+ * 函数名称：seedRng
+ * 函数原型：void seedRng(tetRng* r, uint64_t seed)
+ * 功能描述：用64位种子初始化发生器状态（经 splitmix64 展开）
+ * 副作用？：改变传入的发生器状态
+ *
+ * 参数描述：发生器 r :: tetRng*
+ *         种子 seed :: uint64_t
+ * 返回类型：无
+ * --------------
+ * 使用方法：seedRng(&yourRng, 20190520);
+ */
+void seedRng(tetRng* r, uint64_t seed);
+
+
+/*
+ * 函数名称：nextRand
+ * 函数原型：uint32_t nextRand(tetRng* r)
+ * 功能描述：取得下一个32位伪随机数
+ * 副作用？：改变传入的发生器状态
+ *
+ * 参数描述：发生器 r :: tetRng*
+ * 返回类型：uint32_t，伪随机数
+ * --------------
+ * 使用方法：uint32_t x = nextRand(&yourRng);
+ */
+uint32_t nextRand(tetRng* r);
+
+
+/*
+ * 函数名称：randBelow
+ * 函数原型：int randBelow(tetRng* r, int n)
+ * 功能描述：取得 [0, n) 范围内的伪随机整数
+ * 副作用？：改变传入的发生器状态
+ *
+ * 参数描述：发生器 r :: tetRng*
+ *         上界 n :: int（须大于0）
+ * 返回类型：int，伪随机整数
+ * --------------
+ * 使用方法：int k = randBelow(&yourRng, 7);
+ */
+int randBelow(tetRng* r, int n);
+
+
+/*
+ * 函数名称：initRandomizer
+ * 函数原型：void initRandomizer(tetRandomizer* r, uint64_t seed, tetRandMode mode)
+ * 功能描述：以给定种子和模式初始化方块序列生成器
+ * 副作用？：改变传入的生成器
+ *
+ * 参数描述：生成器 r :: tetRandomizer*
+ *         种子 seed :: uint64_t
+ *         生成模式 mode :: tetRandMode（定义见本文件）
+ * 返回类型：无
+ * --------------
+ * 使用方法：initRandomizer(&yourGame->random, seed, RAND_BAG);
+ */
+void initRandomizer(tetRandomizer* r, uint64_t seed, tetRandMode mode);
+
+
+/*
+ * 函数名称：randomType
+ * 函数原型：tetType randomType(tetRandomizer* r)
+ * 功能描述：按生成模式取得下一个方块类型
+ * 副作用？：改变传入的生成器
+ *
+ * 参数描述：生成器 r :: tetRandomizer*
+ * 返回类型：tetType，方块类型
+ * --------------
+ * 使用方法：tetType t = randomType(&yourGame->random);
+ */
+tetType randomType(tetRandomizer* r);
+
+
+/*
+ * 函数名称：randomColor
+ * 函数原型：tetColor randomColor(tetRandomizer* r)
+ * 功能描述：随机取得一种方块颜色（两种模式下都是均匀随机）
+ * 副作用？：改变传入的生成器
+ *
+ * 参数描述：生成器 r :: tetRandomizer*
+ * 返回类型：tetColor，方块颜色
+ * --------------
+ * 使用方法：tetColor c = randomColor(&yourGame->random);
+ */
+tetColor randomColor(tetRandomizer* r);
+
+#endif
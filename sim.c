@@ -0,0 +1,183 @@
+/*
+ * 项目：Tetris
+ * 文件名：sim.c
+ * 概览：无界面模拟程序 tetris-sim
+ * -------------
+ * 负责功能：
+ *      在同一进程中并排进行多局无界面游戏，尽可能快地落下方块，
+ *      统计并报告每秒落下的方块数、每秒消除的行数
+ *
+ * 用法：tetris-sim [-n 局数] [-p 每局方块上限] [-s 种子] [-b] [-a] [-w 束宽] [-d 深度] [-t 线程数] [-H 位数]
+ *      -n  同时进行的游戏局数，默认 1000
+ *      -p  每局最多落下的方块数，默认 1000
+ *      -s  随机种子，第 i 局使用 种子+i，默认 1
+ *      -b  使用 7-bag 方块序列，默认为均匀随机
+ *      -a  由电脑玩家（ai.h）操作，默认为随机操作
+ *      -w  电脑玩家的束宽，默认见 initAI
+ *      -d  电脑玩家的搜索深度，默认见 initAI
+ *      -t  电脑玩家搜索所用的线程数，0 代表逻辑处理器个数，默认 1
+ *      -H  电脑玩家置换表大小的对数（表有 2^位数 项），默认不使用置换表
+ *
+ * 随机操作时，每个方块随机旋转、随机左右平移后直接落底
+ * 只依赖核心库（libtetris_core.a）
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tetris.h"   // 需要控制方块
+#include "flow.h"     // 需要游戏上下文
+#include "rng.h"      // 模拟操作本身也需要随机数
+#include "platform.h" // 需要计时
+#include "ai.h"       // 需要电脑玩家
+#include "pool.h"     // 电脑玩家可以多线程搜索
+#include "ttable.h"   // 电脑玩家可以使用置换表
+
+/* （内部函数）
+ * 函数名：playPiece
+ * -------------
+ * 对游戏 g 的当前方块做一次随机操作：随机旋转、随机平移，然后落底
+ */
+void playPiece(tetGame* g, tetRng* r)
+{
+    int turns = randBelow(r, 4);
+    int shift = randBelow(r, MaxCoordX + 1) - MaxCoordX / 2;
+
+    while (turns-- > 0)
+        rotate(g);
+
+    for (; shift < 0; ++shift)
+        move(g, TM_LEFT);
+    for (; shift > 0; --shift)
+        move(g, TM_RIGHT);
+
+    drop(g);
+}
+
+int main(int argc, char* argv[])
+{
+    int games     = 1000;
+    int maxPieces = 1000;
+    unsigned long long seed = 1;
+    tetRandMode mode = RAND_UNIFORM;
+    bool useAI = false;
+    int threads = 1;
+    int tableBits = 0;
+    tetAI ai;
+
+    initAI(&ai);
+
+    // 解析命令行参数
+    int i;
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            games = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+            maxPieces = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-b") == 0)
+            mode = RAND_BAG;
+        else if (strcmp(argv[i], "-a") == 0)
+            useAI = true;
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+            ai.beamWidth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+            ai.depth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-H") == 0 && i + 1 < argc)
+            tableBits = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [-n games] [-p pieces] [-s seed] [-b] [-a] [-w width] [-d depth] [-t threads] [-H bits]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (games <= 0 || maxPieces <= 0)
+    {
+        fprintf(stderr, "games and pieces must be positive\n");
+        return 1;
+    }
+
+    tetGame* g   = malloc(games * sizeof(tetGame));
+    int* pieces  = calloc(games, sizeof(int));
+    if (g == NULL || pieces == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    if (useAI && threads != 1)
+        ai.pool = createPool(threads);
+    if (useAI && tableBits > 0)
+        ai.table = createTTable(tableBits);
+
+    tetRng r;
+    seedRng(&r, seed);
+    for (i = 0; i < games; ++i)
+        initGame(&g[i], seed + i, mode);
+
+    // 所有游戏轮流各落一个方块，直到全部结束或达到方块上限
+    long long totalPieces = 0;
+    long long totalLines  = 0;
+    long long totalScore  = 0;
+    int running = games;
+
+    double begin = platNow();
+    while (running > 0)
+    {
+        running = 0;
+        for (i = 0; i < games; ++i)
+        {
+            if (g[i].over || pieces[i] >= maxPieces)
+                continue;
+
+            if (useAI)
+                aiPlay(&ai, &g[i]);
+            else
+                playPiece(&g[i], &r);
+            pieces[i]++;
+            totalPieces++;
+            running++;
+        }
+    }
+    double elapsed = platNow() - begin;
+
+    for (i = 0; i < games; ++i)
+    {
+        totalLines += getLines(&g[i]);
+        totalScore += getScore(&g[i]);
+    }
+
+    if (elapsed <= 0)
+        elapsed = 1e-9;
+
+    int over = 0;
+    for (i = 0; i < games; ++i)
+        over += g[i].over;
+
+    printf("games        %d\n", games);
+    printf("games over   %d\n", over);
+    printf("pieces       %lld\n", totalPieces);
+    printf("lines        %lld\n", totalLines);
+    printf("avg score    %.2f\n", (double)totalScore / games);
+    printf("elapsed      %.3f s\n", elapsed);
+    printf("pieces/sec   %.0f\n", totalPieces / elapsed);
+    printf("lines/sec    %.0f\n", totalLines / elapsed);
+    if (useAI)
+    {
+        printf("threads      %d\n", poolThreads(ai.pool));
+        printf("decisions/s  %.0f\n", totalPieces / elapsed);
+    }
+
+    destroyPool(ai.pool);
+    destroyTTable(ai.table);
+    free(g);
+    free(pieces);
+    return 0;
+}
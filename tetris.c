@@ -14,15 +14,11 @@
 
 #include "layout.h" // 需要取得方块堆大小
 #include "tetris.h" // 本模块
+#include "flow.h"   // 需要取得游戏上下文定义，并在方块落定后开启下一轮
+#include "rng.h"    // 需要生成随机方块
 
-/* 引入流程控制模块 flow.c 中的变量，分别为
- *      已落下的方块堆 stored
- *      正在下落的方块 falling
- *      下一个下落方块 nextBlock
- */
-extern tetBoard stored[MaxCoordY+1][MaxCoordX+1];
-extern tetBlock falling;
-extern tetBlock nextBlock;
+#define Min(x,y) ((x)<(y) ? (x):(y))
+#define Max(x,y) ((x)>(y) ? (x):(y))
 
 /* 坐标操作相关宏定义 */
 
@@ -33,91 +29,120 @@ extern tetBlock nextBlock;
             (v).y = ny; \
         }
 
-// 绕中心格顺时针旋转一个周围格，即复数乘法 (x, y) * (-i) = (y, -x)
-#define FlipCoord(v) \
-        { \
-            tmp = -(v).x; \
-            (v).x = (v).y; \
-            (v).y = tmp; \
-        }
-
-// 绕中心格逆时针旋转一个周围格，即复数乘法 (x, y) * i = (-y, x)
-#define BackFlipCoord(v) \
+// 将坐标 v 所在格加入方块堆 board，颜色为 c，并更新该列高度
+#define TakeCell(board, v, c) \
         { \
-            tmp = (v).x; \
-            (v).x = -(v).y; \
-            (v).y = tmp; \
+            (board)->rows[(v).y] |= (tetRow)(1 << (v).x); \
+            (board)->color[(v).y][(v).x] = (c); \
+            if ((board)->heights[(v).x] <= (v).y) \
+                (board)->heights[(v).x] = (v).y + 1; \
         }
 
-// 检测坐标 v 所在块是否被占用
-#define AlreadyTaken(v) ( \
-        InBound(v) && \
-        stored[(v).y][(v).x].statu == CELL_TAKEN)
-
 
 // 内部函数声明
-void addToBoard();
-int  eliminateLines();
+uint64_t rowKey(int y, tetRow row);
+int  landingRow(const tetBoard* board, const tetBlock* b);
+void lockFalling(tetGame* g);
+
+/* 方块形态表
+ * 下标依次为方块类型、方向序号，方向序号每加1即顺时针旋转90度
+ * 每一项依次为：3个周围格、包围盒 minX, maxX, minY, maxY、各行掩码、各列底格
+ *
+ * 方向0即各方块的初始状态，其余方向由初始状态绕中心格做复数乘法 (x, y) * (-i) 得到
+ * O型方块旋转后形态不变，4个方向相同
+ */
+const tetShape shapeTable[typeNum][4] =
+{
+    // I型
+    {
+        { { { 0, -1}, { 0,  1}, { 0,  2} },  0,  0, -1,  2,
+          { 0x1, 0x1, 0x1, 0x1 }, { -1,  0,  0,  0 } },
+        { { {-1,  0}, { 1,  0}, { 2,  0} }, -1,  2,  0,  0,
+          { 0xF, 0x0, 0x0, 0x0 }, {  0,  0,  0,  0 } },
+        { { { 0,  1}, { 0, -1}, { 0, -2} },  0,  0, -2,  1,
+          { 0x1, 0x1, 0x1, 0x1 }, { -2,  0,  0,  0 } },
+        { { { 1,  0}, {-1,  0}, {-2,  0} }, -2,  1,  0,  0,
+          { 0xF, 0x0, 0x0, 0x0 }, {  0,  0,  0,  0 } }
+    },
+    // J型
+    {
+        { { {-1,  0}, { 0,  1}, { 0,  2} }, -1,  0,  0,  2,
+          { 0x3, 0x2, 0x2, 0x0 }, {  0,  0,  0,  0 } },
+        { { { 0,  1}, { 1,  0}, { 2,  0} },  0,  2,  0,  1,
+          { 0x7, 0x1, 0x0, 0x0 }, {  0,  0,  0,  0 } },
+        { { { 1,  0}, { 0, -1}, { 0, -2} },  0,  1, -2,  0,
+          { 0x1, 0x1, 0x3, 0x0 }, { -2,  0,  0,  0 } },
+        { { { 0, -1}, {-1,  0}, {-2,  0} }, -2,  0, -1,  0,
+          { 0x4, 0x7, 0x0, 0x0 }, {  0,  0, -1,  0 } }
+    },
+    // L型
+    {
+        { { { 1,  0}, { 0,  1}, { 0,  2} },  0,  1,  0,  2,
+          { 0x3, 0x1, 0x1, 0x0 }, {  0,  0,  0,  0 } },
+        { { { 0, -1}, { 1,  0}, { 2,  0} },  0,  2, -1,  0,
+          { 0x1, 0x7, 0x0, 0x0 }, { -1,  0,  0,  0 } },
+        { { {-1,  0}, { 0, -1}, { 0, -2} }, -1,  0, -2,  0,
+          { 0x2, 0x2, 0x3, 0x0 }, {  0, -2,  0,  0 } },
+        { { { 0,  1}, {-1,  0}, {-2,  0} }, -2,  0,  0,  1,
+          { 0x7, 0x4, 0x0, 0x0 }, {  0,  0,  0,  0 } }
+    },
+    // O型
+    {
+        { { { 1,  0}, { 0,  1}, { 1,  1} },  0,  1,  0,  1,
+          { 0x3, 0x3, 0x0, 0x0 }, {  0,  0,  0,  0 } },
+        { { { 1,  0}, { 0,  1}, { 1,  1} },  0,  1,  0,  1,
+          { 0x3, 0x3, 0x0, 0x0 }, {  0,  0,  0,  0 } },
+        { { { 1,  0}, { 0,  1}, { 1,  1} },  0,  1,  0,  1,
+          { 0x3, 0x3, 0x0, 0x0 }, {  0,  0,  0,  0 } },
+        { { { 1,  0}, { 0,  1}, { 1,  1} },  0,  1,  0,  1,
+          { 0x3, 0x3, 0x0, 0x0 }, {  0,  0,  0,  0 } }
+    },
+    // S型
+    {
+        { { {-1,  0}, { 0,  1}, { 1,  1} }, -1,  1,  0,  1,
+          { 0x3, 0x6, 0x0, 0x0 }, {  0,  0,  1,  0 } },
+        { { { 0,  1}, { 1,  0}, { 1, -1} },  0,  1, -1,  1,
+          { 0x2, 0x3, 0x1, 0x0 }, {  0, -1,  0,  0 } },
+        { { { 1,  0}, { 0, -1}, {-1, -1} }, -1,  1, -1,  0,
+          { 0x3, 0x6, 0x0, 0x0 }, { -1, -1,  0,  0 } },
+        { { { 0, -1}, {-1,  0}, {-1,  1} }, -1,  0, -1,  1,
+          { 0x2, 0x3, 0x1, 0x0 }, {  0, -1,  0,  0 } }
+    },
+    // Z型
+    {
+        { { {-1,  1}, { 0,  1}, { 1,  0} }, -1,  1,  0,  1,
+          { 0x6, 0x3, 0x0, 0x0 }, {  1,  0,  0,  0 } },
+        { { { 1,  1}, { 1,  0}, { 0, -1} },  0,  1, -1,  1,
+          { 0x1, 0x3, 0x2, 0x0 }, { -1,  0,  0,  0 } },
+        { { { 1, -1}, { 0, -1}, {-1,  0} }, -1,  1, -1,  0,
+          { 0x6, 0x3, 0x0, 0x0 }, {  0, -1, -1,  0 } },
+        { { {-1, -1}, {-1,  0}, { 0,  1} }, -1,  0, -1,  1,
+          { 0x1, 0x3, 0x2, 0x0 }, { -1,  0,  0,  0 } }
+    },
+    // T型
+    {
+        { { { 0,  1}, {-1,  0}, { 1,  0} }, -1,  1,  0,  1,
+          { 0x7, 0x2, 0x0, 0x0 }, {  0,  0,  0,  0 } },
+        { { { 1,  0}, { 0,  1}, { 0, -1} },  0,  1, -1,  1,
+          { 0x1, 0x3, 0x1, 0x0 }, { -1,  0,  0,  0 } },
+        { { { 0, -1}, { 1,  0}, {-1,  0} }, -1,  1, -1,  0,
+          { 0x2, 0x7, 0x0, 0x0 }, {  0, -1,  0,  0 } },
+        { { {-1,  0}, { 0, -1}, { 0,  1} }, -1,  0, -1,  1,
+          { 0x2, 0x3, 0x2, 0x0 }, {  0, -1,  0,  0 } }
+    }
+};
 
 /*
  * 函数名：initBlock
  * -------------
- * 将传入方块设为初始状态
- *
- * 有关方块的结构，定义一个中心格和三个周围格
- * 中心格储存绝对坐标，周围格储存相对中心格的坐标
- *
- * 这样定义的好处：
- * 一、节省空间；
- * 二、通用性好，所有方块可用一种结构表达；
- * 三、操作方便，无需考虑当前方向，移动只需改变中心格坐标，旋转只需做一个复数乘法
+ * 将传入方块设为初始状态，即方向0
  *
- * 有关方块结构的图文说明以及初始状态的约定，详见：
+ * 有关方块形态以及初始状态的约定，见本文件的形态表 shapeTable，或：
  * https://www.processon.com/view/link/5cdf7a55e4b005286487410e
  */
 void initBlock(tetBlock* b)
 {
-    // 根据方块类型设定初始状态
-    switch (b->type)
-    {
-        case TET_I:
-            SetCoord(b->surround[0],  0, -1);
-            SetCoord(b->surround[1],  0,  1);
-            SetCoord(b->surround[2],  0,  2);
-            break;
-        case TET_J:
-            SetCoord(b->surround[0], -1,  0);
-            SetCoord(b->surround[1],  0,  1);
-            SetCoord(b->surround[2],  0,  2);
-            break;
-        case TET_L:
-            SetCoord(b->surround[0],  1,  0);
-            SetCoord(b->surround[1],  0,  1);
-            SetCoord(b->surround[2],  0,  2);
-            break;
-        case TET_O:
-            SetCoord(b->surround[0],  1,  0);
-            SetCoord(b->surround[1],  0,  1);
-            SetCoord(b->surround[2],  1,  1);
-            break;
-        case TET_S:
-            SetCoord(b->surround[0], -1,  0);
-            SetCoord(b->surround[1],  0,  1);
-            SetCoord(b->surround[2],  1,  1);
-            break;
-        case TET_Z:
-            SetCoord(b->surround[0], -1,  1);
-            SetCoord(b->surround[1],  0,  1);
-            SetCoord(b->surround[2],  1,  0);
-            break;
-        case TET_T:
-            SetCoord(b->surround[0],  0,  1);
-            SetCoord(b->surround[1], -1,  0);
-            SetCoord(b->surround[2],  1,  0);
-            break;
-        default:
-            break;
-    }
+    b->orient = 0;
 }
 
 /*
@@ -125,16 +150,16 @@ void initBlock(tetBlock* b)
  * -------------
  * 生成下一个方块
  */
-void geneNext()
+void geneNext(tetGame* g)
 {
-    // 随机选择方块类型和颜色
-    nextBlock.type    = rand() % typeNum;
-    nextBlock.color   = rand() % colorNum;
+    // 由本局的生成器选择方块类型和颜色
+    g->nextBlock.type    = randomType(&g->random);
+    g->nextBlock.color   = randomColor(&g->random);
 
     // 将方块移动到右上角显示下一个的方框内
-    moveToNextBox(&nextBlock);
+    moveToNextBox(&g->nextBlock);
     // 初始化方块
-    initBlock(&nextBlock);
+    initBlock(&g->nextBlock);
 }
 
 /*
@@ -142,66 +167,83 @@ void geneNext()
  * -------------
  * 顺时针旋转正在下落的方块
  */
-void rotate()
+void rotate(tetGame* g)
 {
-    // O型方块无需旋转
-    if (falling.type == TET_O)
-        return;
+    rotateBlock(&g->stored, &g->falling);
+}
 
-    // 中心格不变，对周围格做复数乘法（乘以-i）
-    int i, tmp;
-    for (i = 0; i < 3; ++i)
+/*
+ * 函数名：rotateBlock
+ * -------------
+ * 在方块堆 board 中顺时针旋转方块 b，旋转失败则保持原状
+ */
+bool rotateBlock(const tetBoard* board, tetBlock* b)
+{
+    // O型方块无需旋转
+    if (b->type == TET_O)
+        return false;
+
+    // 中心格不变，查表切换到下一个方向
+    tetBlock prev = *b;
+    b->orient = (b->orient + 1) & 3;
+
+    // 与左右边界碰撞，则根据包围盒直接平移到边界内
+    const tetShape* s = ShapeOf(*b);
+    if (b->coord.x + s->minX < 0)
+        b->coord.x = -s->minX;
+    else if (b->coord.x + s->maxX > MaxCoordX)
+        b->coord.x = MaxCoordX - s->maxX;
+
+    // 与底部或其他方块碰撞，则恢复原状态
+    if (blockCheck(board, b) != FREEMOVE)
     {
-        FlipCoord(falling.surround[i]);
+        *b = prev;
+        return false;
     }
+    return true;
+}
+
+/*
+ * 函数名：slideBlock
+ * -------------
+ * 每种方块每一行的格子都是连续的，因此在每一行中，
+ * 只需找到方块该行格子外侧最近的占用格，它与方块之间的空格数即该行允许平移的格数，
+ * 各行及边界允许的格数取最小值即为结果
+ */
+int slideBlock(const tetBoard* board, tetBlock* b, tetMove direction)
+{
+    const tetShape* s = ShapeOf(*b);
+    int left  = b->coord.x + s->minX;
+    int dist  = direction == TM_LEFT ? left : MaxCoordX - (b->coord.x + s->maxX);
+    int i, row;
 
-    tetBoundStatu bs = collisionCheck();
-    // 检测当前状态是否会产生碰撞
-    switch (bs)
+    for (i = 0, row = b->coord.y + s->minY; i <= s->maxY - s->minY && row <= MaxCoordY; ++i, ++row)
     {
-        // 与底部或其他方块碰撞，则恢复原状态
-        case COLLIDED:
-            for (i = 0; i < 3; ++i)
-            {
-                BackFlipCoord(falling.surround[i]);
-            }
-            break;
-
-        // 与左边界碰撞，则右移直到不再碰撞；或无法右移，恢复原状态
-        case LEFT_BOUND:
-
-            do {
-                falling.coord.x++;
-                bs = collisionCheck();
-            } while (bs == LEFT_BOUND);
-
-            if (bs == COLLIDED)
-            {
-                falling.coord.x--;
-                for (i = 0; i < 3; ++i)
-                    BackFlipCoord(falling.surround[i]);
-            }
-            break;
-
-        // 与右边界碰撞，则左移直到不再碰撞；或无法左移，恢复原状态
-        case RIGHT_BOUND:
-
-            do {
-                falling.coord.x--;
-                bs = collisionCheck();
-            } while (bs == RIGHT_BOUND);
-
-            if (bs == COLLIDED)
-            {
-                falling.coord.x++;
-                for (i = 0; i < 3; ++i)
-                    BackFlipCoord(falling.surround[i]);
-            }
-            break;
-
-        default:
-            break;
+        unsigned int cells = (unsigned int)s->mask[i] << left;
+        unsigned int occupied = board->rows[row];
+        if (cells == 0 || occupied == 0)
+            continue;
+
+        if (direction == TM_LEFT)
+        {
+            // 该行最左格左侧的占用格中，最靠右的一个
+            int lo = __builtin_ctz(cells);
+            unsigned int side = occupied & ((1u << lo) - 1);
+            if (side != 0)
+                dist = Min(dist, lo - (31 - __builtin_clz(side)) - 1);
+        }
+        else
+        {
+            // 该行最右格右侧的占用格中，最靠左的一个
+            int hi = 31 - __builtin_clz(cells);
+            unsigned int side = occupied >> (hi + 1);
+            if (side != 0)
+                dist = Min(dist, __builtin_ctz(side));
+        }
     }
+
+    b->coord.x += direction * dist;
+    return dist;
 }
 
 /*
@@ -209,27 +251,26 @@ void rotate()
  * -------------
  * 移动正在下落的方块（左、右、下）
  */
-void move(tetMove direction)
+void move(tetGame* g, tetMove direction)
 {
     // 下落
     if (direction == TM_DOWN)
     {
-        falling.coord.y--;
-        if (collisionCheck() == COLLIDED)
+        g->falling.coord.y--;
+        if (collisionCheck(g) == COLLIDED)
         {
             // 如碰撞，则添加到已落下方块，开始下一轮
-            falling.coord.y++;
-            addToBoard();
-            newRound();
+            g->falling.coord.y++;
+            lockFalling(g);
         }
     }
     // 左右移动
     else
     {
-        falling.coord.x += direction;
+        g->falling.coord.x += direction;
         // 到达边界，则退回
-        if (collisionCheck() != FREEMOVE)
-            falling.coord.x -= direction;
+        if (collisionCheck(g) != FREEMOVE)
+            g->falling.coord.x -= direction;
     }
 }
 
@@ -238,58 +279,107 @@ void move(tetMove direction)
  * -------------
  * 将正在下落的方块直接降落到底部，并开启下一轮
  */
-void drop()
+void drop(tetGame* g)
 {
-    // 不断下落，直到发生碰撞
-    do {
-        falling.coord.y--;
-    } while (collisionCheck() == FREEMOVE);
+    // 由各列高度直接算出落点，无需逐行下落
+    g->falling.coord.y = landingRow(&g->stored, &g->falling);
 
-    falling.coord.y++;
     // 添加到已落下方块，开始下一轮
-    addToBoard();
-    newRound();
+    lockFalling(g);
 }
 
+/* （内部函数）
+ * 函数名称：landingRow
+ * 函数原型：int landingRow(const tetBoard* board, const tetBlock* b)
+ * 功能描述：计算方块 b 从当前位置竖直落下后，中心格所在的纵坐标
+ * 副作用？：无
+ *
+ * 参数描述：方块堆 board :: const tetBoard*
+ *         下落方块 b :: const tetBlock*（须处于无碰撞的位置）
+ * 返回类型：int，落定时中心格的纵坐标
+ * --------------
+ * 使用方法：int y = landingRow(&yourGame->stored, &yourGame->falling);
+ */
+int landingRow(const tetBoard* board, const tetBlock* b)
+{
+    const tetShape* s = ShapeOf(*b);
+    int left = b->coord.x + s->minX;
+
+    // 落点由方块底部轮廓与各列高度决定：每一列的最低格都要落在该列高度之上
+    int i, land = -s->minY;
+    for (i = 0; i <= s->maxX - s->minX; ++i)
+        land = Max(land, board->heights[left + i] - s->bottom[i]);
+
+    // 方块在各列都位于堆顶之上，落点即为所求
+    if (land <= b->coord.y)
+        return land;
+
+    // 方块已钻入悬空部分之下，则逐行下落，直到发生碰撞
+    tetBlock probe = *b;
+    do {
+        probe.coord.y--;
+    } while (blockCheck(board, &probe) == FREEMOVE);
+
+    return probe.coord.y + 1;
+}
 
 /* （内部函数）
- * 函数名称：addToBoard
- * 函数原型：void addToBoard()
- * 功能描述：将正在下落的方块加入到已落下的方块堆中
- *        （在检测到碰撞或触底时使用）
- * 副作用？：改变全局变量stored
+ * 函数名称：lockFalling
+ * 函数原型：void lockFalling(tetGame* g)
+ * 功能描述：将正在下落的方块固定到方块堆中，
+ *          做消除检测、增加分数，并开启下一轮
+ * 副作用？：改变游戏 g 的方块堆、分数及游戏进程
  *
- * 参数描述：无
+ * 参数描述：游戏上下文 g :: tetGame*
  * 返回类型：无
  * --------------
- * 使用方法：addToBoard();
+ * 使用方法：lockFalling(yourGame);
+ */
+void lockFalling(tetGame* g)
+{
+    addToBoard(&g->stored, &g->falling);
+    addScore(g, eliminateLines(&g->stored));
+    newRound(g);
+}
+
+
+/*
+ * 函数名：addToBoard
+ * -------------
+ * 将方块 b 加入到方块堆 board 中，超出顶端的格子直接舍去
  */
-void addToBoard()
+void addToBoard(tetBoard* board, const tetBlock* b)
 {
-    int x = falling.coord.x;
-    int y = falling.coord.y;
+    const tetShape* s = ShapeOf(*b);
+    tetCoord cell = b->coord;
+    int y;
+    int low  = b->coord.y + s->minY;
+    int high = Min(b->coord.y + s->maxY, MaxCoordY);
 
-    // 将中心格加入堆中
-    stored[y][x].statu = CELL_TAKEN;
-    stored[y][x].color = falling.color;
+    // 方块所在各行的内容将改变，先从哈希值中去掉这些行
+    for (y = low; y <= high; ++y)
+        board->hash ^= rowKey(y, board->rows[y]);
+
+    // 将中心格加入堆中（超出顶端的格子不在方块堆内，直接舍去）
+    if (cell.y <= MaxCoordY)
+        TakeCell(board, cell, b->color);
 
     // 将3个周围格加入堆中
     int i;
     for (i = 0; i < 3; ++i)
     {
         // 切换到其中一个周围格上
-        ShiftCoord(falling.coord, falling.surround[i]);
-        x = falling.coord.x;
-        y = falling.coord.y;
+        ShiftCoord(cell, s->surround[i]);
         // 将该块加入到堆中
-        stored[y][x].statu = CELL_TAKEN;
-        stored[y][x].color = falling.color;
+        if (cell.y <= MaxCoordY)
+            TakeCell(board, cell, b->color);
         // 切换回中心格
-        UnshiftCoord(falling.coord, falling.surround[i]);
+        UnshiftCoord(cell, s->surround[i]);
     }
 
-    // 消除检测
-    eliminateLines();
+    // 再加入这些行的新内容
+    for (y = low; y <= high; ++y)
+        board->hash ^= rowKey(y, board->rows[y]);
 }
 
 /*
@@ -303,96 +393,116 @@ void addToBoard()
  *      LEFT_BOUND  - 与左边界碰撞
  *      RIGHT_BOUND - 与右边界碰撞
  */
-tetBoundStatu collisionCheck()
+tetBoundStatu collisionCheck(const tetGame* g)
 {
-    // 检测中心格
-    if (falling.coord.x < 0)
+    return blockCheck(&g->stored, &g->falling);
+}
+
+/*
+ * 函数名：blockCheck
+ * -------------
+ * 检测方块 b 与方块堆 board 及边界的碰撞情况，返回值同 collisionCheck
+ */
+tetBoundStatu blockCheck(const tetBoard* board, const tetBlock* b)
+{
+    const tetShape* s = ShapeOf(*b);
+    int x = b->coord.x;
+    int y = b->coord.y;
+
+    // 用包围盒做边界检测，边界检测优先于与堆的碰撞检测
+    if (x + s->minX < 0)
         return LEFT_BOUND;
-    else if (falling.coord.x > MaxCoordX)
+    else if (x + s->maxX > MaxCoordX)
         return RIGHT_BOUND;
-    else if (AlreadyTaken(falling.coord) || falling.coord.y < 0)
+    // 与界面底部碰撞
+    else if (y + s->minY < 0)
         return COLLIDED;
 
-    // 检测3个周围格
-    int i;
-    for (i = 0; i < 3; ++i)
+    // 逐行将形态表中的掩码平移到所在列，与方块堆做按位与
+    // 超出顶端的行不会碰撞
+    int i, row;
+    int top = Min(y + s->maxY, MaxCoordY);
+    for (i = 0, row = y + s->minY; row <= top; ++i, ++row)
     {
-        // 切换到其中一个周围格上
-        ShiftCoord(falling.coord, falling.surround[i]);
-
-        if (falling.coord.x < 0)
-        {
-            // 切换回中心格并返回
-            UnshiftCoord(falling.coord, falling.surround[i]);
-            return LEFT_BOUND;
-        }
-        else if (falling.coord.x > MaxCoordX)
-        {
-            UnshiftCoord(falling.coord, falling.surround[i]);
-            return RIGHT_BOUND;
-        }
-        else if (AlreadyTaken(falling.coord) || falling.coord.y < 0)
-        {
-            UnshiftCoord(falling.coord, falling.surround[i]);
+        if (board->rows[row] & (s->mask[i] << (x + s->minX)))
             return COLLIDED;
-        }
-
-        // 切换回中心格
-        UnshiftCoord(falling.coord, falling.surround[i]);
     }
     return FREEMOVE;
 }
 
-/* （内部函数）
- * 函数名称：eliminateLines
- * 函数原型：int eliminateLines()
- * 功能描述：消除检测，并作出处理
- * 副作用？：改变全局变量stored
- *
- * 参数描述：无
- * 返回类型：int，表示消除的行数
- * --------------
- * 使用方法：int eliminated = eliminateLines();
+/*
+ * 函数名：eliminateLines
+ * -------------
+ * 对方块堆 board 做消除检测并紧缩，返回消除的行数
  */
-int eliminateLines()
+int eliminateLines(tetBoard* board)
 {
-    int x, y;
+    int y;
     int eliminated = 0;
-    bool lineFilled;
-
-    // 从上到下按行扫描
-    // 相比从下到上，在消除多行时运算量更小
-    // 利用数组的行在内存中连续的特点
-    // 用指针减少索引的开销
-    tetBoard* curp;
-    for (y = MaxCoordY; y >= 0; --y)
-    {
-        lineFilled = true;
-        curp = &stored[y][0]; // 指向当前行开头
-        for (x = 0; x <= MaxCoordX; ++x)
-        {
-            if (curp->statu == CELL_EMPTY)
-            {
-                lineFilled = false;
-                break;
-            }
-            curp++; // 指向下一个方格
-        }
+    int top = -1;             // 最高的非空行
+    unsigned long full = 0;   // 满行位图，第 y 位为1代表第 y 行已满
 
-        // 当前行已满，则消除
-        if (lineFilled == true)
+    // 第一遍：利用位棋盘，一行是否已满只需一次比较
+    // 同时记录最高的非空行，其上的空行无需搬动
+    for (y = 0; y <= MaxCoordY; ++y)
+    {
+        if (board->rows[y] == FullRow)
         {
-            int yy;
-            for (yy = y; yy < MaxCoordY; ++yy)
-            {
-                memcpy(&stored[yy][0], &stored[yy+1][0], sizeof(stored[0]));
-            }
+            full |= 1UL << y;
             eliminated++;
         }
+        if (board->rows[y] != 0)
+            top = y;
+    }
+
+    // 没有满行，方块堆不变
+    if (eliminated == 0)
+        return 0;
+
+    // 第二遍：从最低的满行开始自下而上紧缩
+    // 每个未满的行至多搬动一次，消除多行与消除一行的开销相同
+    int dst = 0;
+    while (!(full >> dst & 1))
+        dst++;
+
+    // 最低的满行及其上方的行都会改变，先从哈希值中去掉
+    int low = dst;
+    for (y = low; y <= top; ++y)
+        board->hash ^= rowKey(y, board->rows[y]);
+
+    for (y = dst + 1; y <= top; ++y)
+    {
+        if (full >> y & 1)
+            continue;
+        board->rows[dst] = board->rows[y];
+        memcpy(board->color[dst], board->color[y], sizeof(board->color[0]));
+        dst++;
+    }
+
+    // 紧缩后空出的行补为空行
+    for (y = dst; y <= top; ++y)
+    {
+        board->rows[y] = 0;
+        memset(board->color[y], 0, sizeof(board->color[0]));
+    }
+
+    // 再加入紧缩后的内容（空行的键值为0，无需处理）
+    for (y = low; y < dst; ++y)
+        board->hash ^= rowKey(y, board->rows[y]);
+
+    // 更新各列高度：原最高格下方每消除一行，高度减1；
+    // 若原最高格本身被消除，则继续向下找到新的最高格
+    int x, h;
+    for (x = 0; x <= MaxCoordX; ++x)
+    {
+        h = board->heights[x];
+        h -= __builtin_popcountl(full & ((1UL << h) - 1));
+        while (h > 0 && !CellTaken(*board, x, h - 1))
+            h--;
+        board->heights[x] = h;
     }
 
-    // 分数增加
-    addScore(eliminated);
+    return eliminated;
 }
 
 /*
@@ -423,4 +533,37 @@ void moveToNextBox(tetBlock* b)
 void moveToHoldBox(tetBlock* b)
 {
     SetCoord(b->coord, HoldBlockX, HoldBlockY);
-}
\ No newline at end of file
+}
+
+/*
+ * 函数名：boardHash
+ * -------------
+ * 由占用位平面重新计算方块堆的 Zobrist 哈希值
+ */
+uint64_t boardHash(const tetBoard* board)
+{
+    uint64_t hash = 0;
+    int y;
+    for (y = 0; y <= MaxCoordY; ++y)
+        hash ^= rowKey(y, board->rows[y]);
+    return hash;
+}
+
+/* （内部函数）
+ * 函数名：rowKey
+ * -------------
+ * 第 y 行内容为 row 时的 Zobrist 键值，方块堆的哈希值即各行键值的异或
+ * 键值不预先存表，而是由 (y, row) 经 splitmix64 的混合函数算出，
+ * 这样不必初始化，且每一行的改变只需异或两次
+ * 空行的键值为0，因此空方块堆的哈希值为0
+ */
+uint64_t rowKey(int y, tetRow row)
+{
+    if (row == 0)
+        return 0;
+
+    uint64_t z = ((uint64_t)y << 16 | row) + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
@@ -16,11 +16,23 @@
             drop
  *      碰撞检测函数：
             collisionCheck
+ *      方块堆上的操作（不依赖游戏上下文，供搜索使用）：
+            blockCheck
+            rotateBlock
+            slideBlock
+            addToBoard
+            eliminateLines
+            boardHash
  */
 
 #ifndef TETRIS_H
 #define TETRIS_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "layout.h" // 需要取得方块堆大小
+
 
 /* 第一部分 -- 坐标操作相关宏定义 */
 
@@ -69,12 +81,6 @@ typedef enum {
 } tetMove;
 
 
-// 游戏主界面格子的两种可能状态，为空或者被占用
-typedef enum {
-  CELL_EMPTY, CELL_TAKEN
-} tetCellStatu;
-
-
 /* 碰撞检测结果定义
  *      FREEMOVE    - 未碰撞
  *      COLLIDED    - 与堆中方块或界面底部碰撞
@@ -94,39 +100,88 @@ typedef struct {
 } tetCoord;
 
 
+// 方块堆中的一行，用一个16位掩码表示，第 x 位为1代表第 x 列已被占用
+typedef unsigned short tetRow;
+
+// 一行被填满时的掩码，即低 MaxCoordX+1 位全为1
+#define FullRow ((tetRow)((1 << (MaxCoordX+1)) - 1))
+
+
+/* 方块形态定义
+ * 有关方块的形态，定义一个中心格和三个周围格
+ * 中心格坐标由方块结构储存，周围格储存相对中心格的坐标
+ *
+ * 7种方块 × 4个方向的形态在编译期即列成一张表（见 tetris.c 中的 shapeTable），
+ * 每一项除周围格外，还附带包围盒与各行掩码，供碰撞检测直接使用：
+ *      surround    - 3个周围格相对中心格的坐标
+ *      minX ~ maxX - 包围盒的列范围（相对中心格）
+ *      minY ~ maxY - 包围盒的行范围（相对中心格）
+ *      mask        - 自包围盒最低行起的各行掩码，包围盒最左列对应第0位
+ *      bottom      - 自包围盒最左列起，各列最低格的纵坐标（相对中心格），用于直接落底
+ *
+ * 有关方块结构的图文说明以及初始状态的约定，详见程序报告及用户手册，或：
+ * https://www.processon.com/view/link/5cdf7a55e4b005286487410e
+ */
+typedef struct {
+  tetCoord surround[3];
+  int      minX, maxX;
+  int      minY, maxY;
+  tetRow   mask[4];
+  int      bottom[4];
+} tetShape;
+
+// 方块形态表，下标依次为方块类型、方向序号
+extern const tetShape shapeTable[typeNum][4];
+
+// 取得方块 b 当前的形态
+#define ShapeOf(b) (&shapeTable[(b).type][(b).orient])
+
+
 /* 方块结构定义
- * 有关方块的结构，定义一个中心格和三个周围格
- * 中心格储存绝对坐标，周围格储存相对中心格的坐标
+ * 该结构中包含信息：方块类型、颜色、方向序号、中心坐标
  *
  * 这样定义的好处：
  * 一、节省空间；
  * 二、通用性好，所有方块可用一种结构表达；
- * 三、操作方便，无需考虑当前方向，移动只需改变中心格坐标，旋转只需做一个复数乘法
- *
- * 有关方块结构的图文说明以及初始状态的约定，详见程序报告及用户手册，或：
- * https://www.processon.com/view/link/5cdf7a55e4b005286487410e
+ * 三、操作方便，移动只需改变中心格坐标，旋转只需改变方向序号
  *
- * 该结构中包含信息：方块类型、颜色、中心坐标、3个周围格
- * 3个周围格只需储存相对坐标，不需要类型、颜色等信息
+ * 方向序号取值 0 ~ 3，初始状态为0，每顺时针旋转一次加1
  */
 typedef struct {
   tetType  type;
   tetColor color;
+  int      orient;
   tetCoord coord;
-  tetCoord surround[3];
 } tetBlock;
 
 
-// 已落下的方块堆定义
-// 包含信息：当前格是否为空、当前格颜色
+/* 已落下的方块堆定义（位棋盘）
+ * 占用情况与颜色分开存放：
+ *      rows    - 占用位平面，每行一个掩码，放置检测只需对行掩码做几次按位与
+ *      color   - 颜色平面，只在绘制及存档时用到，不参与碰撞检测
+ *      heights - 各列高度，即该列最高的被占用格纵坐标加1（空列为0）
+ *                随方块落定及消除同步维护，直接落底时据此算出落点
+ *      hash    - 占用情况的 Zobrist 哈希值（不含颜色），空方块堆为0
+ *                由 addToBoard、eliminateLines 增量维护，供搜索识别重复的局面
+ */
 typedef struct {
-  tetCellStatu statu;
-  tetColor color;
+  tetRow        rows[MaxCoordY+1];
+  unsigned char color[MaxCoordY+1][MaxCoordX+1];
+  unsigned char heights[MaxCoordX+1];
+  uint64_t      hash;
 } tetBoard;
 
+// 检测方块堆 b 中坐标 (x, y) 处的格子是否被占用
+#define CellTaken(b, x, y) (((b).rows[y] >> (x)) & 1)
+
 
 
-/* 第二部分 -- 外部接口函数定义 */
+// 游戏上下文，定义见 flow.h
+typedef struct tetGame tetGame;
+
+
+
+/* 第三部分 -- 外部接口函数定义 */
 
 /*
  * 函数名称：initBlock
@@ -144,68 +199,69 @@ void initBlock(tetBlock* b);
 
 /*
  * 函数名称：geneNext
- * 函数原型：void geneNext()
- * 功能描述：随机生成下一个方块，并将其移动到显示下一个方块的方框内
- * 副作用？：改变全局变量nextBlock
+ * 函数原型：void geneNext(tetGame* g)
+ * 功能描述：由游戏 g 的方块序列生成器产生下一个方块，并将其移动到显示下一个方块的方框内
+ * 副作用？：改变游戏 g 中的 nextBlock
  *
- * 参数描述：无
+ * 参数描述：游戏上下文 g :: tetGame*
  * 返回类型：无
  * --------------
- * 使用方法：geneNext();
+ * 使用方法：geneNext(yourGame);
  */
-void geneNext();
+void geneNext(tetGame* g);
 
 
 /*
  * 函数名称：rotate
- * 函数原型：void rotate()
+ * 函数原型：void rotate(tetGame* g)
  * 功能描述：顺时针旋转正在下落的方块
- * 副作用？：改变全局变量falling
+ * 副作用？：改变游戏 g 中的 falling
  *
- * 参数描述：无
+ * 参数描述：游戏上下文 g :: tetGame*
  * 返回类型：无
  * --------------
- * 使用方法：geneNext();
+ * 使用方法：rotate(yourGame);
  */
-void rotate();
+void rotate(tetGame* g);
 
 
 /*
  * 函数名称：move
- * 函数原型：void move(tetMove direction)
+ * 函数原型：void move(tetGame* g, tetMove direction)
  * 功能描述：移动正在下落的方块（左、右、下）
- * 副作用？：改变全局变量falling
+ * 副作用？：改变游戏 g 中的 falling；向下移动触底时开启下一轮
  *
- * 参数描述：方块移动方向 direction :: tetMove
+ * 参数描述：游戏上下文 g :: tetGame*
+ *         方块移动方向 direction :: tetMove
  *        （枚举类型tetMove定义见本文件）
  * 返回类型：无
  * --------------
- * 使用方法：move(TM_LEFT | TM_RIGHT | TM_DOWN);
+ * 使用方法：move(yourGame, TM_LEFT | TM_RIGHT | TM_DOWN);
  */
-void move(tetMove direction);
+void move(tetGame* g, tetMove direction);
 
 
 /*
  * 函数名称：drop
- * 函数原型：void drop()
+ * 函数原型：void drop(tetGame* g)
  * 功能描述：将正在下落的方块直接降落到底部，并开启下一轮
- * 副作用？：直接改变全局变量falling；加快当前游戏进程
+ * 副作用？：直接改变游戏 g 中的 falling；加快当前游戏进程
  *
- * 参数描述：无
+ * 参数描述：游戏上下文 g :: tetGame*
  * 返回类型：无
  * --------------
- * 使用方法：drop();
+ * 使用方法：drop(yourGame);
  */
-void drop();
+void drop(tetGame* g);
 
 
 /*
  * 函数名称：collisionCheck
- * 函数原型：tetBoundStatu collisionCheck()
- * 功能描述：对正在下落的方块进行碰撞检测
+ * 函数原型：tetBoundStatu collisionCheck(const tetGame* g)
+ * 功能描述：对游戏 g 中正在下落的方块进行碰撞检测
  * 副作用？：无
  *
- * 参数描述：无
+ * 参数描述：游戏上下文 g :: const tetGame*
  * 返回类型：tetBoundStatu，表示方块碰撞检测结果
  *        （枚举类型tetBoundStatu定义见本文件）
  * 可能取值：
@@ -216,9 +272,102 @@ void drop();
  * 注：在多种状态同时成立时，比如，同时与方块堆和左边界碰撞
  *    优先返回左右边界值
  * --------------
- * 使用方法：tetBoundStatu bs = collisionCheck();
+ * 使用方法：tetBoundStatu bs = collisionCheck(yourGame);
+ */
+tetBoundStatu collisionCheck(const tetGame* g);
+
+
+/*
+ * 函数名称：blockCheck
+ * 函数原型：tetBoundStatu blockCheck(const tetBoard* board, const tetBlock* b)
+ * 功能描述：检测任意方块 b 与方块堆 board 及边界的碰撞情况
+ * 副作用？：无
+ *
+ * 参数描述：方块堆 board :: const tetBoard*
+ *         待检测方块 b :: const tetBlock*
+ * 返回类型：tetBoundStatu，取值同 collisionCheck
+ * --------------
+ * 使用方法：tetBoundStatu bs = blockCheck(&yourBoard, &yourBlock);
+ */
+tetBoundStatu blockCheck(const tetBoard* board, const tetBlock* b);
+
+
+/*
+ * 函数名称：rotateBlock
+ * 函数原型：bool rotateBlock(const tetBoard* board, tetBlock* b)
+ * 功能描述：在方块堆 board 中顺时针旋转任意方块 b，规则与 rotate 完全相同：
+ *          越过左右边界时平移回边界内，仍有碰撞则保持原状
+ * 副作用？：改变传入的方块
+ *
+ * 参数描述：方块堆 board :: const tetBoard*
+ *         待旋转方块 b :: tetBlock*（须处于无碰撞的位置）
+ * 返回类型：bool，true 代表旋转成功，false 代表方块未改变
+ * --------------
+ * 使用方法：if (rotateBlock(&yourBoard, &yourBlock)) ...
+ */
+bool rotateBlock(const tetBoard* board, tetBlock* b);
+
+
+/*
+ * 函数名称：slideBlock
+ * 函数原型：int slideBlock(const tetBoard* board, tetBlock* b, tetMove direction)
+ * 功能描述：将方块 b 向左或向右一直平移，直到再移一格就会碰撞（边界或方块堆）
+ *          结果与反复 move 相同，但由各行的占用掩码一次求出最终所在列
+ * 副作用？：改变传入的方块
+ *
+ * 参数描述：方块堆 board :: const tetBoard*
+ *         待平移方块 b :: tetBlock*（须处于无碰撞的位置）
+ *         方向 direction :: tetMove（TM_LEFT 或 TM_RIGHT）
+ * 返回类型：int，平移的格数
+ * --------------
+ * 使用方法：slideBlock(&yourGame->stored, &yourGame->falling, TM_LEFT);
+ */
+int slideBlock(const tetBoard* board, tetBlock* b, tetMove direction);
+
+
+/*
+ * 函数名称：addToBoard
+ * 函数原型：void addToBoard(tetBoard* board, const tetBlock* b)
+ * 功能描述：将方块 b 加入到方块堆 board 中（在检测到碰撞或触底时使用），
+ *          同时更新各列高度；超出顶端的格子不在方块堆内，直接舍去
+ * 副作用？：改变传入的方块堆
+ *
+ * 参数描述：方块堆 board :: tetBoard*
+ *         待加入方块 b :: const tetBlock*
+ * 返回类型：无
+ * --------------
+ * 使用方法：addToBoard(&yourGame->stored, &yourGame->falling);
+ */
+void addToBoard(tetBoard* board, const tetBlock* b);
+
+
+/*
+ * 函数名称：eliminateLines
+ * 函数原型：int eliminateLines(tetBoard* board)
+ * 功能描述：对方块堆 board 做消除检测，消去所有满行并将其上的行下移
+ * 副作用？：改变传入的方块堆
+ *
+ * 参数描述：方块堆 board :: tetBoard*
+ * 返回类型：int，表示消除的行数
+ * --------------
+ * 使用方法：int eliminated = eliminateLines(&yourGame->stored);
+ */
+int eliminateLines(tetBoard* board);
+
+
+/*
+ * 函数名称：boardHash
+ * 函数原型：uint64_t boardHash(const tetBoard* board)
+ * 功能描述：由占用位平面重新计算方块堆的 Zobrist 哈希值
+ *          方块堆由其他途径（如读档）得到时，用它设置 hash
+ * 副作用？：无
+ *
+ * 参数描述：方块堆 board :: const tetBoard*
+ * 返回类型：uint64_t，哈希值
+ * --------------
+ * 使用方法：yourBoard.hash = boardHash(&yourBoard);
  */
-tetBoundStatu collisionCheck();
+uint64_t boardHash(const tetBoard* board);
 
 
 /*
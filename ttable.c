@@ -0,0 +1,123 @@
+/*
+ * 项目：Tetris
+ * 文件名：ttable.c
+ * 概览：置换表模块
+ * -------------
+ * 负责功能：
+ *      置换表的创建、清空与释放
+ *      无锁的查找与保存
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ttable.h"  // 本模块
+
+/* 键值在存入前先与此常数异或
+ * 空方块堆的哈希值为0，不这样做的话，全为0的空项会被当作它的有效项
+ */
+#define KeySalt 0x5851F42D4C957F2DULL
+
+
+/* 置换表中的一项
+ *      check - 键值与 data 的异或
+ *      data  - 数据，即 double 的各个二进制位
+ * 读写都不加锁，用 volatile 保证每次都真正访问内存
+ */
+typedef struct {
+  volatile uint64_t check;
+  volatile uint64_t data;
+} tetTTEntry;
+
+
+/* 置换表
+ *      mask  - 项数减1，键值的低位与之按位与即得到位置
+ *      entry - 各项
+ */
+struct tetTTable {
+  uint64_t    mask;
+  tetTTEntry* entry;
+};
+
+
+/*
+ * 函数名：createTTable
+ * -------------
+ * 申请 2^bits 项并清零
+ */
+tetTTable* createTTable(int bits)
+{
+    if (bits < 1 || bits > 30)
+        return NULL;
+
+    tetTTable* t = malloc(sizeof(tetTTable));
+    if (t == NULL)
+        return NULL;
+
+    t->mask  = ((uint64_t)1 << bits) - 1;
+    t->entry = calloc((size_t)t->mask + 1, sizeof(tetTTEntry));
+    if (t->entry == NULL)
+    {
+        free(t);
+        return NULL;
+    }
+    return t;
+}
+
+/*
+ * 函数名：destroyTTable
+ * -------------
+ * 释放置换表
+ */
+void destroyTTable(tetTTable* t)
+{
+    if (t == NULL)
+        return;
+    free(t->entry);
+    free(t);
+}
+
+/*
+ * 函数名：clearTTable
+ * -------------
+ * 清空所有项
+ */
+void clearTTable(tetTTable* t)
+{
+    memset((void*)t->entry, 0, ((size_t)t->mask + 1) * sizeof(tetTTEntry));
+}
+
+/*
+ * 函数名：ttProbe
+ * -------------
+ * 读出同一位置上的项，两半异或后与键值相符才算命中
+ */
+bool ttProbe(const tetTTable* t, uint64_t key, double* value)
+{
+    key ^= KeySalt;
+    const tetTTEntry* e = &t->entry[key & t->mask];
+    uint64_t data  = e->data;
+    uint64_t check = e->check;
+
+    if ((check ^ data) != key)
+        return false;
+
+    memcpy(value, &data, sizeof(double));
+    return true;
+}
+
+/*
+ * 函数名：ttStore
+ * -------------
+ * 写入数据及其与键值的异或，覆盖同一位置上的旧项
+ */
+void ttStore(tetTTable* t, uint64_t key, double value)
+{
+    uint64_t data;
+    memcpy(&data, &value, sizeof(double));
+
+    key ^= KeySalt;
+    tetTTEntry* e = &t->entry[key & t->mask];
+    e->check = key ^ data;
+    e->data  = data;
+}
@@ -0,0 +1,93 @@
+/*
+ * 项目：Tetris
+ * 文件名：ttable.h
+ * 概览：置换表模块
+ * -------------
+ * 主要内容：
+ *      以方块堆的 Zobrist 哈希值为键、保存局面评估值的定长置换表
+ *
+ * 搜索中经不同的放置顺序常会得到相同的方块堆，查表即可避免重复评估
+ * 表的大小固定，新项直接覆盖同一位置上的旧项；
+ * 多个线程可以同时读写且不加锁：每项保存“键值异或数据”及数据本身，
+ * 读出时两者异或还原出键值，若被其他线程写了一半则对不上，视为未命中
+ *
+ * 外部接口：
+ *      createTTable
+ *      destroyTTable
+ *      clearTTable
+ *      ttProbe
+ *      ttStore
+ */
+
+#ifndef TTABLE_H
+#define TTABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 置换表，定义见 ttable.c
+typedef struct tetTTable tetTTable;
+
+
+/*
+ * 函数名称：createTTable
+ * 函数原型：tetTTable* createTTable(int bits)
+ * 功能描述：创建有 2^bits 项的空置换表（每项16字节）
+ * 副作用？：申请内存
+ *
+ * 参数描述：表大小的对数 bits :: int（1 ~ 30）
+ * 返回类型：tetTTable*，失败时为 NULL
+ * --------------
+ * 使用方法：tetTTable* table = createTTable(16);
+ */
+tetTTable* createTTable(int bits);
+
+
+/*
+ * 函数名称：destroyTTable / clearTTable
+ * 函数原型：void destroyTTable(tetTTable* t)
+ *          void clearTTable(tetTTable* t)
+ * 功能描述：释放置换表 / 清空置换表（如评估的权重改变时）
+ * 副作用？：释放内存 / 改变置换表
+ *
+ * 参数描述：置换表 t :: tetTTable*（destroyTTable 可传入 NULL）
+ * 返回类型：无
+ * --------------
+ * 使用方法：clearTTable(table);
+ */
+void destroyTTable(tetTTable* t);
+void clearTTable(tetTTable* t);
+
+
+/*
+ * 函数名称：ttProbe
+ * 函数原型：bool ttProbe(const tetTTable* t, uint64_t key, double* value)
+ * 功能描述：查找键值为 key 的项
+ * 副作用？：命中时改变 value
+ *
+ * 参数描述：置换表 t :: const tetTTable*
+ *         键值 key :: uint64_t
+ *         查到的值 value :: double*
+ * 返回类型：bool，true 代表命中
+ * --------------
+ * 使用方法：if (!ttProbe(table, board.hash, &v)) { v = ...; ttStore(table, board.hash, v); }
+ */
+bool ttProbe(const tetTTable* t, uint64_t key, double* value);
+
+
+/*
+ * 函数名称：ttStore
+ * 函数原型：void ttStore(tetTTable* t, uint64_t key, double value)
+ * 功能描述：保存键值为 key 的项，覆盖同一位置上的旧项
+ * 副作用？：改变置换表
+ *
+ * 参数描述：置换表 t :: tetTTable*
+ *         键值 key :: uint64_t
+ *         值 value :: double
+ * 返回类型：无
+ * --------------
+ * 使用方法：ttStore(table, board.hash, v);
+ */
+void ttStore(tetTTable* t, uint64_t key, double value);
+
+#endif
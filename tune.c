@@ -0,0 +1,534 @@
+/*
+ * 项目：Tetris
+ * 文件名：tune.c
+ * 概览：电脑玩家权重调优程序 tetris-tune
+ * -------------
+ * 负责功能：
+ *      以进化策略调整电脑玩家（ai.h）局面评估的权重：
+ *      每一代在当前均值附近按各维的步长随机取若干组权重，
+ *      每组权重进行若干局无界面游戏，以平均消除行数为适应度，
+ *      再由适应度最高的一半加权重组出新的均值与步长
+ *      每代结束后写入检查点文件，中断后可以由此续跑
+ *
+ * 用法：tetris-tune [-g 代数] [-P 种群大小] [-n 局数] [-p 每局方块上限] [-s 种子] [-b]
+ *                   [-w 束宽] [-d 深度] [-t 线程数] [-k 每批局数] [-c 检查点文件] [-r]
+ *      -g  共进行的代数（续跑时包括已完成的代数），默认 50
+ *      -P  每代的权重组数，默认 32
+ *      -n  每组权重进行的局数，默认 64
+ *      -p  每局最多落下的方块数，默认 500
+ *      -s  随机种子，决定每代的取样及各局的方块序列，默认 1
+ *      -b  使用 7-bag 方块序列，默认为均匀随机
+ *      -w  电脑玩家的束宽，默认 1
+ *      -d  电脑玩家的搜索深度，默认 1
+ *      -t  线程数，0 代表逻辑处理器个数，默认 0
+ *      -k  每个任务连续进行的局数，默认 8
+ *      -c  检查点文件，默认 tune.ckpt
+ *      -r  由检查点文件续跑，此时沿用其中的设置（-g、-t、-k、-c 除外）
+ *
+ * 同一代中各组权重使用相同的方块序列，比较的只是权重本身的优劣
+ * 权重只有相对大小有意义（评估值同乘一个正数不改变决定），每组权重都缩放为单位长度
+ *
+ * 对局按“一组权重的连续若干局”分批交给线程池（pool.h），每个任务只写自己的结果，
+ * 任务之间没有共享的可写数据；汇总在整代完成后按下标进行，结果与线程数无关
+ * 只依赖核心库（libtetris_core.a）
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "flow.h"     // 需要游戏上下文
+#include "rng.h"      // 需要随机取样
+#include "platform.h" // 需要计时及替换文件
+#include "ai.h"       // 需要电脑玩家
+#include "pool.h"     // 需要线程池
+
+#define Min(x,y) ((x)<(y) ? (x):(y))
+#define Max(x,y) ((x)>(y) ? (x):(y))
+
+// 种群大小上限
+#define MaxPopulation 1024
+
+// 步长的下限，避免过早收敛到一点
+#define MinSigma 0.002
+
+// 步长向本代精英的分布靠拢的速率
+#define SigmaRate 0.5
+
+// 检查点文件的标识及版本
+#define CheckpointTag     "tetris-tune"
+#define CheckpointVersion 1
+
+
+/* 调优设置，续跑时由检查点读出
+ *      population - 每代的权重组数
+ *      games      - 每组权重进行的局数
+ *      maxPieces  - 每局最多落下的方块数
+ *      seed       - 随机种子
+ *      mode       - 方块序列生成模式
+ *      beamWidth  - 电脑玩家的束宽
+ *      depth      - 电脑玩家的搜索深度
+ */
+typedef struct {
+  int         population;
+  int         games;
+  int         maxPieces;
+  uint64_t    seed;
+  tetRandMode mode;
+  int         beamWidth;
+  int         depth;
+} tetTuneConfig;
+
+
+/* 调优状态，每代结束后写入检查点
+ *      generation  - 已完成的代数
+ *      mean        - 权重的均值
+ *      sigma       - 各维的步长
+ *      best        - 迄今适应度最高的一组权重
+ *      bestFitness - 其适应度
+ */
+typedef struct {
+  int    generation;
+  double mean[featNum];
+  double sigma[featNum];
+  double best[featNum];
+  double bestFitness;
+} tetTuneState;
+
+
+/* 一批对局：用同一组权重连续进行若干局
+ *      ai        - 电脑玩家，不使用线程池与置换表
+ *      member    - 所属的权重组
+ *      seed      - 第一局的种子，第 i 局用 seed+i
+ *      games     - 局数
+ *      maxPieces - 每局最多落下的方块数
+ *      mode      - 方块序列生成模式
+ *      lines     - 各局消除行数之和（输出）
+ *      pieces    - 各局落下方块数之和（输出）
+ */
+typedef struct {
+  tetAI       ai;
+  int         member;
+  uint64_t    seed;
+  int         games;
+  int         maxPieces;
+  tetRandMode mode;
+  long long   lines;
+  long long   pieces;
+} tetBatch;
+
+
+// 内部函数声明
+void   normalize(double w[featNum]);
+double gaussian(tetRng* r);
+void   runBatch(void* arg);
+void   sample(const tetTuneConfig* c, const tetTuneState* s, double (*w)[featNum]);
+void   update(const tetTuneConfig* c, tetTuneState* s, double (*w)[featNum], const double* fitness);
+bool   saveCheckpoint(const char* path, const tetTuneConfig* c, const tetTuneState* s);
+bool   loadCheckpoint(const char* path, tetTuneConfig* c, tetTuneState* s);
+bool   readVector(FILE* fp, const char* label, double w[featNum]);
+void   printWeights(const char* label, const double w[featNum]);
+
+
+int main(int argc, char* argv[])
+{
+    tetTuneConfig config = { 32, 64, 500, 1, RAND_UNIFORM, 1, 1 };
+    tetTuneState  state;
+    int generations = 50;
+    int threads     = 0;
+    int perBatch    = 8;
+    bool resume     = false;
+    const char* path = "tune.ckpt";
+    tetAI ai;
+    int i, k;
+
+    // 解析命令行参数
+    for (i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+            generations = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc)
+            config.population = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            config.games = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+            config.maxPieces = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            config.seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-b") == 0)
+            config.mode = RAND_BAG;
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+            config.beamWidth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+            config.depth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+            perBatch = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+            path = argv[++i];
+        else if (strcmp(argv[i], "-r") == 0)
+            resume = true;
+        else
+        {
+            fprintf(stderr, "usage: %s [-g generations] [-P population] [-n games] [-p pieces] [-s seed] [-b]\n"
+                            "       [-w width] [-d depth] [-t threads] [-k games-per-batch] [-c checkpoint] [-r]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (resume)
+    {
+        if (!loadCheckpoint(path, &config, &state))
+        {
+            fprintf(stderr, "cannot resume from %s\n", path);
+            return 1;
+        }
+        printf("resumed from %s at generation %d\n", path, state.generation);
+    }
+    else
+    {
+        // 由默认权重出发
+        initAI(&ai);
+        memset(&state, 0, sizeof(state));
+        memcpy(state.mean, ai.weight, sizeof(state.mean));
+        normalize(state.mean);
+        memcpy(state.best, state.mean, sizeof(state.best));
+        for (k = 0; k < featNum; ++k)
+            state.sigma[k] = 0.2;
+        state.bestFitness = -1;
+    }
+
+    if (config.population < 2 || config.population > MaxPopulation
+        || config.games <= 0 || config.maxPieces <= 0 || perBatch <= 0)
+    {
+        fprintf(stderr, "population must be 2 ~ %d; games, pieces and games-per-batch must be positive\n",
+                MaxPopulation);
+        return 1;
+    }
+
+    // 每组权重的对局分成若干批，最后一批可能不满
+    int batchesPer = (config.games + perBatch - 1) / perBatch;
+    int batches    = config.population * batchesPer;
+
+    double (*weight)[featNum] = malloc(config.population * sizeof(*weight));
+    double* fitness = malloc(config.population * sizeof(double));
+    tetBatch* batch = malloc(batches * sizeof(tetBatch));
+    tetPool* pool   = createPool(threads);
+    if (weight == NULL || fitness == NULL || batch == NULL || pool == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    printf("threads      %d\n", poolThreads(pool));
+    printf("games/gen    %d\n", config.population * config.games);
+
+    while (state.generation < generations)
+    {
+        double begin = platNow();
+        sample(&config, &state, weight);
+
+        // 同一代的各组权重使用相同的种子序列
+        uint64_t seed = config.seed + (uint64_t)state.generation * config.games;
+        for (i = 0; i < batches; ++i)
+        {
+            tetBatch* b = &batch[i];
+            int m     = i / batchesPer;
+            int first = i % batchesPer * perBatch;
+
+            initAI(&b->ai);
+            memcpy(b->ai.weight, weight[m], sizeof(b->ai.weight));
+            b->ai.beamWidth = config.beamWidth;
+            b->ai.depth     = config.depth;
+            b->member    = m;
+            b->seed      = seed + first;
+            b->games     = Min(perBatch, config.games - first);
+            b->maxPieces = config.maxPieces;
+            b->mode      = config.mode;
+        }
+
+        poolRun(pool, runBatch, batch, sizeof(tetBatch), batches);
+
+        // 按下标汇总各批结果
+        long long pieces = 0;
+        for (i = 0; i < config.population; ++i)
+            fitness[i] = 0;
+        for (i = 0; i < batches; ++i)
+        {
+            fitness[batch[i].member] += batch[i].lines;
+            pieces += batch[i].pieces;
+        }
+        for (i = 0; i < config.population; ++i)
+            fitness[i] /= config.games;
+
+        update(&config, &state, weight, fitness);
+        double elapsed = platNow() - begin;
+        if (elapsed <= 0)
+            elapsed = 1e-9;
+
+        printf("gen %4d  mean-fitness %9.2f  best %9.2f  %8.0f pieces/s  %.1f s\n",
+               state.generation, fitness[0], state.bestFitness, pieces / elapsed, elapsed);
+        printWeights("mean", state.mean);
+
+        if (!saveCheckpoint(path, &config, &state))
+            fprintf(stderr, "cannot write checkpoint %s\n", path);
+    }
+
+    printWeights("best", state.best);
+
+    destroyPool(pool);
+    free(weight);
+    free(fitness);
+    free(batch);
+    return 0;
+}
+
+/* （内部函数）
+ * 函数名：normalize
+ * -------------
+ * 将权重缩放为单位长度，全为0时不变
+ */
+void normalize(double w[featNum])
+{
+    double len = 0;
+    int k;
+    for (k = 0; k < featNum; ++k)
+        len += w[k] * w[k];
+    if (len <= 0)
+        return;
+
+    len = sqrt(len);
+    for (k = 0; k < featNum; ++k)
+        w[k] /= len;
+}
+
+/* （内部函数）
+ * 函数名：gaussian
+ * -------------
+ * 以 Box-Muller 方法取一个标准正态分布的随机数
+ */
+double gaussian(tetRng* r)
+{
+    double u = (nextRand(r) + 1.0) / 4294967297.0;
+    double v = nextRand(r) / 4294967296.0;
+    return sqrt(-2 * log(u)) * cos(2 * 3.14159265358979323846 * v);
+}
+
+/* （内部函数）
+ * 函数名：runBatch
+ * -------------
+ * 线程池任务：用同一组权重连续进行若干局，累计消除行数及落下方块数
+ * 游戏上下文在本任务的栈上，不与其他任务共享
+ */
+void runBatch(void* arg)
+{
+    tetBatch* b = arg;
+    tetGame g;
+    int i, n;
+
+    b->lines  = 0;
+    b->pieces = 0;
+    for (i = 0; i < b->games; ++i)
+    {
+        initGame(&g, b->seed + i, b->mode);
+        for (n = 0; n < b->maxPieces && !g.over; ++n)
+            aiPlay(&b->ai, &g);
+
+        b->lines  += getLines(&g);
+        b->pieces += n;
+    }
+}
+
+/* （内部函数）
+ * 函数名：sample
+ * -------------
+ * 取本代的各组权重：第0组为均值本身，其余在均值附近按各维步长取正态分布
+ * 发生器由种子与代数决定，续跑时取到的权重与不中断时相同
+ */
+void sample(const tetTuneConfig* c, const tetTuneState* s, double (*w)[featNum])
+{
+    tetRng r;
+    int i, k;
+
+    seedRng(&r, c->seed ^ ((uint64_t)(s->generation + 1) * 0x9E3779B97F4A7C15ULL));
+
+    memcpy(w[0], s->mean, sizeof(w[0]));
+    for (i = 1; i < c->population; ++i)
+    {
+        for (k = 0; k < featNum; ++k)
+            w[i][k] = s->mean[k] + s->sigma[k] * gaussian(&r);
+        normalize(w[i]);
+    }
+}
+
+/* （内部函数）
+ * 函数名：update
+ * -------------
+ * 按适应度由高到低排出前一半（相同时下标小者在前），以对数递减的权数：
+ *      新均值为这些权重的加权平均
+ *      新步长向它们相对旧均值的加权标准差靠拢
+ * 同时记录迄今最好的一组权重，并将代数加1
+ */
+void update(const tetTuneConfig* c, tetTuneState* s, double (*w)[featNum], const double* fitness)
+{
+    int order[MaxPopulation];
+    int mu = c->population / 2;
+    int i, j, k;
+
+    // 插入排序，种群不大
+    for (i = 0; i < c->population; ++i)
+    {
+        for (j = i; j > 0 && fitness[order[j - 1]] < fitness[i]; --j)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+
+    if (fitness[order[0]] > s->bestFitness)
+    {
+        s->bestFitness = fitness[order[0]];
+        memcpy(s->best, w[order[0]], sizeof(s->best));
+    }
+
+    double mean[featNum] = { 0 };
+    double var[featNum]  = { 0 };
+    double total = 0;
+    for (i = 0; i < mu; ++i)
+        total += log(mu + 0.5) - log(i + 1);
+
+    for (i = 0; i < mu; ++i)
+    {
+        double rw = (log(mu + 0.5) - log(i + 1)) / total;
+        for (k = 0; k < featNum; ++k)
+        {
+            double d = w[order[i]][k] - s->mean[k];
+            mean[k] += rw * w[order[i]][k];
+            var[k]  += rw * d * d;
+        }
+    }
+
+    for (k = 0; k < featNum; ++k)
+    {
+        s->sigma[k] = sqrt((1 - SigmaRate) * s->sigma[k] * s->sigma[k] + SigmaRate * var[k]);
+        s->sigma[k] = Max(s->sigma[k], MinSigma);
+    }
+    memcpy(s->mean, mean, sizeof(s->mean));
+    normalize(s->mean);
+    s->generation++;
+}
+
+/* （内部函数）
+ * 函数名：saveCheckpoint
+ * -------------
+ * 以文本写出设置与状态：先写入临时文件，成功后再替换检查点，
+ * 中途出错或断电时原有的检查点仍然完整
+ * 浮点数以十六进制（%a）写出，读回后与写出前完全相同
+ */
+bool saveCheckpoint(const char* path, const tetTuneConfig* c, const tetTuneState* s)
+{
+    char tmp[FILENAME_MAX];
+    int k;
+
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+        return false;
+
+    FILE* fp = fopen(tmp, "w");
+    if (fp == NULL)
+        return false;
+
+    fprintf(fp, "%s %d\n", CheckpointTag, CheckpointVersion);
+    fprintf(fp, "config %d %d %d %llu %d %d %d\n", c->population, c->games, c->maxPieces,
+            (unsigned long long)c->seed, (int)c->mode, c->beamWidth, c->depth);
+    fprintf(fp, "generation %d\n", s->generation);
+    fprintf(fp, "fitness %a\n", s->bestFitness);
+    fprintf(fp, "mean");
+    for (k = 0; k < featNum; ++k)
+        fprintf(fp, " %a", s->mean[k]);
+    fprintf(fp, "\nsigma");
+    for (k = 0; k < featNum; ++k)
+        fprintf(fp, " %a", s->sigma[k]);
+    fprintf(fp, "\nbest");
+    for (k = 0; k < featNum; ++k)
+        fprintf(fp, " %a", s->best[k]);
+    fprintf(fp, "\n");
+
+    bool ok = !ferror(fp);
+    if (fclose(fp) != 0 || !ok || !platReplaceFile(tmp, path))
+    {
+        remove(tmp);
+        return false;
+    }
+    return true;
+}
+
+/* （内部函数）
+ * 函数名：loadCheckpoint
+ * -------------
+ * 读回 saveCheckpoint 写出的设置与状态，格式不符时返回 false
+ */
+bool loadCheckpoint(const char* path, tetTuneConfig* c, tetTuneState* s)
+{
+    char tag[32];
+    int version, mode;
+    unsigned long long seed;
+    bool ok;
+
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL)
+        return false;
+
+    ok = fscanf(fp, "%31s %d", tag, &version) == 2
+         && strcmp(tag, CheckpointTag) == 0 && version == CheckpointVersion
+         && fscanf(fp, "%31s %d %d %d %llu %d %d %d", tag, &c->population, &c->games,
+                   &c->maxPieces, &seed, &mode, &c->beamWidth, &c->depth) == 8
+         && strcmp(tag, "config") == 0
+         && fscanf(fp, "%31s %d", tag, &s->generation) == 2
+         && strcmp(tag, "generation") == 0
+         && fscanf(fp, "%31s %la", tag, &s->bestFitness) == 2
+         && strcmp(tag, "fitness") == 0
+         && readVector(fp, "mean", s->mean)
+         && readVector(fp, "sigma", s->sigma)
+         && readVector(fp, "best", s->best);
+
+    fclose(fp);
+    if (!ok)
+        return false;
+
+    c->seed = seed;
+    c->mode = mode == RAND_BAG ? RAND_BAG : RAND_UNIFORM;
+    return true;
+}
+
+/* （内部函数）
+ * 函数名：readVector
+ * -------------
+ * 读入以 label 开头的一行权重
+ */
+bool readVector(FILE* fp, const char* label, double w[featNum])
+{
+    char tag[32];
+    int k;
+
+    if (fscanf(fp, "%31s", tag) != 1 || strcmp(tag, label) != 0)
+        return false;
+    for (k = 0; k < featNum; ++k)
+        if (fscanf(fp, "%la", &w[k]) != 1)
+            return false;
+    return true;
+}
+
+/* （内部函数）
+ * 函数名：printWeights
+ * -------------
+ * 按 initAI 中的顺序打印一组权重，便于直接填回
+ */
+void printWeights(const char* label, const double w[featNum])
+{
+    int k;
+    printf("  %-4s", label);
+    for (k = 0; k < featNum; ++k)
+        printf(" %9.6f", w[k]);
+    printf("\n");
+}
@@ -0,0 +1,289 @@
+/*
+ * 项目：Tetris
+ * 文件名：undo.c
+ * 概览：撤销记录模块
+ * -------------
+ * 负责功能：
+ *      快照的打包与恢复（含颜色平面的推算）
+ *      环形缓冲区的记录、撤销与重做
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tetris.h"  // 需要恢复方块及方块堆
+#include "undo.h"    // 本模块
+
+// 快照中方块的1字节编码：类型3位、颜色3位
+#define PackPiece(b) ((unsigned char)((b).type | (b).color << 3))
+
+// 快照中占用位平面的一行
+#define GridRow(s, y) getRow((s)->grid, y)
+
+
+// 内部函数声明
+tetRow getRow(const uint32_t* grid, int y);
+void putRow(uint32_t* grid, int y, tetRow row);
+void pieceRows(const tetSnapshot* from, const tetSnapshot* to, tetRow piece[]);
+void restoreSnapshot(tetGame* g, const tetSnapshot* s, unsigned char color[][MaxCoordX+1]);
+void unpackPiece(tetBlock* b, unsigned char packed);
+
+
+/*
+ * 函数名：initUndoRing
+ * -------------
+ * 分配空间并清空
+ */
+bool initUndoRing(tetUndoRing* r, int depth)
+{
+    r->slot  = depth >= 2 ? malloc(depth * sizeof(tetSnapshot)) : NULL;
+    r->depth = r->slot != NULL ? depth : 0;
+    clearUndoRing(r);
+    return r->slot != NULL;
+}
+
+/*
+ * 函数名：freeUndoRing
+ * -------------
+ * 释放空间，此后缓冲区不可用
+ */
+void freeUndoRing(tetUndoRing* r)
+{
+    free(r->slot);
+    r->slot  = NULL;
+    r->depth = 0;
+    clearUndoRing(r);
+}
+
+/*
+ * 函数名：clearUndoRing
+ * -------------
+ * 清空快照，不释放空间
+ */
+void clearUndoRing(tetUndoRing* r)
+{
+    r->cur      = -1;
+    r->undoable = 0;
+    r->redoable = 0;
+}
+
+/*
+ * 函数名：pushUndo
+ * -------------
+ * 在 cur 的下一个位置写入快照；缓冲区满时，该位置即最早的快照
+ */
+void pushUndo(tetUndoRing* r, const tetGame* g, const tetBlock* placed)
+{
+    if (r->slot == NULL)
+        return;
+
+    if (r->cur >= 0)
+        r->undoable = r->undoable + 1 < r->depth ? r->undoable + 1 : r->depth - 1;
+    r->cur      = (r->cur + 1) % r->depth;
+    r->redoable = 0;
+
+    tetSnapshot* s = &r->slot[r->cur];
+    int y;
+
+    memset(s->grid, 0, sizeof(s->grid));
+    for (y = 0; y <= MaxCoordY; ++y)
+        putRow(s->grid, y, g->stored.rows[y]);
+
+    s->score   = g->score;
+    s->lines   = g->lines;
+    s->placed  = (uint16_t)((placed->orient & 3) | (placed->coord.x & 15) << 2 | (placed->coord.y & 31) << 6);
+    s->falling = PackPiece(g->falling);
+    s->next    = PackPiece(g->nextBlock);
+    s->hold    = g->OnHolding ? PackPiece(g->holdBlock) : 0;
+    s->flags   = (unsigned char)(g->OnHolding | g->OnRelease << 1 | g->delayOneRound << 2 | g->level << 3);
+}
+
+/*
+ * 函数名：undoRound
+ * -------------
+ * 回到上一个快照；当前局面相当于上一个快照的局面落定一个方块（并消除）后所得，
+ * 因此未被消除的各行的颜色，都可以在当前的颜色平面中找到
+ */
+bool undoRound(tetUndoRing* r, tetGame* g)
+{
+    if (r->slot == NULL || r->undoable == 0)
+        return false;
+
+    int prev = (r->cur + r->depth - 1) % r->depth;
+    const tetSnapshot* to   = &r->slot[prev];
+    const tetSnapshot* from = &r->slot[r->cur];
+    unsigned char color[MaxCoordY+1][MaxCoordX+1];
+    tetRow piece[MaxCoordY+1];
+    int y, src = 0;
+
+    memset(color, LightGray, sizeof(color));
+    pieceRows(to, from, piece);
+
+    // 落定后满了的行被消除，其上的行依次下移；这些行在当前局面中的位置即 src
+    for (y = 0; y <= MaxCoordY; ++y)
+    {
+        if (from->lines > to->lines && (GridRow(to, y) | piece[y]) == FullRow)
+            continue;
+        memcpy(color[y], g->stored.color[src], sizeof(color[0]));
+        src++;
+    }
+
+    restoreSnapshot(g, to, color);
+    r->cur = prev;
+    r->undoable--;
+    r->redoable++;
+    return true;
+}
+
+/*
+ * 函数名：redoRound
+ * -------------
+ * 回到下一个快照；在当前局面中落定上一轮的方块并紧缩颜色平面，即得到其颜色
+ */
+bool redoRound(tetUndoRing* r, tetGame* g)
+{
+    if (r->slot == NULL || r->redoable == 0)
+        return false;
+
+    int next = (r->cur + 1) % r->depth;
+    const tetSnapshot* from = &r->slot[r->cur];
+    const tetSnapshot* to   = &r->slot[next];
+    unsigned char color[MaxCoordY+1][MaxCoordX+1];
+    tetRow piece[MaxCoordY+1];
+    int x, y, dst = 0;
+
+    memset(color, LightGray, sizeof(color));
+    pieceRows(from, to, piece);
+
+    for (y = 0; y <= MaxCoordY; ++y)
+    {
+        if (to->lines > from->lines && (g->stored.rows[y] | piece[y]) == FullRow)
+            continue;
+        for (x = 0; x <= MaxCoordX; ++x)
+            color[dst][x] = (piece[y] >> x & 1) ? from->falling >> 3 : g->stored.color[y][x];
+        dst++;
+    }
+
+    restoreSnapshot(g, to, color);
+    r->cur = next;
+    r->undoable++;
+    r->redoable--;
+    return true;
+}
+
+/* （内部函数）
+ * 函数名：getRow / putRow
+ * -------------
+ * 读出 / 写入占用位平面的第 y 行（10位，可能跨越两个32位字）
+ * putRow 只做按位或，写入前该行须为空
+ */
+tetRow getRow(const uint32_t* grid, int y)
+{
+    int bit = y * (MaxCoordX+1);
+    uint64_t word = grid[bit / 32];
+
+    if (bit % 32 + MaxCoordX + 1 > 32)
+        word |= (uint64_t)grid[bit / 32 + 1] << 32;
+    return (tetRow)(word >> bit % 32 & FullRow);
+}
+
+void putRow(uint32_t* grid, int y, tetRow row)
+{
+    int bit = y * (MaxCoordX+1);
+
+    grid[bit / 32] |= (uint32_t)row << bit % 32;
+    if (bit % 32 + MaxCoordX + 1 > 32)
+        grid[bit / 32 + 1] |= (uint32_t)row >> (32 - bit % 32);
+}
+
+/* （内部函数）
+ * 函数名：pieceRows
+ * -------------
+ * 从快照 from 到 to 之间落定的方块在各行占用的掩码（超出顶端的部分舍去）；
+ * 两者之间是暂存而非落定（行数及方块堆都不变）时全为0
+ * 方块即 from 的下落方块，位置记录在 to 中
+ */
+void pieceRows(const tetSnapshot* from, const tetSnapshot* to, tetRow piece[])
+{
+    tetBlock b;
+    int i, y;
+
+    memset(piece, 0, (MaxCoordY+1) * sizeof(tetRow));
+    if (to->lines == from->lines && memcmp(from->grid, to->grid, sizeof(from->grid)) == 0)
+        return;
+
+    unpackPiece(&b, from->falling);
+    b.orient  = to->placed & 3;
+    b.coord.x = to->placed >> 2 & 15;
+    b.coord.y = to->placed >> 6 & 31;
+
+    const tetShape* s = ShapeOf(b);
+    for (i = 0; i <= s->maxY - s->minY; ++i)
+    {
+        y = b.coord.y + s->minY + i;
+        if (y >= 0 && y <= MaxCoordY)
+            piece[y] = (tetRow)(s->mask[i] << (b.coord.x + s->minX));
+    }
+}
+
+/* （内部函数）
+ * 函数名：restoreSnapshot
+ * -------------
+ * 以快照 s 及推算出的颜色平面 color 恢复游戏 g，重新算出各列高度及哈希值；
+ * 速度由难度等级推出（每升一级，下落间隔缩小为四分之三）
+ */
+void restoreSnapshot(tetGame* g, const tetSnapshot* s, unsigned char color[][MaxCoordX+1])
+{
+    int x, y, level;
+
+    for (y = 0; y <= MaxCoordY; ++y)
+    {
+        g->stored.rows[y] = GridRow(s, y);
+        for (x = 0; x <= MaxCoordX; ++x)
+            g->stored.color[y][x] = CellTaken(g->stored, x, y) ? color[y][x] : 0;
+    }
+    for (x = 0; x <= MaxCoordX; ++x)
+    {
+        for (y = MaxCoordY; y >= 0 && !CellTaken(g->stored, x, y); --y)
+            ;
+        g->stored.heights[x] = y + 1;
+    }
+    g->stored.hash = boardHash(&g->stored);
+
+    unpackPiece(&g->falling, s->falling);
+    moveToTop(&g->falling);
+    unpackPiece(&g->nextBlock, s->next);
+    moveToNextBox(&g->nextBlock);
+    if (s->flags & 1)
+    {
+        unpackPiece(&g->holdBlock, s->hold);
+        moveToHoldBox(&g->holdBlock);
+    }
+
+    g->OnHolding     = s->flags & 1;
+    g->OnRelease     = s->flags >> 1 & 1;
+    g->delayOneRound = s->flags >> 2 & 1;
+    g->over          = false;
+
+    g->score = s->score;
+    g->lines = s->lines;
+    g->level = s->flags >> 3;
+    g->speed = 1000;
+    for (level = 1; level < g->level; ++level)
+        g->speed = g->speed / 4 * 3;
+
+    g->gravity   = 0;
+    g->lockTicks = 0;
+}
+
+/* （内部函数）
+ * 函数名：unpackPiece
+ * -------------
+ * 由1字节编码恢复方块的类型、颜色，方向为初始状态，位置不变
+ */
+void unpackPiece(tetBlock* b, unsigned char packed)
+{
+    b->type  = (tetType)(packed & 7);
+    b->color = (tetColor)(packed >> 3 & 7);
+    initBlock(b);
+}
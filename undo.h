@@ -0,0 +1,148 @@
+/*
+ * 项目：Tetris
+ * 文件名：undo.h
+ * 概览：撤销记录模块
+ * -------------
+ * 主要内容：
+ *      每轮开始时的紧凑快照的定义
+ *      保存最近若干轮快照的环形缓冲区，及 O(1) 的撤销、重做
+ *
+ * 每开始一轮（newRound）记录一个快照，撤销即回到上一轮开始时的局面，
+ * 重做即回到撤销前的下一轮开始时的局面；撤销后开始新的一轮，则不能再重做
+ *
+ * 快照只在内存中使用，为固定大小的结构（44字节）：
+ *      方块堆的占用位平面（21×10位，按行紧排在7个32位字中）
+ *      分数、消除行数，难度等级及暂存的三个标志（共1字节）
+ *      下落、下一个、暂存方块（各1字节：类型3位、颜色3位；每轮开始时方向均为0）
+ *      上一轮落定的方块的位置（方向2位、列4位、行5位）
+ * 快照不含颜色平面：恢复时由当前局面的颜色推出，
+ * 未消除过行时完全准确；撤销一次消除时，被消除的行中原有的格子（落定的方块除外）颜色已无从得知，恢复为浅灰色
+ * 快照也不含方块序列生成器：恢复后下落及下一个方块与当时相同，其后的方块则继续由当前的生成器产生
+ *
+ * 外部接口：
+ *      initUndoRing
+ *      freeUndoRing
+ *      clearUndoRing
+ *      pushUndo
+ *      undoRound
+ *      redoRound
+ */
+
+#ifndef UNDO_H
+#define UNDO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "flow.h"    // 需要取得游戏上下文定义
+
+// 默认保存的快照个数（可撤销的轮数比它少1）
+#define UndoDepth 256
+
+// 占用位平面所需的32位字数
+#define UndoGridWords (((MaxCoordY+1) * (MaxCoordX+1) + 31) / 32)
+
+
+/* 一轮开始时的快照
+ *      grid    - 占用位平面，第 y 行占第 10y ~ 10y+9 位
+ *      score   - 分数
+ *      lines   - 消除行数
+ *      placed  - 上一轮落定的方块的位置：方向 | 列 << 2 | 行 << 6（由暂存开始的一轮无意义）
+ *      falling - 下落方块：类型 | 颜色 << 3，下同
+ *      next    - 下一个方块
+ *      hold    - 暂存方块，没有暂存时为0
+ *      flags   - OnHolding | OnRelease << 1 | delayOneRound << 2 | 难度等级 << 3
+ */
+typedef struct {
+  uint32_t      grid[UndoGridWords];
+  int32_t       score;
+  int32_t       lines;
+  uint16_t      placed;
+  unsigned char falling;
+  unsigned char next;
+  unsigned char hold;
+  unsigned char flags;
+} tetSnapshot;
+
+
+/* 快照的环形缓冲区
+ *      slot     - depth 个快照
+ *      depth    - 容量
+ *      cur      - 当前这一轮开始时的快照所在位置，-1 代表为空
+ *      undoable - cur 之前还可撤销到的快照个数
+ *      redoable - cur 之后还可重做到的快照个数
+ */
+typedef struct {
+  tetSnapshot* slot;
+  int          depth;
+  int          cur;
+  int          undoable;
+  int          redoable;
+} tetUndoRing;
+
+
+/*
+ * 函数名称：initUndoRing
+ * 函数原型：bool initUndoRing(tetUndoRing* r, int depth)
+ * 功能描述：为缓冲区分配 depth 个快照的空间并清空，至多可连续撤销 depth-1 轮
+ * 副作用？：改变传入的缓冲区，分配内存
+ *
+ * 参数描述：缓冲区 r :: tetUndoRing*
+ *         容量 depth :: int，至少为2
+ * 返回类型：bool，false 代表容量不合法或内存不足，此时缓冲区不可用（记录、撤销均无效果）
+ * --------------
+ * 使用方法：initUndoRing(&yourRing, UndoDepth);
+ */
+bool initUndoRing(tetUndoRing* r, int depth);
+
+
+/*
+ * 函数名称：freeUndoRing / clearUndoRing
+ * 函数原型：void freeUndoRing(tetUndoRing* r)
+ *          void clearUndoRing(tetUndoRing* r)
+ * 功能描述：释放缓冲区的空间 / 清空缓冲区中的快照（如开始新的一局时）
+ * 副作用？：改变传入的缓冲区
+ *
+ * 参数描述：缓冲区 r :: tetUndoRing*
+ * 返回类型：无
+ * --------------
+ * 使用方法：clearUndoRing(&yourRing);
+ */
+void freeUndoRing(tetUndoRing* r);
+void clearUndoRing(tetUndoRing* r);
+
+
+/*
+ * 函数名称：pushUndo
+ * 函数原型：void pushUndo(tetUndoRing* r, const tetGame* g, const tetBlock* placed)
+ * 功能描述：记录游戏 g 在这一轮开始时的快照，缓冲区满时覆盖最早的快照，并清除可重做的快照
+ * 副作用？：改变缓冲区
+ *
+ * 参数描述：缓冲区 r :: tetUndoRing*
+ *         游戏上下文 g :: const tetGame*，须为刚开始一轮（newRound）时
+ *         上一轮落定的方块 placed :: const tetBlock*，即开始这一轮前的下落方块
+ * 返回类型：无
+ * --------------
+ * 使用方法：pushUndo(&yourRing, yourGame, &placed);
+ */
+void pushUndo(tetUndoRing* r, const tetGame* g, const tetBlock* placed);
+
+
+/*
+ * 函数名称：undoRound / redoRound
+ * 函数原型：bool undoRound(tetUndoRing* r, tetGame* g)
+ *          bool redoRound(tetUndoRing* r, tetGame* g)
+ * 功能描述：将游戏 g 恢复到上一轮 / 撤销前的下一轮开始时的局面
+ *         | 下落方块回到顶端，下落累计量及落定帧数归零，帧数及自动重复的状态不变
+ * 副作用？：改变游戏 g 及缓冲区
+ *
+ * 参数描述：缓冲区 r :: tetUndoRing*
+ *         游戏上下文 g :: tetGame*，须为缓冲区最近一次记录的那一局
+ * 返回类型：bool，false 代表没有可撤销 / 可重做的快照，此时游戏不变
+ * --------------
+ * 使用方法：if (undoRound(&yourRing, yourGame)) ...
+ */
+bool undoRound(tetUndoRing* r, tetGame* g);
+bool redoRound(tetUndoRing* r, tetGame* g);
+
+#endif
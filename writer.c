@@ -0,0 +1,147 @@
+/*
+ * 项目：Tetris
+ * 文件名：writer.c
+ * 概览：后台写入模块
+ * -------------
+ * 负责功能：
+ *      写入任务队列及写入线程
+ *      防崩溃的文件写入
+ */
+
+#include <stdio.h>
+
+#include "platform.h" // 需要线程、信号量及文件同步、替换
+#include "writer.h"   // 本模块
+
+/* 写入任务
+ *      job, done, arg - 见 submitWrite
+ *      ok             - job 的返回值，由写入线程写入
+ */
+typedef struct {
+  tetWriteJob  job;
+  tetWriteDone done;
+  void*        arg;
+  bool         ok;
+} tetWriteTask;
+
+/* 任务队列，下标只增不减，与 WriteQueueSize-1 按位与得到位置
+ *      submitted - 已提交的任务数，只由界面线程改变
+ *      finished  - 已完成的任务数，只由写入线程改变
+ *      reported  - 已通知完成的任务数，只由界面线程改变
+ * reported <= finished <= submitted；submitted - reported 不超过 WriteQueueSize
+ */
+static tetWriteTask tasks[WriteQueueSize];
+static unsigned int submitted;
+static unsigned int finished;
+static unsigned int reported;
+
+// 写入线程，及每提交一个任务加1的信号量
+static bool         started = false;
+static tetThread    writer;
+static tetSemaphore pending;
+
+
+// 内部函数声明
+void writerMain(void* arg);
+
+
+/*
+ * 函数名：submitWrite
+ * -------------
+ * 先写入任务，再以 release 语义推进 submitted，然后唤醒写入线程
+ */
+bool submitWrite(tetWriteJob job, tetWriteDone done, void* arg)
+{
+    if (!started)
+    {
+        if (!platInitSemaphore(&pending, 0))
+            return false;
+        if (!platStartThread(&writer, writerMain, NULL))
+        {
+            platFreeSemaphore(&pending);
+            return false;
+        }
+        started = true;
+    }
+
+    if (submitted - reported == WriteQueueSize)
+        return false;
+
+    tetWriteTask* t = &tasks[submitted & (WriteQueueSize - 1)];
+    t->job  = job;
+    t->done = done;
+    t->arg  = arg;
+    t->ok   = false;
+    __atomic_store_n(&submitted, submitted + 1, __ATOMIC_RELEASE);
+    platPostSemaphore(&pending);
+    return true;
+}
+
+/*
+ * 函数名：pollWrites
+ * -------------
+ * 以 acquire 语义读出 finished，其前的任务结果都已写好
+ * 先推进 reported 再调用通知，通知中可以再提交任务
+ */
+int pollWrites()
+{
+    unsigned int done = __atomic_load_n(&finished, __ATOMIC_ACQUIRE);
+
+    while (reported != done)
+    {
+        tetWriteTask t = tasks[reported & (WriteQueueSize - 1)];
+        reported++;
+        if (t.done != NULL)
+            t.done(t.ok, t.arg);
+    }
+    return (int)(submitted - reported);
+}
+
+/*
+ * 函数名：writeFileAtomic
+ * -------------
+ * 写临时文件、写到磁盘、关闭，全部成功后才替换目标文件；任何一步失败都删去临时文件
+ */
+bool writeFileAtomic(const char* path, const void* data, size_t size)
+{
+    char tmp[FILENAME_MAX];
+
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+        return false;
+
+    FILE* fp = fopen(tmp, "wb");
+    if (fp == NULL)
+        return false;
+
+    bool ok = fwrite(data, 1, size, fp) == size && platSyncFile(fp);
+    if (fclose(fp) != 0 || !ok || !platReplaceFile(tmp, path))
+    {
+        remove(tmp);
+        return false;
+    }
+    return true;
+}
+
+/* （内部函数）
+ * 函数名：writerMain
+ * -------------
+ * 写入线程：每等到一个任务就执行它，再以 release 语义推进 finished
+ * 程序退出时线程随之结束；正在写入的文件只会留下临时文件，目标文件不受影响
+ */
+void writerMain(void* arg)
+{
+    unsigned int next;
+
+    for (;;)
+    {
+        platWaitSemaphore(&pending);
+
+        next = __atomic_load_n(&finished, __ATOMIC_RELAXED);
+        // 与 submitWrite 中的 release 配对，保证读到完整的任务
+        __atomic_load_n(&submitted, __ATOMIC_ACQUIRE);
+
+        tetWriteTask* t = &tasks[next & (WriteQueueSize - 1)];
+        t->ok = t->job(t->arg);
+        __atomic_store_n(&finished, next + 1, __ATOMIC_RELEASE);
+    }
+}
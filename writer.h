@@ -0,0 +1,88 @@
+/*
+ * 项目：Tetris
+ * 文件名：writer.h
+ * 概览：后台写入模块
+ * -------------
+ * 主要内容：
+ *      在后台线程中依次执行的写入任务的提交，及完成通知
+ *      防崩溃的文件写入：先写临时文件并写到磁盘，再原子地替换目标文件
+ *
+ * 存档、分数记录等写入可能因磁盘繁忙而阻塞很久，不应在界面线程中进行：
+ * 界面线程把要写的内容编码到内存中，连同写入任务一起提交后立即返回；
+ * 后台的写入线程（第一次提交时创建）按提交的顺序逐个执行任务，
+ * 同一文件的多次写入因此不会互相交错
+ * 任务完成后，由界面线程定期调用 pollWrites，在界面线程中得到完成通知
+ *
+ * 提交与完成通知只允许同一个线程（界面线程）调用，
+ * 任务队列是单生产者、单消费者的无锁环形队列（同 input.h），只用信号量唤醒写入线程
+ *
+ * 外部接口：
+ *      submitWrite
+ *      pollWrites
+ *      writeFileAtomic
+ */
+
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// 尚未通知完成的任务至多有几个，须为2的幂
+#define WriteQueueSize 16
+
+
+// 写入任务：在写入线程中执行，返回是否成功
+typedef bool (*tetWriteJob)(void* arg);
+
+// 完成通知：在调用 pollWrites 的线程中执行，ok 为任务的返回值
+typedef void (*tetWriteDone)(bool ok, void* arg);
+
+
+/*
+ * 函数名称：submitWrite
+ * 函数原型：bool submitWrite(tetWriteJob job, tetWriteDone done, void* arg)
+ * 功能描述：提交一个写入任务，立即返回；之后写入线程执行 job(arg)，
+ *          完成后由 pollWrites 调用 done(结果, arg)
+ * 副作用？：第一次调用时创建写入线程
+ *
+ * 参数描述：写入任务 job :: tetWriteJob
+ *         完成通知 done :: tetWriteDone，可为 NULL
+ *         任务参数 arg :: void*，须保持有效直到完成通知（通常由 done 释放）
+ * 返回类型：bool，false 代表队列已满或无法创建线程，此时任务不会执行，也不会通知
+ * --------------
+ * 使用方法：if (!submitWrite(yourJob, yourDone, arg)) free(arg);
+ */
+bool submitWrite(tetWriteJob job, tetWriteDone done, void* arg);
+
+
+/*
+ * 函数名称：pollWrites
+ * 函数原型：int pollWrites()
+ * 功能描述：按提交的顺序，为已完成的任务调用完成通知，不等待
+ * 副作用？：调用完成通知
+ *
+ * 参数描述：无
+ * 返回类型：int，尚未完成的任务数
+ * --------------
+ * 使用方法：界面计时器中 if (pollWrites() == 0) platCancelTimer(yourTimer);
+ */
+int pollWrites();
+
+
+/*
+ * 函数名称：writeFileAtomic
+ * 函数原型：bool writeFileAtomic(const char* path, const void* data, size_t size)
+ * 功能描述：将 data 起的 size 字节写为文件 path：先写入 $(path).tmp 并写到磁盘，
+ *          再原子地替换 path。任何时刻崩溃，path 要么是旧文件，要么是完整的新文件
+ * 副作用？：引起磁盘写入，可能阻塞较长时间（应在写入任务中调用）
+ *
+ * 参数描述：目标文件 path :: const char*
+ *         内容 data :: const void*，字节数 size :: size_t
+ * 返回类型：bool，false 代表写入失败，此时 path 保持原样
+ * --------------
+ * 使用方法：return writeFileAtomic("saves/x.save", buf, len);
+ */
+bool writeFileAtomic(const char* path, const void* data, size_t size);
+
+#endif